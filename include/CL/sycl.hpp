@@ -53,6 +53,8 @@
 #include "sycl/builtin.hpp"
 #include "sycl/math.hpp"
 #include "sycl/atomic.hpp"
+#include "sycl/reduction.hpp"
+#include "sycl/command_graph.hpp"
 
 #endif
 
@@ -30,6 +30,7 @@
 #define HIPSYCL_ACCESSOR_HPP
 
 #include <type_traits>
+#include <new>
 #include "range.hpp"
 #include "access.hpp"
 #include "item.hpp"
@@ -40,6 +41,7 @@
 #include "detail/stream.hpp"
 #include "detail/buffer.hpp"
 #include "detail/application.hpp"
+#include "detail/data_layout.hpp"
 
 namespace cl {
 namespace sycl {
@@ -90,12 +92,41 @@ struct accessor_pointer_type<T, access::mode::read>
   using value = const T*;
 };
 
+/// Makes the given regions of the buffer available on the host
+/// and waits until they are.
 void* obtain_host_access(buffer_ptr buff,
-                         access::mode access_mode);
+                         access::mode access_mode,
+                         buffer_region_list regions);
 
+/// Makes the given regions of the buffer available on the device
+/// for the command group of the handler.
 void* obtain_device_access(buffer_ptr buff,
                            sycl::handler& cgh,
-                           access::mode access_mode);
+                           access::mode access_mode,
+                           buffer_region_list regions);
+
+/// \return The contiguous byte regions of a buffer of the given shape
+/// that are covered by an access with the given range and offset.
+/// Adjacent regions are merged.
+template<class T, int dimensions>
+buffer_region_list
+get_accessed_regions(const sycl::range<dimensions>& buffer_range,
+                     const sycl::range<dimensions>& access_range,
+                     const sycl::id<dimensions>& access_offset)
+{
+  buffer_region_list regions;
+  data_layout<dimensions>{access_range, access_offset, buffer_range}
+    .for_each_contiguous_memory_region([&](linear_data_range r){
+      size_t begin = r.begin * sizeof(T);
+      size_t end = begin + r.num_elements * sizeof(T);
+
+      if(!regions.empty() && regions.back().end == begin)
+        regions.back().end = end;
+      else
+        regions.push_back(buffer_region{begin, end});
+    });
+  return regions;
+}
 
 template<typename dataT, int dimensions,
          access::mode accessmode,
@@ -126,10 +157,7 @@ public:
   accessor_base()
   {
 #if !defined(SYCL_DEVICE_ONLY) && !defined(__HIPSYCL_TRANSFORM__)
-    detail::accessor_tracker& tracker =
-        application::get_hipsycl_runtime().get_accessor_tracker();
-
-    tracker.new_accessor(this, nullptr);
+    new (&_buffer_storage) buffer_ptr{};
 #endif
   }
 
@@ -137,24 +165,17 @@ public:
   accessor_base(const detail::buffer_ptr& buff)
   {
 #if !defined(SYCL_DEVICE_ONLY) && !defined(__HIPSYCL_TRANSFORM__)
-    detail::accessor_tracker& tracker =
-        application::get_hipsycl_runtime().get_accessor_tracker();
-
-    tracker.new_accessor(this, buff);
+    new (&_buffer_storage) buffer_ptr{buff};
 #endif
   }
 
+  // Copies must not throw, such that kernels capturing accessors
+  // can be stored inline by task_functor.
   HIPSYCL_UNIVERSAL_TARGET
-  accessor_base(const accessor_base& other)
+  accessor_base(const accessor_base& other) noexcept
   {
 #if !defined(SYCL_DEVICE_ONLY) && !defined(__HIPSYCL_TRANSFORM__)
-    detail::accessor_tracker& tracker =
-        application::get_hipsycl_runtime().get_accessor_tracker();
-
-    detail::buffer_ptr buff =
-        tracker.find_accessor(&other);
-
-    tracker.new_accessor(this, buff);
+    new (&_buffer_storage) buffer_ptr{other.get_buffer_storage()};
 #endif
   }
 
@@ -162,13 +183,7 @@ public:
   accessor_base& operator=(const accessor_base& other)
   {
 #if !defined(SYCL_DEVICE_ONLY) && !defined(__HIPSYCL_TRANSFORM__)
-    detail::accessor_tracker& tracker =
-        application::get_hipsycl_runtime().get_accessor_tracker();
-
-    detail::buffer_ptr other_buffer =
-        tracker.find_accessor(&other);
-
-    tracker.set_accessor_buffer(this, other_buffer);
+    get_buffer_storage() = other.get_buffer_storage();
 #endif
     return *this;
   }
@@ -177,12 +192,30 @@ public:
   ~accessor_base()
   {
 #if !defined(SYCL_DEVICE_ONLY) && !defined(__HIPSYCL_TRANSFORM__)
-    detail::accessor_tracker& tracker =
-        application::get_hipsycl_runtime().get_accessor_tracker();
-
-    tracker.release_accessor(this);
+    get_buffer_storage().~buffer_ptr();
 #endif
   }
+
+  /// \return The buffer that this accessor refers to. Can only
+  /// be used on the host.
+  detail::buffer_ptr _detail_get_buffer() const
+  {
+    return get_buffer_storage();
+  }
+
+private:
+  buffer_ptr& get_buffer_storage()
+  { return *reinterpret_cast<buffer_ptr*>(&_buffer_storage); }
+
+  const buffer_ptr& get_buffer_storage() const
+  { return *reinterpret_cast<const buffer_ptr*>(&_buffer_storage); }
+
+  // The buffer is kept as raw storage that is only managed on the host:
+  // The accessor object is copied to the device as part of the kernel
+  // arguments and destroyed there, where the buffer must not be touched.
+  // Since the storage is present in both host and device compilation,
+  // the layout of the accessor is the same in both cases.
+  std::aligned_storage_t<sizeof(buffer_ptr), alignof(buffer_ptr)> _buffer_storage;
 };
 
 } // detail
@@ -260,13 +293,16 @@ access::placeholder::true_t && (accessTarget == access::target::global_buffer
   {
     if(accessTarget == access::target::host_buffer)
     {
-      this->init_host_accessor(bufferRef);
+      this->init_host_accessor(bufferRef,
+                               detail::buffer::get_buffer_range(bufferRef),
+                               id<dimensions>{});
     }
     else
     {
-      this->init_placeholder_accessor(bufferRef);
+      this->init_placeholder_accessor(bufferRef,
+                                      detail::buffer::get_buffer_range(bufferRef),
+                                      id<dimensions>{});
     }
-    _range = _buffer_range;
   }
 
   /* Available only when: (isPlaceholder == access::placeholder::false_t &&
@@ -283,14 +319,13 @@ access::target::constant_buffer)) && dimensions > 0 */
            handler &commandGroupHandlerRef)
     : detail::accessor_base{detail::buffer::get_buffer_impl(bufferRef)}
   {
-    this->init_device_accessor(bufferRef, commandGroupHandlerRef);
-    _range = _buffer_range;
+    this->init_device_accessor(bufferRef, commandGroupHandlerRef,
+                               detail::buffer::get_buffer_range(bufferRef),
+                               id<dimensions>{});
   }
 
   /// Creates an accessor for a partial range of the buffer, described by an offset
-  /// and range.
-  ///
-  /// Implementation note: At the moment, this still transfers the entire buffer.
+  /// and range. Only the accessed parts of the buffer are transferred.
   ///
   /// Available only when: (isPlaceholder == access::placeholder::false_t &&
   /// accessTarget == access::target::host_buffer) || (isPlaceholder ==
@@ -312,14 +347,12 @@ access::target::constant_buffer)) && dimensions > 0 */
   {
     if(accessTarget == access::target::host_buffer)
     {
-      this->init_host_accessor(bufferRef);
+      this->init_host_accessor(bufferRef, accessRange, accessOffset);
     }
     else
     {
-      this->init_placeholder_accessor(bufferRef);
+      this->init_placeholder_accessor(bufferRef, accessRange, accessOffset);
     }
-    _range = accessRange;
-    _offset = accessOffset;
   }
 
   /* Available only when: (isPlaceholder == access::placeholder::false_t &&
@@ -337,13 +370,12 @@ access::target::constant_buffer)) && dimensions > 0 */
            id<dimensions> accessOffset = {})
     : detail::accessor_base{detail::buffer::get_buffer_impl(bufferRef)}
   {
-    this->init_device_accessor(bufferRef, commandGroupHandlerRef);
-    _range = accessRange;
-    _offset = accessOffset;
+    this->init_device_accessor(bufferRef, commandGroupHandlerRef,
+                               accessRange, accessOffset);
   }
 
   HIPSYCL_UNIVERSAL_TARGET
-  accessor(const accessor& other)
+  accessor(const accessor& other) noexcept
     : detail::accessor_base{other},
       _ptr{other._ptr},
       _buffer_range{other._buffer_range},
@@ -362,6 +394,15 @@ access::target::constant_buffer)) && dimensions > 0 */
     return *this;
   }
 
+  /// \return The regions of the buffer that are covered by this
+  /// accessor. Can only be used on the host.
+  detail::buffer_region_list _detail_get_accessed_regions() const
+  {
+    return detail::accessor::get_accessed_regions<dataT>(_buffer_range,
+                                                         _range,
+                                                         _offset);
+  }
+
 
   /* -- common interface members -- */
   HIPSYCL_UNIVERSAL_TARGET
@@ -538,35 +579,55 @@ accessMode == access::mode::discard_read_write) && dimensions == 1) */
 private:
   template<class Buffer_type>
   void init_device_accessor(Buffer_type& bufferRef,
-                            handler& commandGroupHandlerRef)
+                            handler& commandGroupHandlerRef,
+                            range<dimensions> accessRange,
+                            id<dimensions> accessOffset)
   {
+    this->init_ranges(bufferRef, accessRange, accessOffset);
+
     detail::buffer_ptr buff = detail::buffer::get_buffer_impl(bufferRef);
     this->_ptr = reinterpret_cast<pointer_type>(
           detail::accessor::obtain_device_access(buff,
                                                  commandGroupHandlerRef,
-                                                 accessmode));
-
-    this->_buffer_range = detail::buffer::get_buffer_range(bufferRef);
+                                                 accessmode,
+                                                 _detail_get_accessed_regions()));
   }
 
   template<class Buffer_type>
-  void init_host_accessor(Buffer_type& bufferRef)
+  void init_host_accessor(Buffer_type& bufferRef,
+                          range<dimensions> accessRange,
+                          id<dimensions> accessOffset)
   {
+    // Does not touch the device pointer, such that buffers only
+    // used on the host never allocate device memory
+    this->init_ranges(bufferRef, accessRange, accessOffset);
+
     detail::buffer_ptr buff = detail::buffer::get_buffer_impl(bufferRef);
     this->_ptr = reinterpret_cast<pointer_type>(
           detail::accessor::obtain_host_access(buff,
-                                               accessmode));
-
-    this->_buffer_range = detail::buffer::get_buffer_range(bufferRef);
+                                               accessmode,
+                                               _detail_get_accessed_regions()));
   }
 
   template<class Buffer_type>
-  void init_placeholder_accessor(Buffer_type& bufferRef)
+  void init_placeholder_accessor(Buffer_type& bufferRef,
+                                 range<dimensions> accessRange,
+                                 id<dimensions> accessOffset)
   {
-    detail::buffer_ptr buff = detail::buffer::get_buffer_impl(bufferRef);
+    this->init_ranges(bufferRef, accessRange, accessOffset);
 
+    detail::buffer_ptr buff = detail::buffer::get_buffer_impl(bufferRef);
     this->_ptr = reinterpret_cast<pointer_type>(buff->get_buffer_ptr());
+  }
+
+  template<class Buffer_type>
+  void init_ranges(Buffer_type& bufferRef,
+                   range<dimensions> accessRange,
+                   id<dimensions> accessOffset)
+  {
     this->_buffer_range = detail::buffer::get_buffer_range(bufferRef);
+    this->_range = accessRange;
+    this->_offset = accessOffset;
   }
 
   HIPSYCL_UNIVERSAL_TARGET
@@ -652,7 +713,7 @@ public:
   HIPSYCL_KERNEL_TARGET
   dataT &operator[](id<dimensions> index) const
   {
-    *(detail::local_memory::get_ptr<dataT>(_addr) +
+    return *(detail::local_memory::get_ptr<dataT>(_addr) +
         detail::linear_id<dimensions>::get(index, _num_elements));
   }
 
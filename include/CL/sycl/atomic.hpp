@@ -71,7 +71,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicExch(_ptr.get(), operand);
+    return atomicExch(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -92,7 +92,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicAdd(_ptr.get(), operand);
+    return atomicAdd(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -106,7 +106,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicSub(_ptr.get(), operand);
+    return atomicSub(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -120,7 +120,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicAnd(_ptr.get(), operand);
+    return atomicAnd(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -134,7 +134,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicOr(_ptr.get(), operand);
+    return atomicOr(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -148,7 +148,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicXor(_ptr.get(), operand);
+    return atomicXor(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -162,7 +162,7 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicMin(_ptr.get(), operand);
+    return atomicMin(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
@@ -176,14 +176,14 @@ public:
       memory_order::relaxed) volatile
   {
 #ifdef __HIPSYCL_DEVICE_CALLABLE__
-    return atomicMax(_ptr.get(), operand);
+    return atomicMax(_ptr, operand);
 #else
     return detail::invalid_host_call_dummy_return<T>();
 #endif
   }
 
 private:
-  multi_ptr<T, addressSpace> _ptr;
+  T* _ptr;
 };
 
 
@@ -43,11 +43,15 @@
 #include "range.hpp"
 
 #include "detail/buffer.hpp"
+#include "detail/data_layout.hpp"
 
 #include "accessor.hpp"
 
 namespace cl {
 namespace sycl {
+
+class queue;
+
 namespace property {
 namespace buffer {
 
@@ -94,6 +98,92 @@ struct use_svm : public detail::property
 struct try_pinned_memory : public detail::property
 {};
 
+/// Stages large transfers between the device and pageable host
+/// memory (e.g. memory provided by the user) in chunks through
+/// pinned memory, overlapping the host-side memcpy with the DMA.
+struct use_pinned_staging : public detail::property
+{};
+
+/// Pages the buffer into device memory in chunks of the given size
+/// (in bytes) as ranges of it are accessed on the device, such that the
+/// buffer may be larger than device memory. When device memory runs
+/// out, the least recently used chunks are evicted and written back to
+/// the host if they have been modified. The ranges accessed by a single
+/// command group must fit into device memory at once.
+class out_of_core : public detail::property
+{
+public:
+  static constexpr std::size_t default_chunk_size = 16 * 1024 * 1024;
+
+  out_of_core(std::size_t chunk_size = default_chunk_size)
+    : _chunk_size{chunk_size}
+  {}
+
+  std::size_t get_chunk_size() const
+  {
+    return _chunk_size;
+  }
+private:
+  std::size_t _chunk_size;
+};
+
+/// Uses a memory mapping of a file as host memory of the buffer, such
+/// that data is paged in from the file as it is accessed instead of
+/// being read upfront. The file must be at least as large as the buffer,
+/// files mapped for writing are extended if necessary. Modifications are
+/// written to the file if it is mapped for writing, and discarded
+/// otherwise.
+class map_file : public detail::property
+{
+public:
+  enum file_mode
+  {
+    read_only,
+    read_write
+  };
+
+  map_file(const string_class& path, file_mode mode = read_only)
+    : _path{path}, _mode{mode}
+  {}
+
+  const string_class& get_path() const
+  {
+    return _path;
+  }
+
+  file_mode get_mode() const
+  {
+    return _mode;
+  }
+private:
+  string_class _path;
+  file_mode _mode;
+};
+
+/// Makes the destruction of the buffer non-blocking. Instead of waiting
+/// for the write-back, the destructor enqueues it after all operations
+/// on the buffer and returns immediately. Memory is released once these
+/// have completed. Host memory and final data passed as raw pointers must
+/// not be accessed or freed before then, which can be ensured with
+/// wait() on the given queue. Without a queue, cleanup is only
+/// guaranteed to have completed at program exit.
+class detach_on_destruction : public detail::property
+{
+public:
+  detach_on_destruction()
+    : _stream{std::make_shared<detail::stream_manager>()}
+  {}
+
+  detach_on_destruction(const queue& q);
+
+  detail::stream_ptr get_stream() const
+  {
+    return _stream;
+  }
+private:
+  detail::stream_ptr _stream;
+};
+
 }
 }
 }
@@ -209,6 +299,7 @@ public:
       // occur with iterators - investigate the desired behavior
       // TODO: If first, last are random access iterators, we can directly
       // the memory range [first, last) as writeback buffer
+      this->_buffer->set_write_back(this->_buffer->get_host_ptr());
       this->_buffer->enable_write_back(true);
 
       
@@ -229,9 +320,40 @@ public:
   : buffer(first, last, AllocatorT(), propList) 
   {}
 
+  /// Creates a sub-buffer referring to the part of \a b described
+  /// by \a baseIndex and \a subRange. The sub-buffer must describe a
+  /// contiguous region of memory, i.e. it may only be restricted in
+  /// the slowest moving dimension. Accesses to disjoint sub-buffers
+  /// do not depend on each other.
   buffer(buffer<T, dimensions, AllocatorT> b,
          const id<dimensions> &baseIndex,
-         const range<dimensions> &subRange);
+         const range<dimensions> &subRange)
+    : detail::property_carrying_object{b}
+  {
+    range<dimensions> parent_range = b.get_range();
+
+    if(baseIndex[0] + subRange[0] > parent_range[0])
+      throw invalid_object_error{"buffer: Sub-buffer exceeds the "
+                                 "bounds of the parent buffer"};
+
+    for(int i = 1; i < dimensions; ++i)
+      if(baseIndex[i] != 0 || subRange[i] != parent_range[i])
+        throw invalid_object_error{"buffer: Sub-buffers must describe "
+                                   "a contiguous region of memory"};
+
+    std::size_t offset =
+        detail::linear_id<dimensions>::get(baseIndex, parent_range) * sizeof(T);
+
+    _buffer = detail::buffer_impl::create_sub_buffer(b._buffer, offset,
+                                                     subRange.size() * sizeof(T));
+    _range = subRange;
+
+    // Write-back only happens once the last buffer of the family is gone
+    _alloc = b._alloc;
+    _writeback_buffer = b._writeback_buffer;
+    _shared_host_data = b._shared_host_data;
+    _cleanup_trigger = b._cleanup_trigger;
+  }
 
   /* Available only when: dimensions == 1. */
 
@@ -299,6 +421,7 @@ public:
   {
     this->_writeback_buffer = finalData;
     this->set_final_data(finalData.get());
+    this->_cleanup_trigger->retain(finalData);
   }
 
   // TODO Add special handling of iterators for set_final_data()
@@ -317,8 +440,10 @@ public:
     this->_buffer->enable_write_back(flag);
   }
 
-  // ToDo Implement
-  bool is_sub_buffer() const;
+  bool is_sub_buffer() const
+  {
+    return _buffer->is_sub_buffer();
+  }
 
   // ToDo Implement
   template <typename ReinterpretT, int ReinterpretDim>
@@ -390,15 +515,52 @@ private:
     this->create_buffer(device_mode,
                         host_mode,
                         range);
-    this->_cleanup_trigger =
-        std::make_shared<detail::buffer_cleanup_trigger>(_buffer);
+
+    if(this->has_property<hipsycl::property::buffer::map_file>())
+    {
+      auto file = this->get_property<hipsycl::property::buffer::map_file>();
+      _buffer->map_file(file.get_path(),
+          file.get_mode() == hipsycl::property::buffer::map_file::read_write);
+    }
+
+    this->init_transfers();
+    this->init_cleanup();
   }
 
   void init(const range<dimensions>& range, T* host_memory)
   {
+    if(this->has_property<hipsycl::property::buffer::map_file>())
+      throw invalid_parameter_error{"map_file cannot be used for buffers "
+                                    "constructed from host data"};
+
     this->create_buffer(host_memory, range);
+    this->init_transfers();
+    this->init_cleanup();
+  }
+
+  void init_cleanup()
+  {
     this->_cleanup_trigger =
         std::make_shared<detail::buffer_cleanup_trigger>(_buffer);
+
+    if(this->has_property<hipsycl::property::buffer::detach_on_destruction>())
+      _cleanup_trigger->enable_detached_cleanup(
+          this->get_property<hipsycl::property::buffer::detach_on_destruction>()
+            .get_stream());
+
+    if(_shared_host_data)
+      _cleanup_trigger->retain(_shared_host_data);
+  }
+
+  void init_transfers()
+  {
+    if(this->has_property<hipsycl::property::buffer::use_pinned_staging>())
+      _buffer->enable_pinned_staging(true);
+
+    if(this->has_property<hipsycl::property::buffer::out_of_core>())
+      _buffer->enable_out_of_core(
+            this->get_property<hipsycl::property::buffer::out_of_core>()
+              .get_chunk_size());
   }
 
 
@@ -0,0 +1,91 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_COMMAND_GRAPH_HPP
+#define HIPSYCL_COMMAND_GRAPH_HPP
+
+#include "types.hpp"
+#include "queue.hpp"
+#include "event.hpp"
+#include "detail/command_graph.hpp"
+
+namespace cl {
+namespace sycl {
+namespace hipsycl {
+
+/// hipSYCL extension: Records a sequence of submissions to a queue
+/// into a graph that can be replayed repeatedly. Dependencies between
+/// the recorded commands are computed once during recording, and
+/// buffers are made available on the device once per replay instead
+/// of once per command group.
+///
+/// While recording, submissions are executed as usual. Recording
+/// supports kernels and explicit copies between device accessors and
+/// raw pointers; operations that act on host accessors cannot be
+/// recorded and throw feature_not_supported.
+///
+/// Replays always execute on the queue that was recorded from, and
+/// kernels are replayed with the arguments (including accessors and
+/// captured values) they were recorded with.
+class command_graph
+{
+public:
+  explicit command_graph(const queue& q);
+
+  /// Stops recording if the graph is still recording
+  ~command_graph();
+
+  command_graph(const command_graph&) = delete;
+  command_graph& operator=(const command_graph&) = delete;
+
+  /// Starts recording submissions to the queue. Commands that
+  /// have already been recorded are discarded.
+  /// \throws invalid_object_error if another graph is
+  /// already recording from this queue.
+  void begin_recording();
+
+  void end_recording();
+
+  bool is_recording() const;
+
+  std::size_t get_num_commands() const;
+
+  /// Submits all recorded commands.
+  /// \return An event that completes once all commands have completed
+  /// \throws invalid_object_error if the graph is still recording.
+  event replay();
+
+private:
+  detail::stream_ptr _stream;
+  shared_ptr_class<detail::command_graph_recorder> _recorder;
+};
+
+} // hipsycl
+} // sycl
+} // cl
+
+#endif
@@ -33,7 +33,9 @@
 #include <condition_variable>
 #include <mutex>
 #include <functional>
-#include <queue>
+#include <deque>
+
+#include "mpsc_queue.hpp"
 
 
 namespace cl {
@@ -43,6 +45,15 @@ namespace detail {
 
 
 /// A worker thread that processes a queue in the background.
+///
+/// Operations are passed to the worker through a lock-free ring buffer.
+/// When the queue runs empty, the worker spins for a short while before
+/// going to sleep, and producers only need to wake it up if it is
+/// actually sleeping.
+///
+/// Operations may themselves enqueue further operations. Since the worker
+/// is the only consumer of the ring buffer, it cannot wait for room in
+/// it; its own operations overflow into an unbounded list instead.
 class worker_thread
 {
 public:
@@ -76,14 +87,28 @@ private:
   /// supplied.
   void work();
 
+  /// Called by the worker thread if the queue is empty. Spins
+  /// for a while, and then sleeps until new work arrives.
+  void wait_for_work();
+
   std::thread _worker_thread;
 
-  bool _continue;
+  std::atomic<bool> _continue;
 
-  std::condition_variable _condition_wait;
-  mutable std::mutex _mutex;
+  bounded_mpsc_queue<async_function> _enqueued_operations;
+  // Operations enqueued by the worker thread itself while the ring
+  // buffer was full. Only accessed by the worker thread.
+  std::deque<async_function> _overflow_operations;
 
-  std::queue<async_function> _enqueued_operations;
+  std::atomic<std::size_t> _num_enqueued;
+  std::atomic<std::size_t> _num_processed;
+
+  std::atomic<bool> _is_worker_sleeping;
+  std::atomic<int> _num_waiting_threads;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _work_available;
+  std::condition_variable _work_completed;
 };
 
 }
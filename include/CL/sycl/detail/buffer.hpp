@@ -34,8 +34,11 @@
 #include "../event.hpp"
 #include "task_graph.hpp"
 #include "stream.hpp"
+#include "small_vector.hpp"
 
 #include <cstddef>
+#include <map>
+#include <memory>
 
 namespace cl {
 namespace sycl {
@@ -63,46 +66,129 @@ enum class buffer_action
   update_host
 };
 
+/// A contiguous range of bytes [begin, end) of a buffer
+struct buffer_region
+{
+  size_t begin;
+  size_t end;
+};
+
+/// The regions accessed by an operation. Most accesses cover a single
+/// contiguous range, so the list does not allocate for those.
+using buffer_region_list = small_vector<buffer_region, 4>;
+
+/// Tracks which parts of the buffer are up-to-date on
+/// the host and on the device
 class buffer_state_monitor
 {
 public:
-  buffer_state_monitor(bool is_svm = false);
-
-  buffer_action register_host_access(access::mode m);
-  buffer_action register_device_access(access::mode m);
+  buffer_state_monitor(bool is_svm = false, size_t buffer_size = 0);
+
+  /// Registers a host access to the given regions of the buffer.
+  /// \return The parts of the regions that are outdated on the host,
+  /// and must hence be copied from the device before the access.
+  /// Adjacent parts are merged.
+  buffer_region_list
+  register_host_access(access::mode m,
+                       const buffer_region_list& regions);
+
+  /// Registers a device access to the given regions of the buffer.
+  /// \return The parts of the regions that are outdated on the device,
+  /// and must hence be copied from the host before the access.
+  /// Adjacent parts are merged.
+  buffer_region_list
+  register_device_access(access::mode m,
+                         const buffer_region_list& regions);
+
+  /// Registers an access to the entire buffer
+  buffer_region_list register_host_access(access::mode m);
+  buffer_region_list register_device_access(access::mode m);
 
   bool is_host_outdated() const;
   bool is_device_outdated() const;
+
+  /// \return All parts of the buffer that are outdated on the host
+  buffer_region_list get_outdated_host_regions() const;
+
+  /// \return The number of regions with distinct state that are
+  /// currently tracked
+  std::size_t get_num_tracked_regions() const;
 private:
+  /// Only the relation between host and device data matters,
+  /// so regions can be merged more often than if data versions
+  /// were tracked.
+  enum class region_state
+  {
+    synchronized,
+    host_newer,
+    device_newer
+  };
+
+  using region_map = std::map<size_t, region_state>;
+
+  /// Makes sure a region begins at the given position
+  void split_at(size_t pos);
+  /// Merges neighboring regions with equal state in the
+  /// range [begin, end)
+  void merge_regions(size_t begin, size_t end);
+
+  size_t get_region_end(region_map::const_iterator it) const;
+
+  /// Registers an access from the side whose data is older in
+  /// the region state \c outdated_state.
+  /// \param written Whether the access modifies the data
+  buffer_region_list
+  register_access(const buffer_region_list& regions,
+                  region_state outdated_state,
+                  bool discard,
+                  bool written);
+
   bool _svm;
+  size_t _size;
 
-  std::size_t _host_data_version;
-  std::size_t _device_data_version;
+  // Maps the begin of each region to its state. The regions
+  // cover the entire buffer, and neighboring regions always
+  // differ in their state, so that only few regions exist unless
+  // the buffer is accessed in a fragmented way.
+  region_map _regions;
 };
 
-/// Logs operations on the buffer, and calculates
-/// dependencies on previous buffer accesses
+/// Logs operations on the buffer together with the regions they
+/// access, and calculates dependencies on previous buffer accesses.
+/// All regions are given as regions of the root buffer, sorted by
+/// their begin and non-overlapping.
 class buffer_access_log
 {
 public:
-  /// Blocks until all work has completed
-  ~buffer_access_log();
-
-  /// Adds a buffer access to the dependency list
+  /// Adds a buffer access to the given regions to the dependency list.
+  /// The task must depend on the operations that calculate_dependencies()
+  /// returns for the access, since write accesses replace the
+  /// operations on the regions they cover.
   void add_operation(const task_graph_node_ptr& task,
-                     access::mode access);
+                     access::mode access,
+                     buffer_region_list regions);
 
   /// \return whether the buffer is currently in use,
   /// i.e. any operations have been registered.
   bool is_buffer_in_use() const;
 
-  /// Calculates the dependencies required for the specified access mode.
-  /// The following rules are used
-  vector_class<task_graph_node_ptr>
-  calculate_dependencies(access::mode m) const;
+  /// Calculates the dependencies required for an access to the given
+  /// regions with the specified access mode. The following rules are used:
+  /// * Only previous operations on overlapping regions are considered
+  /// * Write accesses depend on all of them
+  /// * Read accesses only depend on previous write accesses
+  task_graph_node_list
+  calculate_dependencies(access::mode m,
+                         const buffer_region_list& regions) const;
 
   bool is_write_operation_pending() const;
 
+  /// \return whether any registered operation has not yet completed
+  bool has_pending_operations() const;
+
+  /// \return all registered operations that have not yet completed
+  task_graph_node_list get_pending_operations() const;
+
   /// Waits until all dependencies have completed.
   void wait_dependencies();
 private:
@@ -110,6 +196,7 @@ private:
   {
     task_graph_node_ptr task;
     access::mode access_mode;
+    buffer_region_list regions;
   };
 
   vector_class<dependency> _operations;
@@ -118,7 +205,7 @@ private:
 class buffer_impl;
 using buffer_ptr = shared_ptr_class<buffer_impl>;
 
-class buffer_impl
+class buffer_impl : public std::enable_shared_from_this<buffer_impl>
 {
 public:
 
@@ -129,15 +216,53 @@ public:
   buffer_impl(size_t buffer_size,
               void* host_ptr);
 
+  /// Releases the memory of the buffer once all operations on it have
+  /// completed, without blocking.
   ~buffer_impl();
 
-  void* get_buffer_ptr() const;
-  void* get_host_ptr() const;
+  /// Creates a sub-buffer that aliases the memory of \c parent
+  /// in the range [offset, offset+size) (in bytes). The sub-buffer
+  /// shares the data state and write-back settings of its parent, but
+  /// has its own access log, such that accesses to disjoint sub-buffers
+  /// do not depend on each other.
+  static buffer_ptr create_sub_buffer(buffer_ptr parent,
+                                      size_t offset,
+                                      size_t size);
+
+  bool is_sub_buffer() const;
+
+  /// \return The offset in bytes of a sub-buffer within
+  /// its parent buffer, or 0 if this is not a sub-buffer.
+  size_t get_offset() const;
+  size_t get_size() const;
+
+  /// \return The device memory of the buffer, which is
+  /// allocated on the first call.
+  /// \throws feature_not_supported for out-of-core buffers, whose
+  /// memory is only available for ranges of the buffer.
+  void* get_buffer_ptr();
+  /// \return A pointer to the device memory of the buffer that is valid
+  /// for the given regions (relative to this buffer). For out-of-core
+  /// buffers, makes sure the regions are mapped into device memory,
+  /// evicting other parts of the buffer if necessary. Only the given
+  /// regions may then be accessed through the pointer.
+  /// \param stream The stream of the access, on which evictions are
+  /// performed
+  void* get_buffer_ptr(const buffer_region_list& regions,
+                       detail::stream_ptr stream);
+  /// \return The host memory of the buffer. If the buffer does not
+  /// use memory provided by the user, it is allocated on the first call.
+  void* get_host_ptr();
 
   void write(const void* host_data, hipStream_t stream, bool async = false);
 
   bool is_svm_buffer() const;
 
+  /// \return Whether host and device accesses use the same allocation
+  /// without any transfers. This is always the case on the CPU platform,
+  /// where host and device share an address space.
+  bool is_unified_memory_buffer() const;
+
   bool owns_host_memory() const;
   bool owns_pinned_host_memory() const;
 
@@ -148,6 +273,24 @@ public:
   bool is_writeback_enabled() const;
   void* get_writeback_ptr() const;
 
+  /// Stages large transfers from or to pageable host memory (e.g. user
+  /// provided memory) through a pool of pinned memory blocks.
+  void enable_pinned_staging(bool staging);
+
+  /// Only keeps the parts of the buffer that are accessed on the device
+  /// in device memory, in segments made up of chunks of \a chunk_size
+  /// bytes. Must be called before the buffer is accessed.
+  void enable_out_of_core(size_t chunk_size);
+  bool is_out_of_core() const;
+
+  /// Uses a memory mapping of the file at \a path as host memory. If
+  /// \a writable is true, the mapping is shared with the file, which
+  /// becomes the write-back target. Otherwise, modifications are private
+  /// to the buffer. Only for buffers that allocate their own host memory,
+  /// and must be called before the buffer is accessed.
+  void map_file(const string_class& path, bool writable);
+  bool is_file_backed() const;
+
   /// Finishes all enqueued host accesses, and executes
   /// possible write-back operations. After a call to this
   /// function, the host-side buffer can be safely released
@@ -156,35 +299,136 @@ public:
 
   void finalize_host(detail::stream_ptr stream);
 
+  /// Like finalize_host(), but does not wait. The write-back, if any,
+  /// is enqueued as a task on the given stream.
+  /// \return The write-back task, or nullptr if there is nothing
+  /// to write back.
+  task_graph_node_ptr finalize_host_async(detail::stream_ptr stream);
+
+  /// \return All operations on the buffer, including its sub-buffers,
+  /// that have not yet completed.
+  task_graph_node_list get_pending_operations();
+
+  /// Enqueues a task that makes the given regions of the buffer
+  /// available on the host. Only the parts of the regions that are
+  /// outdated on the host are transferred.
   static
   task_graph_node_ptr access_host(detail::buffer_ptr buff,
                                   access::mode m,
+                                  buffer_region_list regions,
                                   detail::stream_ptr stream,
                                   async_handler error_handler);
 
+  /// Enqueues a task that makes the given regions of the buffer
+  /// available on the device. Only the parts of the regions that are
+  /// outdated on the device are transferred.
   static
   task_graph_node_ptr access_device(detail::buffer_ptr buff,
                                     access::mode m,
+                                    buffer_region_list regions,
                                     detail::stream_ptr stream,
                                     async_handler error_handler);
 
+  /// \return A region list describing the entire buffer
+  buffer_region_list get_full_region() const;
+
   /// Registers an external operation on the buffer in the access log,
   /// such as an explicit copy or a kernel working with the buffer.
   /// The external operation will then be taken account during the dependency
   /// resolution for buffer accesses.
   void register_external_access(const task_graph_node_ptr& task,
                                 access::mode m);
+  /// Registers an external operation that only accesses the given
+  /// regions of the buffer.
+  void register_external_access(const task_graph_node_ptr& task,
+                                access::mode m,
+                                buffer_region_list regions);
 
 private:
-  void perform_writeback(detail::stream_ptr stream);
+  /// A contiguous part of the buffer that is present in
+  /// device memory. Buffers that are not out-of-core consist
+  /// of a single segment.
+  struct device_segment
+  {
+    size_t begin;
+    size_t end;
+    void* ptr;
+    // For LRU eviction of out-of-core segments
+    size_t last_use;
+    // Whether the segment has been mapped for a command group whose
+    // operations have not been registered yet
+    bool pending_use;
+  };
+  // Only out-of-core buffers have more than one segment
+  using device_segment_list = small_vector<device_segment, 1>;
+
+  buffer_impl(buffer_ptr parent, size_t offset, size_t size);
+
+  /// \return The buffer that owns the memory, i.e. this buffer
+  /// if it is not a sub-buffer.
+  buffer_impl* get_root();
 
-  void update_host(size_t begin, size_t end, hipStream_t stream);
-  void update_host(hipStream_t stream);
+  /// Calculates the dependencies of an access to the given regions of
+  /// the root buffer through this buffer. This includes conflicting
+  /// accesses through the parent buffer and through overlapping
+  /// sub-buffers. The mutex of the root buffer must be locked.
+  task_graph_node_list
+  calculate_dependencies(access::mode m,
+                         const buffer_region_list& root_regions);
 
-  void update_device(size_t begin, size_t end, hipStream_t stream);
-  void update_device(hipStream_t stream);
+  /// Calculates the dependencies of an access to this entire buffer
+  task_graph_node_list
+  calculate_dependencies(access::mode m);
 
-  task_state execute_buffer_action(buffer_action a, hipStream_t stream);
+  /// Translates regions of this buffer into regions of the root buffer
+  buffer_region_list
+  get_root_regions(buffer_region_list regions) const;
+
+  void perform_writeback(detail::stream_ptr stream);
+  /// Enqueues the write-back task without waiting for it.
+  /// \return The task, or nullptr if write-back is disabled.
+  task_graph_node_ptr enqueue_writeback(detail::stream_ptr stream);
+  /// Copies the data that is outdated in the write-back memory
+  /// into it. Executed by the write-back task.
+  task_state write_back_outdated(const device_segment_list& segments,
+                                 detail::stream_ptr stream);
+
+  void update_host(size_t begin, size_t end,
+                   const device_segment_list& segments,
+                   hipStream_t stream);
+  void update_device(size_t begin, size_t end,
+                     const device_segment_list& segments,
+                     hipStream_t stream);
+
+  /// Transfers the given regions in the direction
+  /// described by the buffer action.
+  /// \param segments The device memory of the buffer at the time
+  /// the action was enqueued
+  task_state execute_buffer_action(buffer_action a,
+                                   const buffer_region_list& regions,
+                                   const device_segment_list& segments,
+                                   hipStream_t stream);
+
+  /// \return The current device memory of the buffer. Tasks must use
+  /// the segments obtained when they were inserted, since segments of
+  /// out-of-core buffers may be evicted before the tasks execute. The
+  /// mutex must be locked.
+  device_segment_list get_device_segments() const;
+
+  /// Makes sure the chunks containing [begin, end) are present in one
+  /// device segment, and returns a pointer to the buffer memory that
+  /// is valid within the segment.
+  /// \param lock The lock on the mutex. It is released while waiting
+  /// for evictions to free device memory.
+  void* map_out_of_core_range(size_t begin, size_t end,
+                              std::unique_lock<mutex_class>& lock,
+                              detail::stream_ptr stream);
+
+  /// Enqueues a task on the stream that writes back the modified parts
+  /// of the segment and releases its memory once all operations on the
+  /// buffer have completed. The mutex must be locked.
+  task_graph_node_ptr evict_segment(const device_segment& segment,
+                                    detail::stream_ptr stream);
 
   /// Performs an async data transfer if the stream is from
   /// a sycl queue (i.e. not the default stream) and a synchronous
@@ -196,9 +440,17 @@ private:
   /// data transfer otherwise.
   void memcpy_h2d(void* device, const void* host, size_t len, hipStream_t stream);
 
+  /// \return Whether a transfer from or to the given host memory
+  /// should be staged through pinned memory
+  bool is_staging_required(const void* host, size_t len) const;
+
   bool _svm;
+  // Device accesses use the host memory directly. Unlike with SVM,
+  // the memory is regular (or user-provided) host memory.
+  bool _unified_memory;
   bool _pinned_memory;
   bool _owns_host_memory;
+  host_alloc_mode _host_alloc_mode;
 
   void* _buffer_pointer;
   void* _host_memory;
@@ -209,9 +461,42 @@ private:
   void* _write_back_memory;
 
   buffer_state_monitor _monitor;
-  buffer_access_log _dependency_manager;
+  // Protects the monitor, which is updated when accesses are executed
+  mutex_class _state_mutex;
+  // Shared with the root buffer for sub-buffers, such that accesses
+  // through a sub-buffer are still known after it has been destroyed
+  shared_ptr_class<buffer_access_log> _dependency_manager;
 
   mutex_class _mutex;
+  // Protects the lazy allocation of host and device memory
+  mutex_class _allocation_mutex;
+
+  // For sub-buffers, the root buffer whose memory is aliased.
+  // Its data state is used instead of our own.
+  buffer_ptr _parent;
+  size_t _offset;
+
+  // Stage transfers from or to pageable memory through pinned memory
+  bool _staged_transfers;
+
+  // Size of the file mapping used as host memory, or 0
+  size_t _mapped_file_size;
+
+  bool _out_of_core;
+  size_t _chunk_size;
+  // Segments of out-of-core buffers, which never overlap
+  device_segment_list _segments;
+  size_t _segment_use_counter;
+
+  struct sub_buffer_log
+  {
+    size_t offset;
+    size_t size;
+    std::weak_ptr<buffer_impl> buffer;
+    shared_ptr_class<buffer_access_log> log;
+  };
+  // For root buffers, the access logs of the sub-buffers
+  vector_class<sub_buffer_log> _sub_buffers;
 };
 
 class buffer_cleanup_trigger
@@ -226,10 +511,20 @@ public:
   void add_cleanup_callback(cleanup_callback callback);
   
   void remove_cleanup_callbacks();
+
+  /// Keeps \a data alive until the cleanup has completed
+  void retain(shared_ptr_class<void> data);
+
+  /// Enqueues write-back and callbacks on \a stream when the trigger
+  /// is destroyed instead of waiting for them.
+  void enable_detached_cleanup(detail::stream_ptr stream);
 private:
   buffer_ptr _buff;
 
   vector_class<cleanup_callback> _callbacks;
+  vector_class<shared_ptr_class<void>> _retained_data;
+  // Stream for detached cleanup, or nullptr
+  detail::stream_ptr _detached_stream;
 };
 
 
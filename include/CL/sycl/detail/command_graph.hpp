@@ -0,0 +1,112 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_DETAIL_COMMAND_GRAPH_HPP
+#define HIPSYCL_DETAIL_COMMAND_GRAPH_HPP
+
+#include "../types.hpp"
+#include "../access.hpp"
+
+#include "task_graph.hpp"
+#include "buffer.hpp"
+#include "stream.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// Records the commands submitted to a queue, and the dependencies
+/// between them, such that they can later be replayed without
+/// repeating the dependency analysis.
+class command_graph_recorder
+{
+public:
+  using replayable_task = function_class<task_state ()>;
+
+  struct buffer_usage
+  {
+    buffer_ptr buff;
+    access::mode access_mode;
+  };
+
+  /// Records a command.
+  /// \param task The operation that was submitted. Must be
+  /// executable repeatedly.
+  /// \param accesses The buffers accessed by the command
+  /// \param predecessor Index of a previously recorded command that
+  /// must be executed before this one regardless of buffer accesses
+  /// (e.g. a previous command of the same command group), or
+  /// \c no_command.
+  /// \return the index of the recorded command
+  std::size_t record(replayable_task task,
+                     const vector_class<buffer_usage>& accesses,
+                     std::size_t predecessor);
+
+  /// Replays all recorded commands on the given stream.
+  /// \return a node that completes once all commands have completed,
+  /// or nullptr if no commands have been recorded.
+  task_graph_node_ptr replay(stream_ptr stream,
+                             async_handler handler) const;
+
+  std::size_t get_num_commands() const;
+
+  static constexpr std::size_t no_command = static_cast<std::size_t>(-1);
+private:
+  struct command
+  {
+    // Shared with the task graph nodes of replays that may
+    // still be in flight when the recorder is destroyed
+    shared_ptr_class<replayable_task> task;
+    vector_class<buffer_usage> accesses;
+    // Indices of the earlier commands this command depends on
+    vector_class<std::size_t> dependencies;
+  };
+
+  struct buffer_state
+  {
+    buffer_ptr buff;
+    // Access mode that covers all accesses to the buffer within
+    // the graph. Used to make the buffer available on the device
+    // once per replay.
+    access::mode combined_access_mode;
+
+    std::size_t last_write;
+    vector_class<std::size_t> reads_since_last_write;
+  };
+
+  buffer_state& get_buffer_state(const buffer_ptr& buff,
+                                 access::mode first_access);
+
+  vector_class<command> _commands;
+  vector_class<buffer_state> _buffers;
+};
+
+}
+}
+}
+
+#endif
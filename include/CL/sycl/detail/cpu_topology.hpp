@@ -0,0 +1,70 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_CPU_TOPOLOGY_HPP
+#define HIPSYCL_CPU_TOPOLOGY_HPP
+
+#include <cstddef>
+
+#include "../types.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// Properties of the host CPU, as reported by the operating system.
+/// Values that cannot be determined are 0.
+struct cpu_topology
+{
+  static const cpu_topology& get();
+
+  string_class name;
+  /// Number of hardware threads
+  std::size_t num_cores;
+  /// In MHz
+  std::size_t max_clock_frequency;
+  /// Sizes of the data caches in bytes
+  std::size_t l1_cache_size;
+  std::size_t l2_cache_size;
+  std::size_t l3_cache_size;
+  std::size_t cache_line_size;
+  /// Width of the widest SIMD registers supported by the CPU in bytes
+  std::size_t simd_width;
+  /// Physical memory in bytes
+  std::size_t memory_size;
+
+  /// \return The size of the largest data cache
+  std::size_t get_last_level_cache_size() const;
+private:
+  cpu_topology();
+};
+
+}
+}
+}
+
+#endif
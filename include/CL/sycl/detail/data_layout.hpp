@@ -29,6 +29,7 @@
 #define HIPSYCL_DATA_LAYOUT_HPP
 
 #include <cassert>
+#include <type_traits>
 
 #include "../id.hpp"
 #include "../range.hpp"
@@ -120,32 +121,27 @@ public:
   template<class Function>
   void for_each_contiguous_memory_region(Function f) const
   {
-    if(dim == 0)
-    {
-      f(linear_data_range{0, 1});
-    }
-    else if(dim == 1)
-    {
-      f(linear_data_range{_offset.get(0),_access_range.get(0)});
-    }
-    else if(dim == 2)
-    {
-      for_each_contiguous_region2D(f);
-    }
-    else if(dim == 3)
-    {
-      for_each_contiguous_region3D(f);
-    }
-    else
-    {
-      // Should never happen because of our static_assert();
-      assert(false);
-    }
+    // Dispatch on the dimension at compile time, since the
+    // implementations for the different dimensions only compile
+    // for their respective dimension.
+    for_each_contiguous_region(f, std::integral_constant<int, dim>{});
   }
 
 private:
   template<class Function>
-  void for_each_contiguous_region2D(Function f) const
+  void for_each_contiguous_region(Function f, std::integral_constant<int, 0>) const
+  {
+    f(linear_data_range{0, 1});
+  }
+
+  template<class Function>
+  void for_each_contiguous_region(Function f, std::integral_constant<int, 1>) const
+  {
+    f(linear_data_range{_offset.get(0),_access_range.get(0)});
+  }
+
+  template<class Function>
+  void for_each_contiguous_region(Function f, std::integral_constant<int, 2>) const
   {
     if(_access_range.get(1) == _shape.get(1))
     {
@@ -170,7 +166,7 @@ private:
 
 
   template<class Function>
-  void for_each_contiguous_region3D(Function f) const
+  void for_each_contiguous_region(Function f, std::integral_constant<int, 3>) const
   {
     if(_access_range.get(1) == _shape.get(1))
     {
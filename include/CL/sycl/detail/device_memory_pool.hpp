@@ -0,0 +1,199 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_DEVICE_MEMORY_POOL_HPP
+#define HIPSYCL_DEVICE_MEMORY_POOL_HPP
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "../types.hpp"
+#include "../backend/backend.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+struct device_memory_pool_statistics
+{
+  /// Bytes currently handed out to users of the pool
+  std::size_t bytes_in_use = 0;
+  /// Bytes of released allocations that are kept for reuse
+  std::size_t bytes_cached = 0;
+  /// High-water mark of bytes_in_use
+  std::size_t peak_bytes_in_use = 0;
+  /// High-water mark of the memory allocated from the backend,
+  /// i.e. bytes_in_use + bytes_cached
+  std::size_t peak_bytes_reserved = 0;
+
+  std::size_t num_allocations = 0;
+  /// Number of allocations that were served from the cache
+  std::size_t num_cache_hits = 0;
+};
+
+/// Caches device allocations in size classes, such that allocating
+/// memory for short-lived buffers does not reach the backend (and,
+/// on CUDA, does not implicitly synchronize the device).
+/// Allocations are served from a separate pool for each device, which
+/// is selected by the active device of the calling thread.
+///
+/// Sizes are rounded up to the next power of two, and to a multiple
+/// of large_size_granularity above large_size_threshold. Cached memory
+/// is only returned to the backend by trim(), or if an allocation
+/// fails because the device is out of memory.
+class device_memory_pool
+{
+public:
+  static constexpr std::size_t min_size_class = 512;
+  static constexpr std::size_t large_size_threshold = 64 * 1024 * 1024;
+  static constexpr std::size_t large_size_granularity = 2 * 1024 * 1024;
+
+  /// \return The pool used for all device allocations of the runtime.
+  /// The limit of cached memory per device can be set with the
+  /// HIPSYCL_DEVICE_POOL_LIMIT environment variable (in bytes), and
+  /// the device memory available to the pool with
+  /// HIPSYCL_DEVICE_MEMORY_LIMIT.
+  static device_memory_pool& get();
+
+  device_memory_pool(std::size_t max_cached_bytes,
+                     std::size_t device_memory_limit =
+                       std::numeric_limits<std::size_t>::max());
+  ~device_memory_pool();
+
+  device_memory_pool(const device_memory_pool&) = delete;
+  device_memory_pool& operator=(const device_memory_pool&) = delete;
+
+  /// Allocates memory on the active device. Reuses a cached
+  /// allocation of the same size class whose previous use has
+  /// completed.
+  /// \throws memory_allocation_error if the allocation fails
+  void* allocate(std::size_t size);
+
+  /// Like allocate(), but additionally allows reusing allocations
+  /// that have been released on the given stream, even if operations
+  /// enqueued before the release are still executing. The
+  /// memory must then only be used by operations on that stream.
+  void* allocate(std::size_t size, hipStream_t stream);
+
+  /// Like allocate(), but returns nullptr instead of throwing if the
+  /// device is out of memory, such that the caller can free memory
+  /// and retry.
+  void* try_allocate(std::size_t size);
+
+  /// Returns memory to the pool. All operations accessing the memory
+  /// must have completed.
+  void release(void* ptr);
+
+  /// Returns memory to the pool once all operations that have been
+  /// enqueued on the given stream so far have completed.
+  void release(void* ptr, hipStream_t stream);
+
+  /// Frees cached memory of all devices until at most
+  /// \a bytes_to_keep bytes remain cached per device.
+  void trim(std::size_t bytes_to_keep = 0);
+
+  /// Frees cached memory of the given device until at most
+  /// \a bytes_to_keep bytes remain cached.
+  void trim(int device, std::size_t bytes_to_keep = 0);
+
+  /// Sets the maximum number of bytes that are cached per device.
+  /// Memory released beyond this limit is freed immediately. A
+  /// limit of 0 disables caching.
+  void set_max_cached_bytes(std::size_t bytes);
+  std::size_t get_max_cached_bytes() const;
+
+  /// Limits the memory (in use and cached) that the pool allocates on
+  /// each device. Allocations beyond the limit fail as if the device
+  /// were out of memory. This allows emulating devices with less
+  /// memory, e.g. to test out-of-core buffers.
+  void set_device_memory_limit(std::size_t bytes);
+  std::size_t get_device_memory_limit() const;
+
+  device_memory_pool_statistics get_statistics(int device) const;
+
+  /// \return The number of bytes that will actually be allocated
+  /// for a request of \a size bytes.
+  static std::size_t get_size_class(std::size_t size);
+private:
+  struct cached_block
+  {
+    void* ptr;
+    // Only set for blocks that have been released in stream order
+    hipEvent_t release_event;
+    hipStream_t release_stream;
+  };
+
+  struct live_block
+  {
+    int device;
+    std::size_t size_class;
+  };
+
+  struct device_pool
+  {
+    std::map<std::size_t, vector_class<cached_block>> free_blocks;
+    device_memory_pool_statistics stats;
+  };
+
+  void* allocate(std::size_t size, bool stream_ordered,
+                 hipStream_t stream, bool throw_if_exhausted);
+  void release(void* ptr, bool stream_ordered, hipStream_t stream);
+
+  /// \return Whether the memory of the block may be reused,
+  /// optionally by operations on the given stream.
+  bool is_reusable(const cached_block& block,
+                   bool stream_ordered,
+                   hipStream_t stream) const;
+
+  /// Frees cached blocks in descending size until at most
+  /// \a bytes_to_keep bytes are cached. The pool mutex must be locked.
+  void trim_device(device_pool& pool, std::size_t bytes_to_keep);
+  void free_block(cached_block& block);
+
+  /// Allocates memory from the backend, respecting the device memory
+  /// limit. The pool mutex must be locked.
+  hipError_t allocate_block(const device_pool& pool,
+                            void** ptr,
+                            std::size_t size_class) const;
+
+  static int get_active_device();
+
+  std::unordered_map<int, device_pool> _devices;
+  std::unordered_map<void*, live_block> _live_blocks;
+  std::size_t _max_cached_bytes;
+  std::size_t _device_memory_limit;
+
+  mutable mutex_class _mutex;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,543 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_HOST_DISPATCH_HPP
+#define HIPSYCL_HOST_DISPATCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "../id.hpp"
+#include "../range.hpp"
+#include "../item.hpp"
+#include "../nd_item.hpp"
+#include "../backend/backend.hpp"
+#include "data_layout.hpp"
+#include "host_thread_pool.hpp"
+#include "thread_hierarchy.hpp"
+
+#if defined(__AVX512F__)
+  #define HIPSYCL_HOST_SIMD_WIDTH 16
+#elif defined(__AVX__)
+  #define HIPSYCL_HOST_SIMD_WIDTH 8
+#else
+  #define HIPSYCL_HOST_SIMD_WIDTH 4
+#endif
+
+// Asks the compiler to vectorize the following loop. Work items of
+// a kernel may access overlapping memory, so the compiler still has to
+// prove that the iterations are independent, or check it at runtime.
+// Programs whose range kernels never have work items accessing the
+// same memory can define HIPSYCL_ASSUME_INDEPENDENT_WORK_ITEMS to skip
+// these checks. OpenMP's simd construct is avoided: It makes the same
+// assumption, and gcc turns the ids of the work items into arrays of
+// structs then, which it cannot vectorize.
+#define HIPSYCL_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__) && defined(HIPSYCL_ASSUME_INDEPENDENT_WORK_ITEMS)
+  #define HIPSYCL_SIMD_LOOP_WITH_WIDTH(width) \
+    HIPSYCL_PRAGMA(clang loop vectorize(assume_safety) vectorize_width(width))
+#elif defined(__clang__)
+  #define HIPSYCL_SIMD_LOOP_WITH_WIDTH(width) \
+    HIPSYCL_PRAGMA(clang loop vectorize(enable) vectorize_width(width))
+#elif defined(__GNUC__) && defined(HIPSYCL_ASSUME_INDEPENDENT_WORK_ITEMS)
+  #define HIPSYCL_SIMD_LOOP_WITH_WIDTH(width) HIPSYCL_PRAGMA(GCC ivdep)
+#else
+  // gcc has no hint to vectorize a loop that does not also
+  // assume the absence of dependencies
+  #define HIPSYCL_SIMD_LOOP_WITH_WIDTH(width)
+#endif
+#define HIPSYCL_SIMD_LOOP HIPSYCL_SIMD_LOOP_WITH_WIDTH(HIPSYCL_HOST_SIMD_WIDTH)
+
+namespace cl {
+namespace sycl {
+namespace detail {
+namespace host_dispatch {
+
+/// Ranges are split into more chunks than there are threads,
+/// so that threads finishing early can help with the rest.
+constexpr std::size_t chunks_per_thread = 4;
+
+/// Number of consecutive work items of range kernels that are executed
+/// together, such that they can be vectorized. This is the number of 32 bit
+/// values in the widest vector registers of the target.
+constexpr std::size_t simd_width = HIPSYCL_HOST_SIMD_WIDTH;
+
+template<int dimensions>
+id<dimensions> delinearize(std::size_t linear_id,
+                           const sycl::range<dimensions>& r)
+{
+  id<dimensions> result;
+  for(int i = dimensions - 1; i >= 0; --i)
+  {
+    result[i] = linear_id % r[i];
+    linear_id /= r[i];
+  }
+  return result;
+}
+
+/// Calls \a row_function(row_begin, row_length) for the rows along the last
+/// dimension that make up the items with the linear ids [begin, end) of
+/// the range \a r. Items along the last dimension are contiguous in memory
+/// for the usual accessor layout, so they form the innermost loop.
+template<int dimensions, class RowFunction>
+void for_each_row(const sycl::range<dimensions>& r,
+                  std::size_t begin, std::size_t end,
+                  RowFunction row_function)
+{
+  constexpr int last = dimensions - 1;
+  id<dimensions> idx = delinearize(begin, r);
+
+  for(std::size_t n = begin; n < end;)
+  {
+    std::size_t row_length = std::min(end - n, r[last] - idx[last]);
+    row_function(idx, row_length);
+    n += row_length;
+
+    idx[last] = 0;
+    for(int i = last - 1; i >= 0; --i)
+    {
+      if(++idx[i] < r[i])
+        break;
+      idx[i] = 0;
+    }
+  }
+}
+
+/// Invokes \a f for the items with the linear ids [begin, end) of the
+/// range \a r in order.
+template<int dimensions, class Function, class ItemFactory>
+void execute_items(const Function& f,
+                   const sycl::range<dimensions>& r,
+                   std::size_t begin, std::size_t end,
+                   ItemFactory make)
+{
+  for_each_row(r, begin, end,
+               [&](id<dimensions> idx, std::size_t row_length){
+    for(std::size_t i = 0; i < row_length; ++i, ++idx[dimensions - 1])
+      f(make(idx));
+  });
+}
+
+/// Invokes \a f for the items with the linear ids [begin, end) of the
+/// range \a r, processing simd_width consecutive items of a row at once
+/// such that the compiler can vectorize across items. The remainder of
+/// each row is processed item by item.
+///
+/// The items may be executed in any order, so \a make must not have
+/// side effects. This is what SYCL guarantees for kernels over a range.
+template<int dimensions, class Function, class ItemFactory>
+void execute_items_simd(const Function& f,
+                        const sycl::range<dimensions>& r,
+                        std::size_t begin, std::size_t end,
+                        ItemFactory make)
+{
+  constexpr int last = dimensions - 1;
+
+  for_each_row(r, begin, end,
+               [&](const id<dimensions>& row_begin, std::size_t row_length){
+    std::size_t i = 0;
+    for(; i + simd_width <= row_length; i += simd_width)
+    {
+      HIPSYCL_SIMD_LOOP
+      for(std::size_t lane = 0; lane < simd_width; ++lane)
+      {
+        id<dimensions> idx = row_begin;
+        idx[last] += i + lane;
+        f(make(idx));
+      }
+    }
+
+    for(; i < row_length; ++i)
+    {
+      id<dimensions> idx = row_begin;
+      idx[last] += i;
+      f(make(idx));
+    }
+  });
+}
+
+/// \return The first linear id of chunk number \a chunk when splitting
+/// \a num_items items into \a num_chunks chunks. Chunks start at
+/// multiples of simd_width, so that they split rows into few remainders.
+inline std::size_t chunk_begin(std::size_t num_items,
+                               std::size_t chunk,
+                               std::size_t num_chunks)
+{
+  if(chunk == num_chunks)
+    return num_items;
+  return num_items * chunk / num_chunks / simd_width * simd_width;
+}
+
+/// Executes the items of the range \a r in chunks on the host thread pool
+/// once all operations previously enqueued on \a stream have completed.
+template<int dimensions, class Function, class ItemFactory>
+void enqueue_range(const stream_ptr& stream,
+                   Function f,
+                   sycl::range<dimensions> r,
+                   ItemFactory make)
+{
+  const std::size_t num_items = r.size();
+  if(num_items == 0)
+    return;
+
+  enqueue_host_work(stream, [f, r, make, num_items](){
+    host_thread_pool& pool = host_thread_pool::get();
+    const std::size_t num_chunks =
+        std::min((num_items + simd_width - 1) / simd_width,
+                 pool.get_num_threads() * chunks_per_thread);
+
+    pool.run(num_chunks, [&](std::size_t chunk){
+      execute_items_simd(f, r,
+                         chunk_begin(num_items, chunk, num_chunks),
+                         chunk_begin(num_items, chunk + 1, num_chunks),
+                         make);
+    });
+  });
+}
+
+template<int dimensions, class Function>
+void parallel_for(const stream_ptr& stream,
+                  Function f,
+                  sycl::range<dimensions> execution_range)
+{
+  enqueue_range(stream, f, execution_range,
+                [execution_range](const id<dimensions>& idx){
+    return detail::make_item<dimensions>(idx, execution_range);
+  });
+}
+
+template<int dimensions, class Function>
+void parallel_for_with_offset(const stream_ptr& stream,
+                              Function f,
+                              sycl::range<dimensions> execution_range,
+                              id<dimensions> offset)
+{
+  enqueue_range(stream, f, execution_range,
+                [execution_range, offset](const id<dimensions>& idx){
+    return detail::make_item<dimensions>(idx, execution_range, offset);
+  });
+}
+
+/// Combines the partial results of a reduction in order and stores
+/// the result.
+template<class Reduction>
+void store_reduction_result(
+    const Reduction& reduction,
+    const std::vector<typename Reduction::value_type>& partial_results)
+{
+  typename Reduction::value_type result = reduction.get_identity();
+  for(const auto& partial_result : partial_results)
+    result = reduction.combine(result, partial_result);
+  reduction.store_result(result);
+}
+
+/// Executes a range kernel with a reduction once all operations previously
+/// enqueued on \a stream have completed. Each chunk of work items
+/// accumulates into its own reducer, and the partial results of the
+/// chunks are combined once all of them have been executed.
+///
+/// Work items are executed in order, since the accumulation into
+/// the reducer is a dependency between them that prevents vectorization.
+template<int dimensions, class Function, class Reduction>
+void parallel_for_reduction(const stream_ptr& stream,
+                            Function f,
+                            sycl::range<dimensions> execution_range,
+                            Reduction reduction)
+{
+  using value_type = typename Reduction::value_type;
+  using reducer_type = typename Reduction::reducer_type;
+
+  enqueue_host_work(stream, [f, execution_range, reduction](){
+    host_thread_pool& pool = host_thread_pool::get();
+    const std::size_t num_items = execution_range.size();
+    const std::size_t num_chunks =
+        std::min((num_items + simd_width - 1) / simd_width,
+                 pool.get_num_threads() * chunks_per_thread);
+
+    std::vector<value_type> partial_results(num_chunks,
+                                            reduction.get_identity());
+
+    pool.run(num_chunks, [&](std::size_t chunk){
+      reducer_type reducer = reduction.make_reducer();
+      execute_items([&](const item<dimensions, false>& this_item){
+        f(this_item, reducer);
+      }, execution_range,
+      chunk_begin(num_items, chunk, num_chunks),
+      chunk_begin(num_items, chunk + 1, num_chunks),
+      [&](const id<dimensions>& idx){
+        return detail::make_item<dimensions>(idx, execution_range);
+      });
+      partial_results[chunk] = reducer._detail_get_value();
+    });
+
+    store_reduction_result(reduction, partial_results);
+  });
+}
+
+/// Determines whether the work items of an nd_range kernel never
+/// synchronize, i.e. whether its call graph contains no barriers,
+/// memory fences or group functions. The work items of such kernels
+/// can be executed as a loop instead of concurrent hipCPU threads.
+///
+/// This cannot be decided in C++, so all kernels are treated as
+/// synchronizing by default. The hipSYCL clang plugin replaces calls of
+/// this function by true for kernels that it has proven to be barrier-free.
+template<int dimensions, class Function>
+bool barrier_free_kernel_query(void (*)(Function, id<dimensions>))
+{
+  return false;
+}
+
+/// Executes \a execute_group for all work groups once all operations
+/// previously enqueued on \a stream have completed. Work groups are
+/// distributed across the host thread pool. \a execute_group is called
+/// with the work item context of the group, whose local ids it has to set,
+/// and with \a private_mem_size bytes of memory for the group's work items.
+template<int dimensions, class GroupFunction>
+void enqueue_work_groups(const stream_ptr& stream,
+                         sycl::range<dimensions> num_groups,
+                         sycl::range<dimensions> local_size,
+                         std::size_t local_mem_size,
+                         std::size_t private_mem_size,
+                         GroupFunction execute_group)
+{
+  const std::size_t num_work_groups = num_groups.size();
+  if(num_work_groups == 0)
+    return;
+
+  enqueue_host_work(stream, [=](){
+    host_thread_pool& pool = host_thread_pool::get();
+    const std::size_t num_chunks =
+        std::min(num_work_groups, pool.get_num_threads() * chunks_per_thread);
+
+    pool.run(num_chunks, [&](std::size_t chunk){
+      // Local and private memory only need to live as long as one
+      // work group, so the groups of a chunk can share allocations.
+      std::vector<std::max_align_t> local_memory{
+          (local_mem_size + sizeof(std::max_align_t) - 1) /
+          sizeof(std::max_align_t)};
+      std::vector<std::max_align_t> private_memory{
+          (private_mem_size + sizeof(std::max_align_t) - 1) /
+          sizeof(std::max_align_t)};
+
+      host_work_item_context context;
+      for(int i = 0; i < 3; ++i)
+      {
+        context.local_id[i] = 0;
+        context.group_id[i] = 0;
+        context.local_size[i] = i < dimensions ? local_size[i] : 1;
+        context.num_groups[i] = i < dimensions ? num_groups[i] : 1;
+      }
+      context.local_memory = local_memory.data();
+      current_host_work_item() = &context;
+
+      std::size_t begin = num_work_groups * chunk / num_chunks;
+      std::size_t end = num_work_groups * (chunk + 1) / num_chunks;
+      for(std::size_t group_index = begin; group_index < end; ++group_index)
+      {
+        id<dimensions> group_id = delinearize(group_index, num_groups);
+        for(int i = 0; i < dimensions; ++i)
+          context.group_id[i] = group_id[i];
+
+        execute_group(context, private_memory.data());
+      }
+
+      current_host_work_item() = nullptr;
+    });
+  });
+}
+
+/// Executes an nd_range kernel without work item synchronization once all
+/// operations previously enqueued on \a stream have completed. The work
+/// items of a group are executed as a loop by a single thread.
+template<int dimensions, class Function>
+void parallel_for_ndrange(const stream_ptr& stream,
+                          Function f,
+                          sycl::range<dimensions> num_groups,
+                          sycl::range<dimensions> local_size,
+                          id<dimensions> offset,
+                          std::size_t local_mem_size)
+{
+  enqueue_work_groups(stream, num_groups, local_size, local_mem_size, 0,
+                      [f, local_size, offset](host_work_item_context& context,
+                                              void*){
+    id<dimensions> item_offset = offset;
+    execute_items(f, local_size, 0, local_size.size(),
+                  [&](const id<dimensions>& local_id){
+      for(int i = 0; i < dimensions; ++i)
+        context.local_id[i] = local_id[i];
+      return nd_item<dimensions>{&item_offset};
+    });
+  });
+}
+
+/// Presents an nd_range kernel taking a reducer as an ordinary kernel,
+/// such that barrier_free_kernel_query() analyzes the code that
+/// parallel_for_ndrange_reduction() executes.
+template<class Function, class Reducer>
+struct reduction_kernel_adapter
+{
+  const Function* f;
+  Reducer* reducer;
+
+  template<int dimensions>
+  void operator()(const nd_item<dimensions>& this_item) const
+  {
+    (*f)(this_item, *reducer);
+  }
+};
+
+/// Executes an nd_range kernel with a reduction and without work item
+/// synchronization once all operations previously enqueued on \a stream
+/// have completed. The work items of a group accumulate into a reducer
+/// of the group, and the results of the groups are combined once all
+/// groups have been executed.
+template<int dimensions, class Function, class Reduction>
+void parallel_for_ndrange_reduction(const stream_ptr& stream,
+                                    Function f,
+                                    sycl::range<dimensions> num_groups,
+                                    sycl::range<dimensions> local_size,
+                                    id<dimensions> offset,
+                                    std::size_t local_mem_size,
+                                    Reduction reduction)
+{
+  using value_type = typename Reduction::value_type;
+  using reducer_type = typename Reduction::reducer_type;
+
+  auto group_results = std::make_shared<std::vector<value_type>>(
+      num_groups.size(), reduction.get_identity());
+  value_type* results = group_results->data();
+
+  enqueue_work_groups(stream, num_groups, local_size, local_mem_size, 0,
+                      [f, num_groups, local_size, offset, reduction, results](
+                          host_work_item_context& context, void*){
+    id<dimensions> item_offset = offset;
+    reducer_type reducer = reduction.make_reducer();
+    execute_items(reduction_kernel_adapter<Function, reducer_type>{&f, &reducer},
+                  local_size, 0, local_size.size(),
+                  [&](const id<dimensions>& local_id){
+      for(int i = 0; i < dimensions; ++i)
+        context.local_id[i] = local_id[i];
+      return nd_item<dimensions>{&item_offset};
+    });
+
+    id<dimensions> group_id;
+    for(int i = 0; i < dimensions; ++i)
+      group_id[i] = context.group_id[i];
+    results[linear_id<dimensions>::get(group_id, num_groups)] =
+        reducer._detail_get_value();
+  });
+
+  enqueue_host_work(stream, [group_results, reduction](){
+    store_reduction_result(reduction, *group_results);
+  });
+}
+
+/// Executes the work item of an nd_range kernel whose local id is set in
+/// the current work item context, starting after the barrier whose number
+/// is the first argument and returning the number of the next barrier,
+/// or 0 at the end.
+///
+/// As written, this executes the whole work item and ignores the region
+/// as well as the work item frame passed as second argument. The hipSYCL
+/// clang plugin splits the function at barriers and keeps the state of
+/// the work item in the frame between calls if it can.
+template<int dimensions, class Function>
+int work_item_region(int, void*, const Function* f, id<dimensions>* offset)
+{
+  nd_item<dimensions> this_item{offset};
+  (*f)(this_item);
+  return 0;
+}
+
+/// Determines the size of the work item frame of a
+/// work_item_region() instantiation.
+///
+/// 0 means that the function has not been split at barriers, which cannot be
+/// done in C++. The hipSYCL clang plugin replaces calls of this function by
+/// the frame size for functions that it has split.
+template<int dimensions, class Function>
+std::size_t work_item_frame_size_query(
+    int (*)(int, void*, const Function*, id<dimensions>*))
+{
+  return 0;
+}
+
+/// Executes an nd_range kernel whose work_item_region() has been split at
+/// barriers once all operations previously enqueued on \a stream have
+/// completed. Each region between barriers is executed for all work items
+/// of a group before the next one, so that the work items of a group are
+/// executed by a single thread without context switches.
+template<int dimensions, class Function>
+void parallel_for_ndrange_regions(const stream_ptr& stream,
+                                  Function f,
+                                  sycl::range<dimensions> num_groups,
+                                  sycl::range<dimensions> local_size,
+                                  id<dimensions> offset,
+                                  std::size_t local_mem_size,
+                                  std::size_t frame_size)
+{
+  const std::size_t frame_stride =
+      (frame_size + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  enqueue_work_groups(stream, num_groups, local_size, local_mem_size,
+                      frame_stride * local_size.size(),
+                      [f, local_size, offset, frame_stride](
+                          host_work_item_context& context, void* frames){
+    id<dimensions> item_offset = offset;
+    // Barriers are reached by all work items of a group,
+    // so all of them return the same region.
+    int region = 0;
+    do
+    {
+      int next_region = 0;
+      char* frame = static_cast<char*>(frames);
+      execute_items([&](char* item_frame){
+        next_region = work_item_region(region, item_frame, &f, &item_offset);
+      }, local_size, 0, local_size.size(),
+      [&](const id<dimensions>& local_id){
+        for(int i = 0; i < dimensions; ++i)
+          context.local_id[i] = local_id[i];
+
+        char* item_frame = frame;
+        frame += frame_stride;
+        return item_frame;
+      });
+      region = next_region;
+    } while(region != 0);
+  });
+}
+
+}
+}
+}
+}
+
+#endif
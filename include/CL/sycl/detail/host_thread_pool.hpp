@@ -0,0 +1,116 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_HOST_THREAD_POOL_HPP
+#define HIPSYCL_HOST_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <thread>
+
+#include "../types.hpp"
+#include "../backend/backend.hpp"
+#include "stream.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// Threads that execute kernels on the CPU. Work is distributed in
+/// fork-join fashion: run() splits a job into tasks that are picked
+/// up by the worker threads and the calling thread, and returns once
+/// all of them have completed. Jobs submitted by several threads run
+/// concurrently, with the workers helping with the oldest job first.
+class host_thread_pool
+{
+public:
+  /// The pool uses as many threads as there are hardware threads,
+  /// unless specified otherwise with the HIPSYCL_CPU_THREADS
+  /// environment variable.
+  static host_thread_pool& get();
+
+  /// \param num_threads The number of threads executing jobs,
+  /// including the thread calling run()
+  explicit host_thread_pool(std::size_t num_threads);
+  ~host_thread_pool();
+
+  host_thread_pool(const host_thread_pool&) = delete;
+  host_thread_pool& operator=(const host_thread_pool&) = delete;
+
+  using task_function = function_class<void (std::size_t)>;
+
+  /// Executes \c f(i) for all i in [0, num_tasks) and blocks until
+  /// all calls have completed.
+  /// If a call throws, the remaining tasks are skipped and the
+  /// exception is rethrown once the other calls have completed.
+  void run(std::size_t num_tasks, const task_function& f);
+
+  /// \return The number of threads that execute jobs, including
+  /// the thread calling run()
+  std::size_t get_num_threads() const;
+private:
+  struct job
+  {
+    const task_function* f;
+    std::size_t num_tasks;
+    std::atomic<std::size_t> next_task;
+    // Number of workers executing tasks of the job
+    std::size_t num_workers;
+    // The first exception thrown by a task
+    exception_ptr error;
+  };
+
+  void work();
+  void execute_tasks(job& j);
+  // The mutex must be locked
+  void remove_job(job& j);
+
+  vector_class<std::thread> _workers;
+
+  mutex_class _mutex;
+  std::condition_variable _job_available;
+  std::condition_variable _job_done;
+
+  // Jobs that may still have tasks left. They live on the stack of
+  // the thread calling run().
+  std::deque<job*> _jobs;
+  bool _shutdown;
+};
+
+/// Executes \a f on the host once all operations previously enqueued
+/// on \a stream have completed. Later operations on the stream wait
+/// until \a f has returned. Exceptions thrown by \a f are passed to the
+/// error handler of the stream.
+void enqueue_host_work(const stream_ptr& stream, function_class<void ()> f);
+
+}
+}
+}
+
+#endif
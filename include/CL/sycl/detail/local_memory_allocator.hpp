@@ -29,6 +29,7 @@
 #define HIPSYCL_LOCAL_MEM_ALLOCATOR_HPP
 
 #include "../backend/backend.hpp"
+#include "thread_hierarchy.hpp"
 
 #include <cstdlib>
 
@@ -105,8 +106,14 @@ public:
     extern __shared__ local_memory_allocator::smallest_type local_mem_data [];
     return reinterpret_cast<T*>(reinterpret_cast<char*>(local_mem_data) + addr);
 #elif defined(__HIPCPU__)
+    void* shared_memory = HIP_DYNAMIC_SHARED_MEMORY;
+#ifdef HIPSYCL_PLATFORM_CPU
+    if(host_work_item_context* context = current_host_work_item())
+      shared_memory = context->local_memory;
+#endif
+
     local_memory_allocator::smallest_type* local_mem_data =
-      static_cast<local_memory_allocator::smallest_type*>(HIP_DYNAMIC_SHARED_MEMORY);
+      static_cast<local_memory_allocator::smallest_type*>(shared_memory);
     return reinterpret_cast<T*>(reinterpret_cast<char*>(local_mem_data) + addr);
 #else
     // The __host__ case without hipCPU is not yet supported
@@ -0,0 +1,152 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_MPSC_QUEUE_HPP
+#define HIPSYCL_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cassert>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// A bounded, lock-free multi-producer/single-consumer ring buffer.
+/// Each slot carries a sequence number that tells producers and the
+/// consumer whether the slot is free or holds a published element,
+/// so neither side ever needs to take a lock.
+///
+/// push() may be called concurrently from any number of threads,
+/// pop() and empty() must only be called from the consumer thread.
+template<class T>
+class bounded_mpsc_queue
+{
+public:
+  /// \param capacity The maximum number of elements. Must be
+  /// a power of two.
+  explicit bounded_mpsc_queue(std::size_t capacity)
+    : _cells{new cell[capacity]},
+      _mask{capacity - 1},
+      _enqueue_pos{0},
+      _dequeue_pos{0}
+  {
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+
+    for(std::size_t i = 0; i < capacity; ++i)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  bounded_mpsc_queue(const bounded_mpsc_queue&) = delete;
+  bounded_mpsc_queue& operator=(const bounded_mpsc_queue&) = delete;
+
+  /// Tries to append an element.
+  /// \return false if the queue is full, in which case \c value
+  /// is left untouched.
+  bool push(T&& value)
+  {
+    cell* c = nullptr;
+    std::size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      c = &_cells[pos & _mask];
+      std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+      if(diff == 0)
+      {
+        // The slot is free - try to claim it
+        if(_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0)
+        // The slot still holds an element from the previous round
+        return false;
+      else
+        pos = _enqueue_pos.load(std::memory_order_relaxed);
+    }
+
+    c->value = std::move(value);
+    // Publish the element to the consumer
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Removes the oldest element.
+  /// \return false if the queue is empty
+  bool pop(T& out)
+  {
+    cell* c = &_cells[_dequeue_pos & _mask];
+    std::size_t seq = c->sequence.load(std::memory_order_acquire);
+
+    if(seq != _dequeue_pos + 1)
+      return false;
+
+    out = std::move(c->value);
+    c->value = T{};
+    // Hand the slot back to the producers for the next round
+    c->sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+    ++_dequeue_pos;
+    return true;
+  }
+
+  /// \return whether there are no published elements that
+  /// the consumer could pop.
+  bool empty() const
+  {
+    const cell* c = &_cells[_dequeue_pos & _mask];
+    return c->sequence.load(std::memory_order_acquire) != _dequeue_pos + 1;
+  }
+
+  std::size_t capacity() const
+  {
+    return _mask + 1;
+  }
+private:
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<cell[]> _cells;
+  const std::size_t _mask;
+
+  // Keep producer and consumer positions on separate cache lines
+  std::atomic<std::size_t> _enqueue_pos;
+  char _padding[64];
+  std::size_t _dequeue_pos;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_POOL_ALLOCATOR_HPP
+#define HIPSYCL_POOL_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <mutex>
+#include <memory>
+
+#include "../types.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// A thread-safe pool of equally sized memory blocks. Blocks are
+/// allocated in slabs and recycled through a free list, so that
+/// in steady state, allocations do not reach the system allocator.
+/// Memory is never returned to the system.
+template<std::size_t BlockSize, std::size_t Alignment>
+class fixed_size_pool
+{
+public:
+  static constexpr std::size_t blocks_per_slab = 64;
+
+  /// \return the pool for the given block size and alignment.
+  static fixed_size_pool& get()
+  {
+    // Intentionally leaked: Blocks may be released during static
+    // destruction (e.g. when the runtime shuts down), so the pool
+    // must outlive all other static objects.
+    static fixed_size_pool* pool = new fixed_size_pool;
+    return *pool;
+  }
+
+  void* allocate()
+  {
+    std::lock_guard<mutex_class> lock{_mutex};
+
+    if(_free_list == nullptr)
+      this->allocate_slab();
+
+    free_block* block = _free_list;
+    _free_list = block->next;
+    return block;
+  }
+
+  void release(void* ptr)
+  {
+    std::lock_guard<mutex_class> lock{_mutex};
+
+    free_block* block = static_cast<free_block*>(ptr);
+    block->next = _free_list;
+    _free_list = block;
+  }
+private:
+  fixed_size_pool() = default;
+
+  union free_block
+  {
+    free_block* next;
+    typename std::aligned_storage<BlockSize, Alignment>::type storage;
+  };
+
+  void allocate_slab()
+  {
+    // Slab memory is obtained through new[] of the block type
+    // itself, which guarantees correct alignment.
+    free_block* slab = new free_block[blocks_per_slab];
+    for(std::size_t i = 0; i < blocks_per_slab; ++i)
+    {
+      slab[i].next = _free_list;
+      _free_list = &slab[i];
+    }
+  }
+
+  mutex_class _mutex;
+  free_block* _free_list = nullptr;
+};
+
+/// Standard-conforming allocator that serves single-object allocations
+/// from a fixed_size_pool. This is mainly intended for use with
+/// std::allocate_shared(), which allocates exactly one object
+/// (including the control block) at a time. Array allocations are
+/// forwarded to the regular allocator.
+template<class T>
+class pool_allocator
+{
+public:
+  using value_type = T;
+
+  pool_allocator() noexcept = default;
+
+  template<class U>
+  pool_allocator(const pool_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n)
+  {
+    if(n == 1)
+      return static_cast<T*>(get_pool().allocate());
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n)
+  {
+    if(n == 1)
+      get_pool().release(ptr);
+    else
+      std::allocator<T>{}.deallocate(ptr, n);
+  }
+
+  template<class U>
+  bool operator==(const pool_allocator<U>&) const noexcept
+  { return true; }
+
+  template<class U>
+  bool operator!=(const pool_allocator<U>&) const noexcept
+  { return false; }
+private:
+  static fixed_size_pool<sizeof(T), alignof(T)>& get_pool()
+  {
+    return fixed_size_pool<sizeof(T), alignof(T)>::get();
+  }
+};
+
+}
+}
+}
+
+#endif
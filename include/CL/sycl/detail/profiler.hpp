@@ -0,0 +1,93 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_PROFILER_HPP
+#define HIPSYCL_PROFILER_HPP
+
+#include "../types.hpp"
+#include "../backend/backend.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+class profiling_reference;
+
+/// Records the timestamps of a single task for
+/// event::get_profiling_info(). All timestamps are given in
+/// nanoseconds of the host's steady clock, such that timestamps
+/// of different tasks (even on different devices) are comparable.
+class task_profiler
+{
+public:
+  /// Records the submission time
+  task_profiler();
+  ~task_profiler();
+
+  task_profiler(const task_profiler&) = delete;
+  task_profiler& operator=(const task_profiler&) = delete;
+
+  /// Enqueues the start event on the given stream. The device of
+  /// the stream must be active.
+  void record_start(hipStream_t stream);
+  /// Enqueues the end event on the given stream. Must be
+  /// called after record_start().
+  void record_end(hipStream_t stream);
+
+  /// \return The time at which the task was submitted to the runtime
+  cl_ulong get_submit_time() const;
+  /// \return The time at which the task started executing on the device.
+  /// Blocks until the start event has completed.
+  cl_ulong get_start_time() const;
+  /// \return The time at which the task finished executing on the device.
+  /// Blocks until the end event has completed.
+  cl_ulong get_end_time() const;
+
+  /// \return Whether both start and end event have been recorded.
+  bool has_device_timestamps() const;
+
+  /// \return The current time of the host clock in nanoseconds
+  static cl_ulong get_host_time();
+private:
+  cl_ulong get_event_time(hipEvent_t evt) const;
+
+  cl_ulong _submit_time;
+
+  hipEvent_t _start;
+  hipEvent_t _end;
+
+  // Device events can only be related to each other, so they are
+  // converted to host time using a reference event whose host
+  // time is known.
+  shared_ptr_class<profiling_reference> _reference;
+};
+
+}
+}
+}
+
+#endif
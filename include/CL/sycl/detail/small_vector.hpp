@@ -0,0 +1,343 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_SMALL_VECTOR_HPP
+#define HIPSYCL_SMALL_VECTOR_HPP
+
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// A vector that stores up to N elements inline, and only allocates
+/// heap memory once it grows beyond that. Used for the short lists that
+/// the runtime creates for every command group (e.g. the regions of
+/// a buffer that an accessor covers), where a std::vector would
+/// allocate on every submission.
+///
+/// Iterators are plain pointers and are invalidated by any operation
+/// that changes the size, as well as by moves and swaps.
+template<class T, std::size_t N>
+class small_vector
+{
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static_assert(N > 0, "small_vector requires inline capacity");
+
+  small_vector() noexcept
+    : _data{inline_data()}, _size{0}, _capacity{N}
+  {}
+
+  small_vector(std::initializer_list<T> init)
+    : small_vector(init.begin(), init.end())
+  {}
+
+  template<class InputIt,
+           class = typename std::iterator_traits<InputIt>::iterator_category>
+  small_vector(InputIt first, InputIt last)
+    : small_vector()
+  {
+    insert(end(), first, last);
+  }
+
+  small_vector(const small_vector& other)
+    : small_vector(other.begin(), other.end())
+  {}
+
+  small_vector(small_vector&& other) noexcept
+    : small_vector()
+  {
+    take(std::move(other));
+  }
+
+  ~small_vector()
+  {
+    clear();
+    release_heap();
+  }
+
+  small_vector& operator=(const small_vector& other)
+  {
+    if(this != &other)
+    {
+      clear();
+      insert(end(), other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  small_vector& operator=(small_vector&& other) noexcept
+  {
+    if(this != &other)
+    {
+      clear();
+      release_heap();
+      take(std::move(other));
+    }
+    return *this;
+  }
+
+  small_vector& operator=(std::initializer_list<T> init)
+  {
+    clear();
+    insert(end(), init.begin(), init.end());
+    return *this;
+  }
+
+  iterator begin() noexcept { return _data; }
+  const_iterator begin() const noexcept { return _data; }
+  iterator end() noexcept { return _data + _size; }
+  const_iterator end() const noexcept { return _data + _size; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  T* data() noexcept { return _data; }
+  const T* data() const noexcept { return _data; }
+
+  size_type size() const noexcept { return _size; }
+  size_type capacity() const noexcept { return _capacity; }
+  bool empty() const noexcept { return _size == 0; }
+
+  T& operator[](size_type i) { assert(i < _size); return _data[i]; }
+  const T& operator[](size_type i) const { assert(i < _size); return _data[i]; }
+
+  T& front() { assert(!empty()); return _data[0]; }
+  const T& front() const { assert(!empty()); return _data[0]; }
+  T& back() { assert(!empty()); return _data[_size - 1]; }
+  const T& back() const { assert(!empty()); return _data[_size - 1]; }
+
+  void reserve(size_type new_capacity)
+  {
+    if(new_capacity <= _capacity)
+      return;
+
+    T* new_data = static_cast<T*>(::operator new(new_capacity * sizeof(T)));
+    for(size_type i = 0; i < _size; ++i)
+    {
+      new (new_data + i) T(std::move(_data[i]));
+      _data[i].~T();
+    }
+    release_heap();
+    _data = new_data;
+    _capacity = new_capacity;
+  }
+
+  /// Releases unused heap memory, moving the elements back
+  /// into the inline storage if they fit.
+  void shrink_to_fit()
+  {
+    if(is_inline() || _size == _capacity)
+      return;
+
+    small_vector shrunk;
+    shrunk.reserve(_size);
+    for(T& element : *this)
+      shrunk.emplace_back(std::move(element));
+    *this = std::move(shrunk);
+  }
+
+  void clear() noexcept
+  {
+    for(size_type i = 0; i < _size; ++i)
+      _data[i].~T();
+    _size = 0;
+  }
+
+  void push_back(const T& value)
+  {
+    emplace_back(value);
+  }
+
+  void push_back(T&& value)
+  {
+    emplace_back(std::move(value));
+  }
+
+  template<class... Args>
+  T& emplace_back(Args&&... args)
+  {
+    if(_size == _capacity)
+    {
+      // The arguments may refer to an element of this vector
+      T value(std::forward<Args>(args)...);
+      reserve(2 * _capacity);
+      new (_data + _size) T(std::move(value));
+    }
+    else
+      new (_data + _size) T(std::forward<Args>(args)...);
+    return _data[_size++];
+  }
+
+  void pop_back()
+  {
+    assert(!empty());
+    _data[--_size].~T();
+  }
+
+  void resize(size_type new_size)
+  {
+    if(new_size < _size)
+      erase(begin() + new_size, end());
+    else
+    {
+      reserve(new_size);
+      while(_size < new_size)
+        emplace_back();
+    }
+  }
+
+  /// Inserts the elements [first, last), which must not refer
+  /// to elements of this vector.
+  template<class InputIt,
+           class = typename std::iterator_traits<InputIt>::iterator_category>
+  iterator insert(const_iterator pos, InputIt first, InputIt last)
+  {
+    const size_type offset = pos - begin();
+    const size_type old_size = _size;
+    for(; first != last; ++first)
+      emplace_back(*first);
+    std::rotate(begin() + offset, begin() + old_size, end());
+    return begin() + offset;
+  }
+
+  iterator insert(const_iterator pos, T value)
+  {
+    const size_type offset = pos - begin();
+    emplace_back(std::move(value));
+    std::rotate(begin() + offset, end() - 1, end());
+    return begin() + offset;
+  }
+
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    iterator dest = begin() + (first - begin());
+    iterator src = begin() + (last - begin());
+    iterator new_end = std::move(src, end(), dest);
+    for(iterator it = new_end; it != end(); ++it)
+      it->~T();
+    _size = new_end - begin();
+    return dest;
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    return erase(pos, pos + 1);
+  }
+
+  void swap(small_vector& other) noexcept
+  {
+    small_vector tmp{std::move(other)};
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend bool operator==(const small_vector& a, const small_vector& b)
+  {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+  }
+
+  friend bool operator!=(const small_vector& a, const small_vector& b)
+  {
+    return !(a == b);
+  }
+private:
+  T* inline_data() noexcept
+  {
+    return reinterpret_cast<T*>(&_inline_storage);
+  }
+
+  bool is_inline() const noexcept
+  {
+    return _data == reinterpret_cast<const T*>(&_inline_storage);
+  }
+
+  void release_heap() noexcept
+  {
+    if(!is_inline())
+      ::operator delete(_data);
+    _data = inline_data();
+    _capacity = N;
+  }
+
+  /// Takes over the elements of \a other, which must be empty
+  /// and inline in this vector.
+  void take(small_vector&& other) noexcept
+  {
+    if(other.is_inline())
+    {
+      for(size_type i = 0; i < other._size; ++i)
+        new (_data + i) T(std::move(other._data[i]));
+      _size = other._size;
+      other.clear();
+    }
+    else
+    {
+      // Steal the heap allocation
+      _data = other._data;
+      _size = other._size;
+      _capacity = other._capacity;
+      other._data = other.inline_data();
+      other._size = 0;
+      other._capacity = N;
+    }
+  }
+
+  typename std::aligned_storage<N * sizeof(T), alignof(T)>::type _inline_storage;
+  T* _data;
+  size_type _size;
+  size_type _capacity;
+};
+
+template<class T, std::size_t N>
+void swap(small_vector<T, N>& a, small_vector<T, N>& b) noexcept
+{
+  a.swap(b);
+}
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_STAGING_BUFFER_POOL_HPP
+#define HIPSYCL_STAGING_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include "../types.hpp"
+#include "../backend/backend.hpp"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// A ring of pinned host memory blocks, through which transfers
+/// from or to pageable host memory are staged. Such transfers are
+/// otherwise effectively synchronous and run at reduced bandwidth.
+/// Transfers are split into block-sized chunks, such that the
+/// host-side memcpy of one chunk overlaps with the DMA of another.
+/// Blocks are reused once the DMA that has last used them has completed.
+/// If all blocks are in use by other threads, the ring grows.
+class staging_buffer_pool
+{
+public:
+  static constexpr std::size_t block_size = 2 * 1024 * 1024;
+  static constexpr std::size_t initial_num_blocks = 4;
+  /// Smaller transfers are not worth splitting into chunks and
+  /// are passed directly to the backend.
+  static constexpr std::size_t min_staged_size = 256 * 1024;
+
+  static staging_buffer_pool& get();
+
+  staging_buffer_pool();
+  ~staging_buffer_pool();
+
+  staging_buffer_pool(const staging_buffer_pool&) = delete;
+  staging_buffer_pool& operator=(const staging_buffer_pool&) = delete;
+
+  /// Enqueues a copy from (pageable) host memory to the device.
+  /// When this function returns, the host memory may be modified.
+  void memcpy_h2d(void* device, const void* host,
+                  std::size_t len, hipStream_t stream);
+
+  /// Copies from the device to (pageable) host memory once all
+  /// operations previously enqueued on the stream have completed.
+  /// Blocks until the data has arrived on the host.
+  void memcpy_d2h(void* host, const void* device,
+                  std::size_t len, hipStream_t stream);
+
+  /// \return The number of staging blocks that have been allocated
+  std::size_t get_num_blocks() const;
+private:
+  struct staging_block
+  {
+    void* ptr;
+    // Recorded after the last DMA using the block
+    hipEvent_t last_use;
+    bool acquired;
+  };
+
+  /// Obtains a block that is not in use by another thread, and
+  /// waits until its last DMA has completed.
+  /// \return nullptr if no pinned memory could be allocated
+  staging_block* acquire();
+  /// Returns a block to the ring once the operations enqueued
+  /// on the given stream so far have completed.
+  void release(staging_block* block, hipStream_t stream);
+  /// Returns a block to the ring whose DMA has completed
+  void release(staging_block* block);
+
+  /// \return nullptr if no pinned memory could be allocated
+  std::unique_ptr<staging_block> allocate_block() const;
+
+  vector_class<std::unique_ptr<staging_block>> _blocks;
+  std::size_t _next_block;
+
+  mutable mutex_class _mutex;
+};
+
+}
+}
+}
+
+#endif
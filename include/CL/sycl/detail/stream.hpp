@@ -32,12 +32,16 @@
 #include "../types.hpp"
 #include "../device.hpp"
 
+#include <atomic>
+
 namespace cl {
 namespace sycl {
 
 
 namespace detail {
 
+class command_graph_recorder;
+
 class stream_manager;
 using stream_ptr = shared_ptr_class<stream_manager>;
 
@@ -79,11 +83,31 @@ public:
   /// \return The error handler associated with this
   /// stream
   async_handler get_error_handler() const;
+
+  /// Sets the recorder that records operations submitted to
+  /// this stream, or nullptr to stop recording. The recorder
+  /// is not owned by the stream manager.
+  void set_recorder(command_graph_recorder* recorder);
+
+  /// \return The active recorder, or nullptr if operations
+  /// submitted to this stream are not being recorded.
+  command_graph_recorder* get_recorder() const;
+
+  /// Enables or disables recording of profiling timestamps
+  /// for tasks submitted to this stream.
+  void set_profiling_enabled(bool enabled);
+
+  /// \return Whether tasks submitted to this stream record
+  /// profiling timestamps.
+  bool is_profiling_enabled() const;
 private:
   hipStream_t _stream;
 
   device _dev;
   async_handler _handler;
+
+  std::atomic<command_graph_recorder*> _recorder;
+  bool _profiling_enabled;
 };
 
 
@@ -0,0 +1,221 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_TASK_FUNCTOR_HPP
+#define HIPSYCL_TASK_FUNCTOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+enum class task_state
+{
+  enqueued,
+  complete
+};
+
+/// A move-only callable wrapper for the operations executed by
+/// task graph nodes. Unlike function_class<task_state()>, callables
+/// up to \c inline_capacity bytes - which includes the kernel launch
+/// lambdas of 3D kernels with a few accessors - are stored inline
+/// without any heap allocation. Larger callables are stored on the heap.
+class task_functor
+{
+public:
+  static constexpr std::size_t inline_capacity = 512;
+
+  task_functor() noexcept
+    : _vtable{nullptr}
+  {}
+
+  task_functor(std::nullptr_t) noexcept
+    : _vtable{nullptr}
+  {}
+
+  template<class F,
+           std::enable_if_t<
+             !std::is_same<std::decay_t<F>, task_functor>::value, int> = 0>
+  task_functor(F&& f)
+    : _vtable{nullptr}
+  {
+    using callable_type = std::decay_t<F>;
+
+    construct(std::forward<F>(f),
+              std::integral_constant<bool,
+                is_stored_inline<callable_type>()>{});
+  }
+
+  task_functor(task_functor&& other) noexcept
+    : _vtable{other._vtable}
+  {
+    if(_vtable)
+    {
+      _vtable->move(&other._storage, &_storage);
+      other._vtable = nullptr;
+    }
+  }
+
+  task_functor& operator=(task_functor&& other) noexcept
+  {
+    if(this != &other)
+    {
+      reset();
+      if(other._vtable)
+      {
+        other._vtable->move(&other._storage, &_storage);
+        _vtable = other._vtable;
+        other._vtable = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  task_functor(const task_functor&) = delete;
+  task_functor& operator=(const task_functor&) = delete;
+
+  ~task_functor()
+  {
+    reset();
+  }
+
+  task_state operator()()
+  {
+    assert(_vtable != nullptr);
+    return _vtable->invoke(&_storage);
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return _vtable != nullptr;
+  }
+
+  /// \return whether a callable of type \c F is stored without
+  /// heap allocation
+  template<class F>
+  static constexpr bool is_stored_inline()
+  {
+    return sizeof(F) <= inline_capacity &&
+           alignof(F) <= alignof(storage_type) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+private:
+  using storage_type =
+    std::aligned_storage_t<inline_capacity, alignof(std::max_align_t)>;
+
+  struct vtable
+  {
+    task_state (*invoke)(void*);
+    // Move-constructs the callable at dest from src and destroys src
+    void (*move)(void* src, void* dest);
+    void (*destroy)(void*);
+  };
+
+  template<class F>
+  struct inline_vtable
+  {
+    static task_state invoke(void* storage)
+    { return (*static_cast<F*>(storage))(); }
+
+    static void move(void* src, void* dest) noexcept
+    {
+      F* src_callable = static_cast<F*>(src);
+      new (dest) F(std::move(*src_callable));
+      src_callable->~F();
+    }
+
+    static void destroy(void* storage) noexcept
+    { static_cast<F*>(storage)->~F(); }
+
+    static constexpr vtable table = {&invoke, &move, &destroy};
+  };
+
+  template<class F>
+  struct heap_vtable
+  {
+    static task_state invoke(void* storage)
+    { return (**static_cast<F**>(storage))(); }
+
+    static void move(void* src, void* dest) noexcept
+    { new (dest) F*(*static_cast<F**>(src)); }
+
+    static void destroy(void* storage) noexcept
+    { delete *static_cast<F**>(storage); }
+
+    static constexpr vtable table = {&invoke, &move, &destroy};
+  };
+
+  // The storage is selected at compile time, such that callables
+  // are never constructed inline if they do not fit.
+  template<class F>
+  void construct(F&& f, std::true_type)
+  {
+    using callable_type = std::decay_t<F>;
+
+    new (&_storage) callable_type(std::forward<F>(f));
+    _vtable = &inline_vtable<callable_type>::table;
+  }
+
+  template<class F>
+  void construct(F&& f, std::false_type)
+  {
+    using callable_type = std::decay_t<F>;
+
+    callable_type* heap_callable = new callable_type(std::forward<F>(f));
+    new (&_storage) callable_type*(heap_callable);
+    _vtable = &heap_vtable<callable_type>::table;
+  }
+
+  void reset() noexcept
+  {
+    if(_vtable)
+    {
+      _vtable->destroy(&_storage);
+      _vtable = nullptr;
+    }
+  }
+
+  storage_type _storage;
+  const vtable* _vtable;
+};
+
+template<class F>
+constexpr task_functor::vtable task_functor::inline_vtable<F>::table;
+
+template<class F>
+constexpr task_functor::vtable task_functor::heap_vtable<F>::table;
+
+}
+}
+}
+
+#endif
@@ -33,23 +33,55 @@
 
 #include "stream.hpp"
 #include "async_worker.hpp"
+#include "task_functor.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include "small_vector.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <memory>
 
 namespace cl {
 namespace sycl {
 namespace detail {
 
-enum class task_state
+
+/// Determines how threads that wait for the completion of a task
+/// (e.g. in event::wait(), queue::wait() or when constructing a
+/// host accessor) behave. In any case, waiting threads first spin,
+/// then yield and finally block until the task has completed.
+enum class wait_policy
 {
-  enqueued,
-  complete
+  /// Spin and yield for a comparatively long time before blocking.
+  /// Minimizes the latency of waiting on short tasks.
+  latency,
+  /// Block after spinning very briefly, leaving the CPU to
+  /// the threads that perform actual work.
+  cpu_efficiency
 };
 
-using task_functor = function_class<task_state ()>;
+/// Describes what a task does when it is executed, and hence
+/// when it may be submitted.
+enum class task_execution_kind
+{
+  /// The task only enqueues operations on its stream. It may be
+  /// submitted as soon as requirements on the same stream have been
+  /// submitted, since the stream guarantees the correct ordering.
+  /// Requirements on other streams must still complete first.
+  stream_ordered,
+  /// The task may perform work on the host that relies on
+  /// all requirements having completed.
+  host_synchronized
+};
 
 class task_graph_node;
 using task_graph_node_ptr = shared_ptr_class<task_graph_node>;
+/// Requirements and dependencies of a task. Most tasks only have a
+/// few, so the list does not allocate for those.
+using task_graph_node_list = small_vector<task_graph_node_ptr, 4>;
+/// Successors of a task, which are not kept alive by it
+using task_graph_successor_list = small_vector<task_graph_node*, 4>;
 
 class task_graph;
 
@@ -57,10 +89,14 @@ class task_graph_node
 {
 public:
   task_graph_node(task_functor tf,
-                  const vector_class<task_graph_node_ptr>& requirements,
+                  task_graph_node_list requirements,
                   stream_ptr stream,
                   async_handler error_handler,
-                  task_graph* tgraph);
+                  task_graph* tgraph,
+                  task_execution_kind kind = task_execution_kind::host_synchronized,
+                  const char* label = nullptr);
+
+  ~task_graph_node();
 
   void wait();
   bool is_submitted() const;
@@ -81,31 +117,122 @@ public:
 
   detail::stream_ptr get_stream() const;
 
-  void set_done();
+  /// Marks the node as done and notifies all successors.
+  /// Successors that have become ready are handed to the
+  /// task graph for submission.
+  /// \return whether any successor has become ready
+  bool set_done();
+
+  /// Registers the node as successor of all its requirements
+  /// that have not yet completed. For stream ordered nodes,
+  /// requirements on the same stream only need to be submitted.
+  /// \return whether the node is ready for submission, i.e. all
+  /// requirements have already completed (or been submitted).
+  bool register_with_requirements();
 
-  const vector_class<task_graph_node_ptr>& get_requirements() const;
+  /// \return The requirements of this node. Since requirements are
+  /// released once the node has been submitted, this is empty
+  /// for submitted nodes.
+  const task_graph_node_list& get_requirements() const;
 
   async_handler get_error_handler() const;
+
+  /// \return The profiler recording the timestamps of this node,
+  /// or nullptr if profiling is not enabled for its stream.
+  const task_profiler* get_profiler() const;
+
+  /// \return The data recorded by the tracer for this node,
+  /// or nullptr if tracing is disabled.
+  const node_trace_info* get_trace_info() const;
+
+  /// \return The number of task graph nodes that currently exist
+  /// in the application, including nodes that have completed
+  /// but are still referenced (e.g. by events or buffers).
+  static std::size_t get_num_live_nodes();
 private:
+  void release_requirements();
+
+  /// Adds a node that should be notified once this node
+  /// has completed.
+  /// \return false if this node has already completed, in which
+  /// case the successor is not added.
+  bool add_successor(task_graph_node* successor);
+
+  /// Adds a node that should be notified once this node
+  /// has been submitted.
+  /// \return false if this node has already been submitted, in which
+  /// case the successor is not added.
+  bool add_submission_successor(task_graph_node* successor);
+
+  bool is_on_same_stream(const task_graph_node& other) const;
+
+  /// Notifies the node that one of its requirements has completed,
+  /// or, for stream ordered requirements, has been submitted.
+  /// \return whether the node has become ready.
+  bool requirement_done();
+
   std::atomic<bool> _submitted;
   std::atomic<bool> _task_done;
 
   task_functor _tf;
-  vector_class<task_graph_node_ptr> _requirements;
+  task_graph_node_list _requirements;
+
+  // Number of requirements that have not completed (or been submitted,
+  // see task_execution_kind) yet, plus one for the registration itself
+  // (see register_with_requirements()).
+  std::atomic<int> _num_unmet_requirements;
+  // Successors are guaranteed to stay alive until we have notified them,
+  // since they hold a reference to this node and cannot be submitted
+  // (and thus purged) before this node has completed.
+  task_graph_successor_list _successors;
+  // Successors on the same stream that only wait for our submission
+  task_graph_successor_list _submission_successors;
+  // Set once the successors have been taken for notification by
+  // set_done(). Unlike _task_done, this is only accessed under
+  // _successor_mutex, so the node stays alive while it is set.
+  bool _successors_closed;
+  mutex_class _successor_mutex;
+
+  task_execution_kind _execution_kind;
 
   stream_ptr _stream;
   async_handler _handler;
 
   task_graph* _parent_graph;
+
+  std::unique_ptr<task_profiler> _profiler;
+  std::unique_ptr<node_trace_info> _trace;
 };
 
 class task_graph
 {
 public:
+  /// Initializes the wait policy from the HIPSYCL_WAIT_POLICY
+  /// environment variable (either "latency" or "cpu_efficiency").
+  task_graph();
+
+  /// \param label A static string describing the task in traces,
+  /// e.g. obtained from get_kernel_label().
   task_graph_node_ptr insert(task_functor tf,
-                             const vector_class<task_graph_node_ptr>& requirements,
+                             task_graph_node_list requirements,
                              detail::stream_ptr stream,
-                             async_handler handler);
+                             async_handler handler,
+                             task_execution_kind kind =
+                               task_execution_kind::host_synchronized,
+                             const char* label = nullptr);
+
+  /// Inserts a task asynchronously from the worker thread of the graph.
+  /// Unlike insert(), this may be called while the calling thread
+  /// holds a lock on the graph, e.g. when the last reference to a buffer
+  /// is dropped because a task has been submitted and has released its
+  /// functor.
+  void insert_deferred(task_functor tf,
+                       task_graph_node_list requirements,
+                       detail::stream_ptr stream,
+                       async_handler handler,
+                       task_execution_kind kind =
+                         task_execution_kind::host_synchronized,
+                       const char* label = nullptr);
 
   void finish();
   void finish(detail::stream_ptr stream);
@@ -121,15 +248,47 @@ public:
 
   /// Handler that is executed when a task has finished.
   void invoke_async_submission(async_handler error_handler);
+
+  /// Adds a node whose requirements have all completed to
+  /// the queue of nodes awaiting submission.
+  void add_ready_node(task_graph_node* node);
+
+  void set_wait_policy(wait_policy policy);
+  wait_policy get_wait_policy() const;
+
+  /// Blocks until the given node has completed, spinning
+  /// and yielding first as dictated by the wait policy.
+  void wait_until_done(const task_graph_node* node);
+
+  /// Wakes up threads blocked in wait_until_done().
+  /// Called by nodes once they have completed.
+  void notify_node_completed();
 private:
   void purge_finished_tasks();
   void submit_eligible_tasks();
 
   vector_class<task_graph_node_ptr> _nodes;
+  std::size_t _purge_threshold = 0;
 
   mutex_class _mutex;
 
+  vector_class<task_graph_node*> _ready_nodes;
+  mutex_class _ready_mutex;
+  // Ready nodes that are being submitted, swapped with _ready_nodes
+  // such that both keep their capacity. Protected by _mutex.
+  vector_class<task_graph_node*> _submitting_nodes;
+
   worker_thread _worker;
+  std::atomic<bool> _async_submission_pending{false};
+  // Error handler for the pending graph update. Only written by the
+  // thread that sets _async_submission_pending, and taken by the
+  // worker before clearing it.
+  async_handler _async_submission_handler;
+
+  std::atomic<wait_policy> _wait_policy;
+  std::atomic<int> _num_blocked_waiters{0};
+  mutex_class _completion_mutex;
+  std::condition_variable _node_completed;
 
   std::atomic<int> _num_open_callbacks;
 };
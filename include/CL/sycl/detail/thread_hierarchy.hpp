@@ -37,35 +37,88 @@ namespace cl {
 namespace sycl {
 namespace detail {
 
+#ifdef HIPSYCL_PLATFORM_CPU
+/// Position of the calling thread in an nd_range kernel whose work items
+/// are executed as loops by the hipSYCL runtime instead of hipCPU threads
+/// (see host_dispatch.hpp). Entries are indexed by dimension; unused
+/// dimensions hold id 0 and size 1.
+struct host_work_item_context
+{
+  size_t local_id[3];
+  size_t group_id[3];
+  size_t local_size[3];
+  size_t num_groups[3];
+  void* local_memory;
+};
+
+/// \return The context of the calling thread, or nullptr if the work
+/// item is executed by hipCPU.
+inline host_work_item_context*& current_host_work_item()
+{
+  static thread_local host_work_item_context* context = nullptr;
+  return context;
+}
+
+#define HIPSYCL_HOST_CONTEXT_OR_BUILTIN(member, dim, builtin) \
+  (current_host_work_item() ? current_host_work_item()->member[dim] \
+                            : static_cast<size_t>(builtin))
+#else
+#define HIPSYCL_HOST_CONTEXT_OR_BUILTIN(member, dim, builtin) (builtin)
+#endif
+
+#define HIPSYCL_THREAD_IDX_X \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_id, 0, hipThreadIdx_x)
+#define HIPSYCL_THREAD_IDX_Y \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_id, 1, hipThreadIdx_y)
+#define HIPSYCL_THREAD_IDX_Z \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_id, 2, hipThreadIdx_z)
+#define HIPSYCL_BLOCK_IDX_X \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(group_id, 0, hipBlockIdx_x)
+#define HIPSYCL_BLOCK_IDX_Y \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(group_id, 1, hipBlockIdx_y)
+#define HIPSYCL_BLOCK_IDX_Z \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(group_id, 2, hipBlockIdx_z)
+#define HIPSYCL_BLOCK_DIM_X \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_size, 0, hipBlockDim_x)
+#define HIPSYCL_BLOCK_DIM_Y \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_size, 1, hipBlockDim_y)
+#define HIPSYCL_BLOCK_DIM_Z \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(local_size, 2, hipBlockDim_z)
+#define HIPSYCL_GRID_DIM_X \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(num_groups, 0, hipGridDim_x)
+#define HIPSYCL_GRID_DIM_Y \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(num_groups, 1, hipGridDim_y)
+#define HIPSYCL_GRID_DIM_Z \
+  HIPSYCL_HOST_CONTEXT_OR_BUILTIN(num_groups, 2, hipGridDim_z)
 
 inline __device__ size_t get_global_id_x()
 {
-  return hipBlockIdx_x * hipBlockDim_x + hipThreadIdx_x;
+  return HIPSYCL_BLOCK_IDX_X * HIPSYCL_BLOCK_DIM_X + HIPSYCL_THREAD_IDX_X;
 }
 
 inline __device__ size_t get_global_id_y()
 {
-  return hipBlockIdx_y * hipBlockDim_y + hipThreadIdx_y;
+  return HIPSYCL_BLOCK_IDX_Y * HIPSYCL_BLOCK_DIM_Y + HIPSYCL_THREAD_IDX_Y;
 }
 
 inline __device__ size_t get_global_id_z()
 {
-  return hipBlockIdx_z * hipBlockDim_z + hipThreadIdx_z;
+  return HIPSYCL_BLOCK_IDX_Z * HIPSYCL_BLOCK_DIM_Z + HIPSYCL_THREAD_IDX_Z;
 }
 
 inline __device__ size_t get_global_size_x()
 {
-  return hipGridDim_x * hipBlockDim_x;
+  return HIPSYCL_GRID_DIM_X * HIPSYCL_BLOCK_DIM_X;
 }
 
 inline __device__ size_t get_global_size_y()
 {
-  return hipGridDim_y * hipBlockDim_y;
+  return HIPSYCL_GRID_DIM_Y * HIPSYCL_BLOCK_DIM_Y;
 }
 
 inline __device__ size_t get_global_size_z()
 {
-  return hipGridDim_z * hipBlockDim_z;
+  return HIPSYCL_GRID_DIM_Z * HIPSYCL_BLOCK_DIM_Z;
 }
 
 
@@ -77,17 +130,17 @@ id<dimensions> get_local_id();
 template<>
 __device__
 inline id<1> get_local_id<1>()
-{ return id<1>{hipThreadIdx_x}; }
+{ return id<1>{HIPSYCL_THREAD_IDX_X}; }
 
 template<>
 __device__
 inline id<2> get_local_id<2>()
-{ return id<2>{hipThreadIdx_x, hipThreadIdx_y}; }
+{ return id<2>{HIPSYCL_THREAD_IDX_X, HIPSYCL_THREAD_IDX_Y}; }
 
 template<>
 __device__
 inline id<3> get_local_id<3>()
-{ return id<3>{hipThreadIdx_x, hipThreadIdx_y, hipThreadIdx_z}; }
+{ return id<3>{HIPSYCL_THREAD_IDX_X, HIPSYCL_THREAD_IDX_Y, HIPSYCL_THREAD_IDX_Z}; }
 
 template<int dimensions>
 __device__
@@ -121,23 +174,23 @@ id<dimensions> get_group_id();
 template<>
 __device__
 inline id<1> get_group_id<1>()
-{ return id<1>{hipBlockIdx_x}; }
+{ return id<1>{HIPSYCL_BLOCK_IDX_X}; }
 
 template<>
 __device__
 inline id<2> get_group_id<2>()
 {
-  return id<2>{hipBlockIdx_x,
-               hipBlockIdx_y};
+  return id<2>{HIPSYCL_BLOCK_IDX_X,
+               HIPSYCL_BLOCK_IDX_Y};
 }
 
 template<>
 __device__
 inline id<3> get_group_id<3>()
 {
-  return id<3>{hipBlockIdx_x,
-               hipBlockIdx_y,
-               hipBlockIdx_z};
+  return id<3>{HIPSYCL_BLOCK_IDX_X,
+               HIPSYCL_BLOCK_IDX_Y,
+               HIPSYCL_BLOCK_IDX_Z};
 }
 
 template<int dimensions>
@@ -148,21 +201,21 @@ template<>
 __device__
 inline sycl::range<1> get_grid_size<1>()
 {
-  return sycl::range<1>{hipGridDim_x};
+  return sycl::range<1>{HIPSYCL_GRID_DIM_X};
 }
 
 template<>
 __device__
 inline sycl::range<2> get_grid_size<2>()
 {
-  return sycl::range<2>{hipGridDim_x, hipGridDim_y};
+  return sycl::range<2>{HIPSYCL_GRID_DIM_X, HIPSYCL_GRID_DIM_Y};
 }
 
 template<>
 __device__
 inline sycl::range<3> get_grid_size<3>()
 {
-  return sycl::range<3>{hipGridDim_x, hipGridDim_y, hipGridDim_z};
+  return sycl::range<3>{HIPSYCL_GRID_DIM_X, HIPSYCL_GRID_DIM_Y, HIPSYCL_GRID_DIM_Z};
 }
 
 
@@ -174,21 +227,21 @@ template<>
 __device__
 inline sycl::range<1> get_local_size<1>()
 {
-  return sycl::range<1>{hipBlockDim_x};
+  return sycl::range<1>{HIPSYCL_BLOCK_DIM_X};
 }
 
 template<>
 __device__
 inline sycl::range<2> get_local_size<2>()
 {
-  return sycl::range<2>{hipBlockDim_x, hipBlockDim_y};
+  return sycl::range<2>{HIPSYCL_BLOCK_DIM_X, HIPSYCL_BLOCK_DIM_Y};
 }
 
 template<>
 __device__
 inline sycl::range<3> get_local_size<3>()
 {
-  return sycl::range<3>{hipBlockDim_x, hipBlockDim_y, hipBlockDim_z};
+  return sycl::range<3>{HIPSYCL_BLOCK_DIM_X, HIPSYCL_BLOCK_DIM_Y, HIPSYCL_BLOCK_DIM_Z};
 }
 
 template<int dimensions>
@@ -204,11 +257,11 @@ inline size_t get_global_size(int dimension)
   switch(dimension)
   {
   case 0:
-    return hipBlockDim_x * hipGridDim_x;
+    return HIPSYCL_BLOCK_DIM_X * HIPSYCL_GRID_DIM_X;
   case 1:
-    return hipBlockDim_y * hipGridDim_y;
+    return HIPSYCL_BLOCK_DIM_Y * HIPSYCL_GRID_DIM_Y;
   case 2:
-    return hipBlockDim_z * hipGridDim_z;
+    return HIPSYCL_BLOCK_DIM_Z * HIPSYCL_GRID_DIM_Z;
   }
   return 1;
 }
@@ -219,11 +272,11 @@ inline size_t get_grid_size(int dimension)
   switch (dimension)
   {
   case 0:
-    return hipGridDim_x;
+    return HIPSYCL_GRID_DIM_X;
   case 1:
-    return hipGridDim_y;
+    return HIPSYCL_GRID_DIM_Y;
   case 2:
-    return hipGridDim_z;
+    return HIPSYCL_GRID_DIM_Z;
   }
   return 1;
 }
@@ -234,11 +287,11 @@ inline size_t get_local_size(int dimension)
   switch(dimension)
   {
   case 0:
-    return hipThreadIdx_x;
+    return HIPSYCL_BLOCK_DIM_X;
   case 1:
-    return hipThreadIdx_y;
+    return HIPSYCL_BLOCK_DIM_Y;
   case 2:
-    return hipThreadIdx_z;
+    return HIPSYCL_BLOCK_DIM_Z;
   }
   return 1;
 }
@@ -264,11 +317,11 @@ inline size_t get_local_id(int dimension)
   switch(dimension)
   {
   case 0:
-    return hipThreadIdx_x;
+    return HIPSYCL_THREAD_IDX_X;
   case 1:
-    return hipThreadIdx_y;
+    return HIPSYCL_THREAD_IDX_Y;
   case 2:
-    return hipThreadIdx_z;
+    return HIPSYCL_THREAD_IDX_Z;
   }
   return 0;
 }
@@ -279,17 +332,31 @@ inline size_t get_group_id(int dimension)
   switch (dimension)
   {
   case 0:
-    return hipBlockIdx_x;
+    return HIPSYCL_BLOCK_IDX_X;
   case 1:
-    return hipBlockIdx_y;
+    return HIPSYCL_BLOCK_IDX_Y;
   case 2:
-    return hipBlockIdx_z;
+    return HIPSYCL_BLOCK_IDX_Z;
   }
   return 0;
 }
 
 
 
+#undef HIPSYCL_THREAD_IDX_X
+#undef HIPSYCL_THREAD_IDX_Y
+#undef HIPSYCL_THREAD_IDX_Z
+#undef HIPSYCL_BLOCK_IDX_X
+#undef HIPSYCL_BLOCK_IDX_Y
+#undef HIPSYCL_BLOCK_IDX_Z
+#undef HIPSYCL_BLOCK_DIM_X
+#undef HIPSYCL_BLOCK_DIM_Y
+#undef HIPSYCL_BLOCK_DIM_Z
+#undef HIPSYCL_GRID_DIM_X
+#undef HIPSYCL_GRID_DIM_Y
+#undef HIPSYCL_GRID_DIM_Z
+#undef HIPSYCL_HOST_CONTEXT_OR_BUILTIN
+
 }
 }
 }
@@ -0,0 +1,131 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HIPSYCL_TRACER_HPP
+#define HIPSYCL_TRACER_HPP
+
+#include "../types.hpp"
+#include "../backend/backend.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <typeinfo>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// Per-node data required by the tracer. Only exists
+/// for nodes created while tracing is enabled.
+struct node_trace_info
+{
+  std::uint64_t id;
+  /// A static string describing the task, or nullptr.
+  /// Kernel names are mangled type names and are only
+  /// demangled when the trace is written.
+  const char* label;
+  hipStream_t stream;
+  /// Written when the node is submitted
+  std::uint64_t submit_time;
+  int submit_thread;
+};
+
+/// Records the lifecycle of task graph nodes and writes it as
+/// Chrome trace event JSON (viewable in chrome://tracing or Perfetto)
+/// to the file given by the HIPSYCL_TRACE_FILE environment variable
+/// at program exit. Events are appended to per-thread buffers, so
+/// recording does not require any synchronization between threads.
+class tracer
+{
+public:
+  /// \return Whether tracing has been enabled via HIPSYCL_TRACE_FILE
+  static bool is_enabled()
+  {
+    static const bool enabled = (get_trace_file() != nullptr);
+    return enabled;
+  }
+
+  static tracer& get();
+
+  ~tracer();
+
+  std::unique_ptr<node_trace_info> create_node_info(const char* label,
+                                                    hipStream_t stream);
+
+  void record_insert(const node_trace_info& node);
+  void record_ready(const node_trace_info& node);
+  /// Marks the beginning of the submission of the node
+  /// on the calling thread.
+  void begin_submit(node_trace_info& node);
+  /// Records the submission of the node, which is shown
+  /// as running on its stream until record_done() is called.
+  void end_submit(const node_trace_info& node);
+  /// Records a dependency edge. Must be called between begin_submit()
+  /// and end_submit() of \c node, and \c requirement must have been
+  /// submitted.
+  void record_dependency(const node_trace_info& requirement,
+                         const node_trace_info& node);
+  void record_done(const node_trace_info& node);
+  void record_transfer(const char* name, std::size_t num_bytes,
+                       hipStream_t stream);
+
+  /// Writes all events recorded so far to the trace file
+  void write() const;
+private:
+  tracer();
+
+  static const char* get_trace_file();
+
+  struct event;
+  struct thread_buffer;
+
+  thread_buffer& get_thread_buffer();
+  void add_event(const event& evt);
+
+  std::uint64_t _start_time;
+  std::atomic<std::uint64_t> _next_node_id;
+  std::atomic<std::uint64_t> _next_flow_id;
+  std::atomic<int> _next_thread_id;
+
+  mutable mutex_class _mutex;
+  vector_class<shared_ptr_class<thread_buffer>> _thread_buffers;
+};
+
+/// \return A label identifying kernels named \c KernelName in traces
+template<class KernelName>
+const char* get_kernel_label()
+{
+  // Kernel names are usually incomplete types, so use a pointer type
+  return typeid(KernelName*).name();
+}
+
+}
+}
+}
+
+#endif
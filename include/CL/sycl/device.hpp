@@ -29,6 +29,7 @@
 #ifndef HIPSYCL_DEVICE_HPP
 #define HIPSYCL_DEVICE_HPP
 
+#include <algorithm>
 #include <limits>
 #include <type_traits>
 
@@ -38,6 +39,7 @@
 #include "exception.hpp"
 #include "id.hpp"
 #include "version.hpp"
+#include "detail/cpu_topology.hpp"
 
 namespace cl {
 namespace sycl {
@@ -48,6 +50,20 @@ class device;
 
 namespace detail {
 void set_device(const device& d);
+
+/// \return The native vector width for elements of the given size,
+/// which on the CPU is determined by the SIMD registers, and
+/// \a gpu_width on GPUs.
+inline cl_uint get_native_vector_width(std::size_t element_size,
+                                       cl_uint gpu_width)
+{
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_uint>(
+      std::max<std::size_t>(1, cpu_topology::get().simd_width / element_size));
+#else
+  return gpu_width;
+#endif
+}
 }
 
 class device
@@ -55,12 +71,10 @@ class device
   friend void detail::set_device(const device&);
 public:
 
-  /// Since we do not support host execution, this will actually
-  /// try to use the first GPU. Note: SYCL spec requires that
-  /// this should actually create a device object for host execution.
-  ///
-  /// \todo Should this call throw an error instead of behaving differently
-  /// than the spec requires?
+  /// On the CPU platform, this is the CPU, which also acts as
+  /// host device. Otherwise, this will try to use the first GPU.
+  /// Note: SYCL spec requires that this should actually create a
+  /// device object for host execution.
   device()
     : _device_id{0}
   {}
@@ -169,7 +183,13 @@ private:
 };
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, device_type)
-{ return info::device_type::gpu; }
+{
+#ifdef HIPSYCL_PLATFORM_CPU
+  return info::device_type::cpu;
+#else
+  return info::device_type::gpu;
+#endif
+}
 
 /// \todo Return different id for amd and nvidia
 HIPSYCL_SPECIALIZE_GET_INFO(device, vendor_id)
@@ -177,9 +197,13 @@ HIPSYCL_SPECIALIZE_GET_INFO(device, vendor_id)
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, max_compute_units)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_uint>(detail::cpu_topology::get().num_cores);
+#else
   hipDeviceProp_t props;
   detail::check_error(hipGetDeviceProperties(&props, _device_id));
   return static_cast<cl_uint>(props.multiProcessorCount);
+#endif
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, max_work_item_dimensions)
@@ -204,41 +228,45 @@ HIPSYCL_SPECIALIZE_GET_INFO(device, max_work_group_size)
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_char)
-{ return 4; }
+{ return detail::get_native_vector_width(sizeof(cl_char), 4); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_double)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_double), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_float)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_float), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_half)
 { return 0; }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_int)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_int), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_long)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_long), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, preferred_vector_width_short)
-{ return 2; }
+{ return detail::get_native_vector_width(sizeof(cl_short), 2); }
 
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_char)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_char), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_double)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_double), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_float)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_float), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_half)
 { return 0; }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_int)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_int), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_long)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_long), 1); }
 HIPSYCL_SPECIALIZE_GET_INFO(device, native_vector_width_short)
-{ return 1; }
+{ return detail::get_native_vector_width(sizeof(cl_short), 1); }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, max_clock_frequency)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_uint>(detail::cpu_topology::get().max_clock_frequency);
+#else
   hipDeviceProp_t props;
   detail::check_error(hipGetDeviceProperties(&props, _device_id));
   return static_cast<cl_uint>(props.clockRate / 1000);
+#endif
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, address_bits)
@@ -343,32 +371,55 @@ HIPSYCL_SPECIALIZE_GET_INFO(device, double_fp_config)
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, name)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return detail::cpu_topology::get().name;
+#else
   hipDeviceProp_t props;
   detail::check_error(hipGetDeviceProperties(&props, _device_id));
   return string_class{props.name};
+#endif
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, global_mem_cache_type)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return info::global_mem_cache_type::read_write;
+#else
   return info::global_mem_cache_type::read_only;
+#endif
 }
 
 /// \todo what is the cache line size on AMD devices?
 HIPSYCL_SPECIALIZE_GET_INFO(device, global_mem_cache_line_size)
-{ return 128; }
+{
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_uint>(detail::cpu_topology::get().cache_line_size);
+#else
+  return 128;
+#endif
+}
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, global_mem_cache_size)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_ulong>(
+      detail::cpu_topology::get().get_last_level_cache_size());
+#else
   hipDeviceProp_t props;
   detail::check_error(hipGetDeviceProperties(&props, _device_id));
   return static_cast<cl_ulong>(props.l2CacheSize);
+#endif
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, global_mem_size)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  return static_cast<cl_ulong>(detail::cpu_topology::get().memory_size);
+#else
   hipDeviceProp_t props;
   detail::check_error(hipGetDeviceProperties(&props, _device_id));
   return static_cast<cl_ulong>(props.totalGlobalMem);
+#endif
 }
 
 HIPSYCL_SPECIALIZE_GET_INFO(device, max_constant_buffer_size)
@@ -87,9 +87,12 @@ public:
   template <info::event param>
   typename info::param_traits<info::event, param>::return_type get_info() const;
 
+  /// Requires the queue to have been constructed with
+  /// property::queue::enable_profiling. Timestamps are
+  /// given in nanoseconds of the host's steady clock.
+  /// Querying the start or end time waits for the command to complete.
   template <info::event_profiling param>
-  typename info::param_traits<info::event_profiling, param>::return_type get_profiling_info() const
-  { throw unimplemented{"event::get_profiling_info() is unimplemented."}; }
+  typename info::param_traits<info::event_profiling, param>::return_type get_profiling_info() const;
 
   bool operator ==(const event& rhs) const
   { return _evt == rhs._evt; }
@@ -99,6 +102,27 @@ public:
 
 private:
 
+  const detail::task_profiler& get_profiler() const
+  {
+    if(_is_null_event || !_evt->get_profiler())
+      throw invalid_object_error{"event: Profiling information is only available "
+                                 "for commands submitted to a queue with "
+                                 "property::queue::enable_profiling"};
+
+    return *_evt->get_profiler();
+  }
+
+  const detail::task_profiler& get_completed_profiler() const
+  {
+    const detail::task_profiler& profiler = get_profiler();
+    _evt->wait();
+
+    if(!profiler.has_device_timestamps())
+      throw invalid_object_error{"event: Command has not been executed, "
+                                 "no profiling information available"};
+    return profiler;
+  }
+
   bool _is_null_event;
   detail::task_graph_node_ptr _evt;
 };
@@ -119,6 +143,27 @@ HIPSYCL_SPECIALIZE_GET_INFO(event, reference_count)
   return _evt.use_count();
 }
 
+template<>
+inline cl_ulong
+event::get_profiling_info<info::event_profiling::command_submit>() const
+{
+  return get_profiler().get_submit_time();
+}
+
+template<>
+inline cl_ulong
+event::get_profiling_info<info::event_profiling::command_start>() const
+{
+  return get_completed_profiler().get_start_time();
+}
+
+template<>
+inline cl_ulong
+event::get_profiling_info<info::event_profiling::command_end>() const
+{
+  return get_completed_profiler().get_end_time();
+}
+
 
 } // namespace sycl
 } // namespace cl
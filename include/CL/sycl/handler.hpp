@@ -42,13 +42,17 @@
 #include "item.hpp"
 #include "nd_item.hpp"
 #include "group.hpp"
+#include "reduction.hpp"
 #include "detail/local_memory_allocator.hpp"
+#include "detail/device_memory_pool.hpp"
 #include "detail/buffer.hpp"
 #include "detail/task_graph.hpp"
+#include "detail/command_graph.hpp"
 #include "detail/application.hpp"
 #include "detail/stream.hpp"
 #include "detail/debug.hpp"
 #include "detail/util.hpp"
+#include "detail/host_dispatch.hpp"
 
 namespace cl {
 namespace sycl {
@@ -128,6 +132,111 @@ void parallel_for_ndrange_kernel(Function f, id<dimensions> offset)
   f(this_item);
 }
 
+/// Number of work items combining the results of the
+/// work groups of a reduction kernel.
+constexpr std::size_t reduction_final_group_size = 256;
+
+/// Combines the values of the work items of a group as a tree in the local
+/// memory at \a scratch_address, which must hold one value per work item.
+/// Must be reached by all work items of the group.
+/// \return The result of the group, in all work items
+template<int dimensions, class Reduction>
+HIPSYCL_KERNEL_TARGET
+typename Reduction::value_type
+group_reduce(const nd_item<dimensions>& this_item,
+             const Reduction& reduction,
+             typename Reduction::value_type value,
+             local_memory::address scratch_address)
+{
+  using value_type = typename Reduction::value_type;
+
+  value_type* scratch = local_memory::get_ptr<value_type>(scratch_address);
+  const std::size_t local_id = this_item.get_local_linear_id();
+  const std::size_t group_size = this_item.get_local_range().size();
+
+  scratch[local_id] = value;
+  this_item.barrier(access::fence_space::local_space);
+
+  // Starting at the largest power of two below the group size folds
+  // the work items beyond it in during the first step.
+  std::size_t stride = 1;
+  while(2 * stride < group_size)
+    stride *= 2;
+
+  for(; stride > 0; stride /= 2)
+  {
+    if(local_id < stride && local_id + stride < group_size)
+      scratch[local_id] = reduction.combine(scratch[local_id],
+                                            scratch[local_id + stride]);
+    this_item.barrier(access::fence_space::local_space);
+  }
+  return scratch[0];
+}
+
+template<int dimensions, class Function, class Reduction>
+__sycl_kernel
+void parallel_for_reduction_kernel(Function f,
+                                   sycl::range<dimensions> execution_range,
+                                   Reduction reduction,
+                                   typename Reduction::value_type* group_results,
+                                   local_memory::address scratch_address)
+{
+  auto reducer = reduction.make_reducer();
+  auto this_item = detail::make_item<dimensions>(
+    get_global_id_helper<dimensions>(), execution_range);
+  if(item_is_in_range(this_item, execution_range, id<dimensions>{}))
+    f(this_item, reducer);
+
+  id<dimensions> offset;
+  nd_item<dimensions> group_item{&offset};
+  auto group_result = group_reduce(group_item, reduction,
+                                   reducer._detail_get_value(),
+                                   scratch_address);
+  if(group_item.get_local_linear_id() == 0)
+    group_results[group_item.get_group_linear_id()] = group_result;
+}
+
+template<int dimensions, class Function, class Reduction>
+__sycl_kernel
+void parallel_for_ndrange_reduction_kernel(Function f,
+                                           id<dimensions> offset,
+                                           Reduction reduction,
+                                           typename Reduction::value_type* group_results,
+                                           local_memory::address scratch_address)
+{
+  auto reducer = reduction.make_reducer();
+  nd_item<dimensions> this_item{&offset};
+  f(this_item, reducer);
+
+  auto group_result = group_reduce(this_item, reduction,
+                                   reducer._detail_get_value(),
+                                   scratch_address);
+  if(this_item.get_local_linear_id() == 0)
+    group_results[this_item.get_group_linear_id()] = group_result;
+}
+
+/// Combines the results of the work groups of a reduction kernel
+/// in a single group of reduction_final_group_size work items.
+template<class Reduction>
+__sycl_kernel
+void reduction_final_kernel(Reduction reduction,
+                            const typename Reduction::value_type* group_results,
+                            std::size_t num_group_results,
+                            local_memory::address scratch_address)
+{
+  id<1> offset;
+  nd_item<1> this_item{&offset};
+
+  auto value = reduction.get_identity();
+  for(std::size_t i = this_item.get_local_linear_id(); i < num_group_results;
+      i += this_item.get_local_range().size())
+    value = reduction.combine(value, group_results[i]);
+
+  auto result = group_reduce(this_item, reduction, value, scratch_address);
+  if(this_item.get_local_linear_id() == 0)
+    reduction.store_result(result);
+}
+
 template<int dimensions, class Function>
 __sycl_kernel 
 void parallel_for_workgroup(Function f,
@@ -177,15 +286,12 @@ public:
                   "Only placeholder accessors for global and constant buffers are "
                   "supported.");
 
-    detail::accessor_tracker& placeholder_tracker =
-        detail::application::get_hipsycl_runtime().get_accessor_tracker();
-
-    detail::buffer_ptr buff = placeholder_tracker.find_accessor(&acc);
-
+    detail::buffer_ptr buff = acc._detail_get_buffer();
 
     detail::accessor::obtain_device_access(buff,
                                            *this,
-                                           accessMode);
+                                           accessMode,
+                                           acc._detail_get_accessed_regions());
 
   }
 
@@ -219,14 +325,14 @@ void set_args(Ts &&... args);
       return detail::task_state::enqueued;
     };
 
-    this->submit_task(kernel_launch);
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
   }
 
   template <typename KernelName = class _unnamed_kernel,
             typename KernelType, int dimensions>
   void parallel_for(range<dimensions> numWorkItems, KernelType kernelFunc)
   {
-    dispatch_kernel_without_offset(numWorkItems, kernelFunc);
+    dispatch_kernel_without_offset<KernelName>(numWorkItems, kernelFunc);
   }
 
   template <typename KernelName = class _unnamed_kernel,
@@ -234,14 +340,39 @@ void set_args(Ts &&... args);
   void parallel_for(range<dimensions> numWorkItems,
                     id<dimensions> workItemOffset, KernelType kernelFunc)
   {
-    dispatch_kernel_with_offset(numWorkItems, workItemOffset, kernelFunc);
+    dispatch_kernel_with_offset<KernelName>(numWorkItems, workItemOffset, kernelFunc);
   }
 
   template <typename KernelName = class _unnamed_kernel,
             typename KernelType, int dimensions>
   void parallel_for(nd_range<dimensions> executionRange, KernelType kernelFunc)
   {
-    dispatch_ndrange_kernel(executionRange, kernelFunc);
+    dispatch_ndrange_kernel<KernelName>(executionRange, kernelFunc);
+  }
+
+  /// Executes a range kernel that contributes to \a reduction through
+  /// the reducer it is passed along with its item.
+  template <typename KernelName = class _unnamed_kernel,
+            typename KernelType, int dimensions,
+            typename T, access::mode mode, typename BinaryOperation>
+  void parallel_for(range<dimensions> numWorkItems,
+                    detail::reduction_descriptor<T, mode, BinaryOperation> reduction,
+                    KernelType kernelFunc)
+  {
+    dispatch_reduction_kernel<KernelName>(numWorkItems, reduction, kernelFunc);
+  }
+
+  /// Executes an nd_range kernel that contributes to \a reduction through
+  /// the reducer it is passed along with its nd_item.
+  template <typename KernelName = class _unnamed_kernel,
+            typename KernelType, int dimensions,
+            typename T, access::mode mode, typename BinaryOperation>
+  void parallel_for(nd_range<dimensions> executionRange,
+                    detail::reduction_descriptor<T, mode, BinaryOperation> reduction,
+                    KernelType kernelFunc)
+  {
+    dispatch_ndrange_reduction_kernel<KernelName>(executionRange, reduction,
+                                                  kernelFunc);
   }
 
 
@@ -254,7 +385,7 @@ void set_args(Ts &&... args);
   void parallel_for_work_group(range<dimensions> numWorkGroups,
                                WorkgroupFunctionType kernelFunc)
   {
-    dispatch_hierarchical_kernel(numWorkGroups,
+    dispatch_hierarchical_kernel<KernelName>(numWorkGroups,
                                  get_default_local_range<dimensions>(),
                                  kernelFunc);
   }
@@ -266,7 +397,7 @@ void set_args(Ts &&... args);
                                range<dimensions> workGroupSize,
                                WorkgroupFunctionType kernelFunc)
   {
-    dispatch_hierarchical_kernel(numWorkGroups,
+    dispatch_hierarchical_kernel<KernelName>(numWorkGroups,
                                  workGroupSize,
                                  kernelFunc);
   }
@@ -362,23 +493,24 @@ void set_args(Ts &&... args);
   template <typename T, int dim, access::mode mode, access::target tgt>
   void update_host(accessor<T, dim, mode, tgt> acc)
   {
-    detail::accessor_tracker& placeholder_tracker =
-        detail::application::get_hipsycl_runtime().get_accessor_tracker();
+    this->ensure_not_recording("update_host()");
 
-    detail::buffer_ptr buff = placeholder_tracker.find_accessor(&acc);
+    detail::buffer_ptr buff = acc._detail_get_buffer();
 
     detail::stream_ptr stream = this->get_stream();
 
     HIPSYCL_DEBUG_INFO << "handler: Spawning async host access task"
                        << std::endl;
 
+    auto regions = acc._detail_get_accessed_regions();
     auto task_graph_node = detail::buffer_impl::access_host(
           buff,
           mode,
+          regions,
           stream,
           stream->get_error_handler());
 
-    this->_detail_add_access(buff, mode, task_graph_node);
+    this->_detail_add_access(buff, mode, task_graph_node, std::move(regions));
   }
 
   /// \todo fill() on host accessors can be optimized to use
@@ -394,6 +526,7 @@ void set_args(Ts &&... args);
 
     if(tgt == access::target::host_buffer)
     {
+      this->ensure_not_recording("fill() on host accessors");
       this->execute_host_range_iteration(dest.get_range(),
                                          dest.get_offset(),
                                          [&](cl::sycl::id<dim> tid){
@@ -423,18 +556,21 @@ void set_args(Ts &&... args);
 
   void _detail_add_access(detail::buffer_ptr buff,
                           access::mode access_mode,
-                          detail::task_graph_node_ptr task)
+                          detail::task_graph_node_ptr task,
+                          detail::buffer_region_list regions)
   {
     this->_spawned_task_nodes.push_back(task);
-    this->_accessed_buffers.push_back({access_mode, buff, task});
+    this->_last_task_node = task;
+    this->_accessed_buffers.push_back({access_mode, buff, task,
+                                       std::move(regions)});
   }
 
   event _detail_get_event() const
   {
-    if(_spawned_task_nodes.empty())
+    if(!_last_task_node)
       return event{};
 
-    return event{_spawned_task_nodes.back()};
+    return event{_last_task_node};
   }
 
 
@@ -447,6 +583,8 @@ private:
     access::mode access_mode;
     detail::buffer_ptr buff;
     detail::task_graph_node_ptr task;
+    // The accessed regions of the buffer
+    detail::buffer_region_list regions;
   };
 
   hipStream_t get_hip_stream() const;
@@ -537,16 +675,18 @@ private:
         }
   }
 
-  template <typename KernelType, int dimensions>
+  template <typename KernelName, typename KernelType, int dimensions>
   __host__
   void dispatch_kernel_without_offset(range<dimensions> numWorkItems,
                                       KernelType kernelFunc)
   {
+#ifndef HIPSYCL_PLATFORM_CPU
     dim3 grid, block;
     determine_grid_configuration(numWorkItems, grid, block);
 
     std::size_t shared_mem_size =
         _local_mem_allocator.get_allocation_size();
+#endif
 
     detail::stream_ptr stream = this->get_stream();
 
@@ -555,28 +695,37 @@ private:
     {
       stream->activate_device();
 
+#ifdef HIPSYCL_PLATFORM_CPU
+      // Range kernels do not need concurrent work items, so they are
+      // executed as loops on the host thread pool.
+      detail::host_dispatch::parallel_for(stream,
+                                          kernelFunc, numWorkItems);
+#else
       __hipsycl_launch_kernel(detail::dispatch::parallel_for_kernel,
                             grid, block, shared_mem_size, stream->get_stream(),
                             kernelFunc, numWorkItems);
+#endif
 
       return detail::task_state::enqueued;
     };
 
-    this->submit_task(kernel_launch);
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
 
   }
 
-  template <typename KernelType, int dimensions>
+  template <typename KernelName, typename KernelType, int dimensions>
   __host__
   void dispatch_kernel_with_offset(range<dimensions> numWorkItems,
                                    id<dimensions> offset,
                                    KernelType kernelFunc)
   {
+#ifndef HIPSYCL_PLATFORM_CPU
     dim3 grid, block;
     determine_grid_configuration(numWorkItems, grid, block);
 
     std::size_t shared_mem_size =
         _local_mem_allocator.get_allocation_size();
+#endif
 
     detail::stream_ptr stream = this->get_stream();
 
@@ -586,19 +735,25 @@ private:
     {
       stream->activate_device();
 
+#ifdef HIPSYCL_PLATFORM_CPU
+      detail::host_dispatch::parallel_for_with_offset(stream,
+                                                      kernelFunc, numWorkItems,
+                                                      offset);
+#else
       __hipsycl_launch_kernel(detail::dispatch::parallel_for_kernel_with_offset,
                         grid, block, shared_mem_size, stream->get_stream(),
                         kernelFunc, numWorkItems, offset);
+#endif
 
 
       return detail::task_state::enqueued;
     };
 
-    this->submit_task(kernel_launch);
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
   }
 
 
-  template <typename KernelType, int dimensions>
+  template <typename KernelName, typename KernelType, int dimensions>
   __host__
   void dispatch_ndrange_kernel(nd_range<dimensions> executionRange, KernelType kernelFunc)
   {
@@ -625,6 +780,30 @@ private:
     {
       stream->activate_device();
 
+#ifdef HIPSYCL_PLATFORM_CPU
+      if(detail::host_dispatch::barrier_free_kernel_query(
+           &detail::dispatch::parallel_for_ndrange_kernel<dimensions, KernelType>))
+      {
+        detail::host_dispatch::parallel_for_ndrange(stream,
+                                                    kernelFunc, grid_range,
+                                                    block_range, offset,
+                                                    shared_mem_size);
+        return detail::task_state::enqueued;
+      }
+
+      std::size_t frame_size = detail::host_dispatch::work_item_frame_size_query(
+          &detail::host_dispatch::work_item_region<dimensions, KernelType>);
+      if(frame_size > 0)
+      {
+        detail::host_dispatch::parallel_for_ndrange_regions(stream,
+                                                            kernelFunc, grid_range,
+                                                            block_range, offset,
+                                                            shared_mem_size,
+                                                            frame_size);
+        return detail::task_state::enqueued;
+      }
+#endif
+
       __hipsycl_launch_kernel(detail::dispatch::parallel_for_ndrange_kernel,
                         grid, block, shared_mem_size, stream->get_stream(),
                         kernelFunc, offset);
@@ -633,10 +812,174 @@ private:
       return detail::task_state::enqueued;
     };
 
-    this->submit_task(kernel_launch);
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
+  }
+
+  template <typename KernelName, typename KernelType, int dimensions,
+            class Reduction>
+  __host__
+  void dispatch_reduction_kernel(range<dimensions> numWorkItems,
+                                 Reduction reduction,
+                                 KernelType kernelFunc)
+  {
+    detail::stream_ptr stream = this->get_stream();
+
+#ifdef HIPSYCL_PLATFORM_CPU
+    // Each chunk of work items accumulates into its own reducer,
+    // so no work groups or scratch memory are needed.
+    auto kernel_launch = [=]()
+        -> detail::task_state
+    {
+      stream->activate_device();
+
+      detail::host_dispatch::parallel_for_reduction(stream,
+                                                    kernelFunc, numWorkItems,
+                                                    reduction);
+
+      return detail::task_state::enqueued;
+    };
+#else
+    dim3 grid, block;
+    determine_grid_configuration(numWorkItems, grid, block);
+
+    const std::size_t num_groups = grid.x * grid.y * grid.z;
+    detail::local_memory::address scratch_address =
+        alloc_reduction_scratch<Reduction>(block.x * block.y * block.z);
+
+    std::size_t shared_mem_size =
+        _local_mem_allocator.get_allocation_size();
+
+    auto kernel_launch = [=]()
+        -> detail::task_state
+    {
+      stream->activate_device();
+
+      auto group_results = allocate_reduction_results<Reduction>(
+          num_groups, stream->get_stream());
+
+      if(num_groups > 0)
+        __hipsycl_launch_kernel(detail::dispatch::parallel_for_reduction_kernel,
+                          grid, block, shared_mem_size, stream->get_stream(),
+                          kernelFunc, numWorkItems, reduction, group_results,
+                          scratch_address);
+
+      finish_reduction(reduction, group_results, num_groups, shared_mem_size,
+                       scratch_address, stream->get_stream());
+
+      return detail::task_state::enqueued;
+    };
+#endif
+
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
   }
 
-  template <typename WorkgroupFunctionType, int dimensions>
+  template <typename KernelName, typename KernelType, int dimensions,
+            class Reduction>
+  __host__
+  void dispatch_ndrange_reduction_kernel(nd_range<dimensions> executionRange,
+                                         Reduction reduction,
+                                         KernelType kernelFunc)
+  {
+    for(int i = 0; i < dimensions; ++i)
+    {
+      if(executionRange.get_global()[i] % executionRange.get_local()[i] != 0)
+        throw invalid_parameter_error{"Global size must be a multiple of the local size"};
+    }
+
+    id<dimensions> offset = executionRange.get_offset();
+    range<dimensions> grid_range = executionRange.get_group();
+    range<dimensions> block_range = executionRange.get_local();
+
+    dim3 grid = range_to_dim3(grid_range);
+    dim3 block = range_to_dim3(block_range);
+
+    const std::size_t num_groups = grid_range.size();
+    detail::local_memory::address scratch_address =
+        alloc_reduction_scratch<Reduction>(block_range.size());
+
+    std::size_t shared_mem_size =
+        _local_mem_allocator.get_allocation_size();
+
+    detail::stream_ptr stream = this->get_stream();
+
+    auto kernel_launch = [=]()
+        -> detail::task_state
+    {
+      stream->activate_device();
+
+#ifdef HIPSYCL_PLATFORM_CPU
+      using adapter_type = detail::host_dispatch::reduction_kernel_adapter<
+          KernelType, typename Reduction::reducer_type>;
+
+      if(detail::host_dispatch::barrier_free_kernel_query(
+           &detail::dispatch::parallel_for_ndrange_kernel<dimensions, adapter_type>))
+      {
+        detail::host_dispatch::parallel_for_ndrange_reduction(stream,
+                                                              kernelFunc, grid_range,
+                                                              block_range, offset,
+                                                              shared_mem_size,
+                                                              reduction);
+        return detail::task_state::enqueued;
+      }
+#endif
+
+      auto group_results = allocate_reduction_results<Reduction>(
+          num_groups, stream->get_stream());
+
+      if(num_groups > 0)
+        __hipsycl_launch_kernel(detail::dispatch::parallel_for_ndrange_reduction_kernel,
+                          grid, block, shared_mem_size, stream->get_stream(),
+                          kernelFunc, offset, reduction, group_results,
+                          scratch_address);
+
+      finish_reduction(reduction, group_results, num_groups, shared_mem_size,
+                       scratch_address, stream->get_stream());
+
+      return detail::task_state::enqueued;
+    };
+
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
+  }
+
+  /// Allocates local memory for combining the values of the work items
+  /// of a reduction kernel, and of the final pass over its work groups.
+  template<class Reduction>
+  detail::local_memory::address alloc_reduction_scratch(std::size_t group_size)
+  {
+    return _local_mem_allocator.alloc<typename Reduction::value_type>(
+        std::max(group_size, detail::dispatch::reduction_final_group_size));
+  }
+
+  template<class Reduction>
+  typename Reduction::value_type*
+  allocate_reduction_results(std::size_t num_groups, hipStream_t stream) const
+  {
+    return static_cast<typename Reduction::value_type*>(
+        detail::device_memory_pool::get().allocate(
+          std::max<std::size_t>(num_groups, 1) *
+          sizeof(typename Reduction::value_type), stream));
+  }
+
+  /// Combines the results of the work groups of a reduction kernel
+  /// enqueued on \a stream, and releases \a group_results afterwards.
+  template<class Reduction>
+  void finish_reduction(Reduction reduction,
+                        typename Reduction::value_type* group_results,
+                        std::size_t num_groups,
+                        std::size_t shared_mem_size,
+                        detail::local_memory::address scratch_address,
+                        hipStream_t stream) const
+  {
+    __hipsycl_launch_kernel(detail::dispatch::reduction_final_kernel,
+                            1, detail::dispatch::reduction_final_group_size,
+                            shared_mem_size, stream,
+                            reduction, group_results, num_groups,
+                            scratch_address);
+
+    detail::device_memory_pool::get().release(group_results, stream);
+  }
+
+  template <typename KernelName, typename WorkgroupFunctionType, int dimensions>
   __host__
   void dispatch_hierarchical_kernel(range<dimensions> numWorkGroups,
                                     range<dimensions> workGroupSize,
@@ -664,7 +1007,7 @@ private:
       return detail::task_state::enqueued;
     };
 
-    this->submit_task(kernel_launch);
+    this->submit_task(kernel_launch, detail::get_kernel_label<KernelName>());
   }
 
   template <typename T, int dim, access::mode mode, access::target tgt,
@@ -728,6 +1071,9 @@ private:
   template <typename T, int dim, access::mode mode, access::target tgt>
   void validate_copy_src_accessor(const accessor<T, dim, mode, tgt>&)
   {
+    if(tgt == access::target::host_buffer)
+      this->ensure_not_recording("copy() from host accessors");
+
     static_assert(dim != 0, "0-dimensional accessors are currently not supported");
     static_assert(mode == access::mode::read || mode == access::mode::read_write,
       "Only read or read_write accessors can be copied from");
@@ -740,6 +1086,9 @@ private:
   template <typename T, int dim, access::mode mode, access::target tgt>
   void validate_copy_dest_accessor(const accessor<T, dim, mode, tgt>&)
   {
+    if(tgt == access::target::host_buffer)
+      this->ensure_not_recording("copy() to host accessors");
+
     static_assert(dim != 0, "0-dimensional accessors are currently not supported");
     static_assert(mode == access::mode::write ||
       mode == access::mode::read_write ||
@@ -791,7 +1140,7 @@ private:
         src_offset, count[0] * sizeof(T), kind, stream->get_stream());
       return task_state::enqueued;
     };
-    return this->submit_task(copy_launch);
+    return this->submit_task(copy_launch, "copy");
   }
 
   template <typename destPtr, typename srcPtr>
@@ -812,7 +1161,7 @@ private:
         count[1] * sizeof(T), count[0], kind, stream->get_stream());
       return task_state::enqueued;
     };
-    return this->submit_task(copy_launch);
+    return this->submit_task(copy_launch, "copy");
   }
 
   template <typename destPtr, typename srcPtr>
@@ -846,7 +1195,7 @@ private:
       cudaMemcpy3DAsync(&params, stream->get_stream());
       return task_state::enqueued;
     };
-    return this->submit_task(copy_launch);
+    return this->submit_task(copy_launch, "copy");
 #else
     // It looks like HIP doesn't provide a hipMemcpy3DAsync as of April 2019.
     // See https://github.com/ROCm-Developer-Tools/HIP/blob/master/docs/markdown/CUDA_Runtime_API_functions_supported_by_HIP.md
@@ -863,20 +1212,51 @@ private:
                                   detail::task_graph_node_ptr task_node)
   {
     if(tgt != access::target::host_buffer) return;
-    detail::accessor_tracker& tracker =
-      detail::application::get_hipsycl_runtime().get_accessor_tracker();
-    detail::buffer_ptr buff = tracker.find_accessor(&acc);
-    buff->register_external_access(task_node, mode);
+    detail::buffer_ptr buff = acc._detail_get_buffer();
+    buff->register_external_access(task_node, mode,
+                                   acc._detail_get_accessed_regions());
     HIPSYCL_DEBUG_INFO << "handler: Registering external access via task "
       << task_node << " for buffer " << buff << std::endl;
   }
 
-  detail::task_graph_node_ptr submit_task(detail::task_functor f)
+  /// Throws feature_not_supported if submissions are being recorded
+  /// into a command graph, since \c operation cannot be recorded.
+  void ensure_not_recording(const char* operation) const;
+
+  template<class Task>
+  void record_task(detail::command_graph_recorder& recorder, const Task& f)
+  {
+    vector_class<detail::command_graph_recorder::buffer_usage> accesses;
+    accesses.reserve(_accessed_buffers.size());
+    for(const auto& buffer_access : _accessed_buffers)
+      accesses.push_back({buffer_access.buff, buffer_access.access_mode});
+
+    _last_recorded_command = recorder.record(f, accesses, _last_recorded_command);
+  }
+
+  /// \param label A static string describing the task in traces
+  template<class Task>
+  detail::task_graph_node_ptr submit_task(Task f, const char* label)
   {
     auto& task_graph = detail::application::get_task_graph();
 
+    if(detail::command_graph_recorder* recorder = get_stream()->get_recorder())
+      this->record_task(*recorder, f);
+
+    // The task depends on all previously spawned tasks. Those are not needed
+    // afterwards, since later tasks only need to depend on this one, so the
+    // requirements are moved into the task graph instead of being copied.
+    detail::task_graph_node_list requirements =
+        std::move(_spawned_task_nodes);
+    _spawned_task_nodes.clear();
+    if(_last_task_node &&
+       (requirements.empty() || requirements.back() != _last_task_node))
+      requirements.push_back(_last_task_node);
+
     auto graph_node =
-        task_graph.insert(f, _spawned_task_nodes, get_stream(), _handler);
+        task_graph.insert(std::move(f), std::move(requirements), get_stream(),
+                          _handler, detail::task_execution_kind::stream_ordered,
+                          label);
 
     // Add new node to the access log of buffers. This guarantees that
     // subsequent buffer accesses will wait for existing tasks to complete,
@@ -885,10 +1265,11 @@ private:
     {
       buffer_access.buff->register_external_access(
             graph_node,
-            buffer_access.access_mode);
+            buffer_access.access_mode,
+            buffer_access.regions);
     }
 
-    _spawned_task_nodes.push_back(graph_node);
+    _last_task_node = graph_node;
     return graph_node;
   }
 
@@ -900,8 +1281,15 @@ private:
   async_handler _handler;
 
 
-  vector_class<detail::task_graph_node_ptr> _spawned_task_nodes;
-  vector_class<buffer_access> _accessed_buffers;
+  // Tasks spawned for accessors that the next task has to wait for
+  detail::task_graph_node_list _spawned_task_nodes;
+  // The most recently spawned task, which completes the command group
+  detail::task_graph_node_ptr _last_task_node;
+  // Command groups rarely access more than a few buffers
+  detail::small_vector<buffer_access, 4> _accessed_buffers;
+
+  // Index of the command that was last recorded from this command group
+  std::size_t _last_recorded_command;
 };
 
 namespace detail {
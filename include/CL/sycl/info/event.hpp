@@ -60,6 +60,10 @@ enum class event_profiling : int
 HIPSYCL_PARAM_TRAIT_RETURN_VALUE(event, event::command_execution_status, event_command_status);
 HIPSYCL_PARAM_TRAIT_RETURN_VALUE(event, event::reference_count, cl_uint);
 
+HIPSYCL_PARAM_TRAIT_RETURN_VALUE(event_profiling, event_profiling::command_submit, cl_ulong);
+HIPSYCL_PARAM_TRAIT_RETURN_VALUE(event_profiling, event_profiling::command_start, cl_ulong);
+HIPSYCL_PARAM_TRAIT_RETURN_VALUE(event_profiling, event_profiling::command_end, cl_ulong);
+
 }
 }
 }
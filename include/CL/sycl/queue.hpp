@@ -44,6 +44,17 @@
 
 namespace cl {
 namespace sycl {
+namespace property {
+namespace queue {
+
+class enable_profiling : public detail::property
+{
+public:
+  enable_profiling() = default;
+};
+
+}
+}
 
 
 class queue : public detail::property_carrying_object
@@ -146,6 +157,7 @@ public:
   detail::stream_ptr get_stream() const;
 
 private:
+  void init_stream();
 
   device _device;
   detail::stream_ptr _stream;
@@ -0,0 +1,253 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HIPSYCL_REDUCTION_HPP
+#define HIPSYCL_REDUCTION_HPP
+
+#include <limits>
+#include <type_traits>
+
+#include "access.hpp"
+#include "accessor.hpp"
+#include "backend/backend.hpp"
+
+namespace cl {
+namespace sycl {
+
+template<class T>
+struct plus
+{
+  HIPSYCL_UNIVERSAL_TARGET
+  T operator()(const T& a, const T& b) const
+  { return a + b; }
+};
+
+template<class T>
+struct minimum
+{
+  HIPSYCL_UNIVERSAL_TARGET
+  T operator()(const T& a, const T& b) const
+  { return (b < a) ? b : a; }
+};
+
+template<class T>
+struct maximum
+{
+  HIPSYCL_UNIVERSAL_TARGET
+  T operator()(const T& a, const T& b) const
+  { return (a < b) ? b : a; }
+};
+
+namespace detail {
+
+/// The identities of the built-in combiners, i.e. the values that
+/// do not change the result when combined with it.
+template<class BinaryOperation>
+struct known_identity
+{
+  static constexpr bool available = false;
+};
+
+template<class T>
+struct known_identity<plus<T>>
+{
+  static constexpr bool available = true;
+
+  static T get()
+  { return T{}; }
+};
+
+template<class T>
+struct known_identity<minimum<T>>
+{
+  static constexpr bool available = true;
+
+  static T get()
+  {
+    return std::numeric_limits<T>::has_infinity ?
+      std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+  }
+};
+
+template<class T>
+struct known_identity<maximum<T>>
+{
+  static constexpr bool available = true;
+
+  static T get()
+  {
+    return std::numeric_limits<T>::has_infinity ?
+      -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+  }
+};
+
+template<class T, access::mode Mode, class BinaryOperation>
+class reduction_descriptor;
+
+}
+
+/// Accumulates the contributions of work items to a reduction. A reducer
+/// may be passed to several work items in turn, so kernels must only use
+/// it through combine(). For plus, operator+= is provided as a shorthand.
+/// There are no shorthand operators for minimum, maximum and user-defined
+/// combiners, as in SYCL 2020; kernels call combine() for those.
+template<class T, class BinaryOperation>
+class reducer
+{
+public:
+  using value_type = T;
+
+  HIPSYCL_UNIVERSAL_TARGET
+  reducer(const T& identity, BinaryOperation combiner)
+    : _value{identity}, _identity{identity}, _combiner{combiner}
+  {}
+
+  HIPSYCL_UNIVERSAL_TARGET
+  void combine(const T& partial)
+  {
+    _value = _combiner(_value, partial);
+  }
+
+  HIPSYCL_UNIVERSAL_TARGET
+  T identity() const
+  {
+    return _identity;
+  }
+
+  HIPSYCL_UNIVERSAL_TARGET
+  T _detail_get_value() const
+  {
+    return _value;
+  }
+private:
+  T _value;
+  T _identity;
+  BinaryOperation _combiner;
+};
+
+/// Shorthand for r.combine(partial) in sums
+template<class T>
+HIPSYCL_UNIVERSAL_TARGET
+void operator+=(reducer<T, plus<T>>& r, const T& partial)
+{
+  r.combine(partial);
+}
+
+namespace detail {
+
+/// Describes a reduction of all work items of a kernel into the first
+/// element of a buffer, as created by sycl::reduction().
+///
+/// Accessors in read_write and write mode combine the result with the
+/// value already present in the buffer, while discard modes overwrite it.
+template<class T, access::mode Mode, class BinaryOperation>
+class reduction_descriptor
+{
+public:
+  using value_type = T;
+  using reducer_type = reducer<T, BinaryOperation>;
+  using accessor_type = sycl::accessor<T, 1, Mode, access::target::global_buffer>;
+
+  static_assert(Mode != access::mode::read && Mode != access::mode::atomic,
+                "Reductions require accessors in a writable, non-atomic mode");
+
+  reduction_descriptor(accessor_type acc,
+                       const T& identity,
+                       BinaryOperation combiner)
+    : _acc{acc}, _identity{identity}, _combiner{combiner}
+  {}
+
+  HIPSYCL_UNIVERSAL_TARGET
+  reducer_type make_reducer() const
+  {
+    return reducer_type{_identity, _combiner};
+  }
+
+  HIPSYCL_UNIVERSAL_TARGET
+  T get_identity() const
+  {
+    return _identity;
+  }
+
+  HIPSYCL_UNIVERSAL_TARGET
+  T combine(const T& a, const T& b) const
+  {
+    return _combiner(a, b);
+  }
+
+  /// Stores the result of the reduction. Must be called once, by a
+  /// single work item or by the host once the kernel has completed.
+  HIPSYCL_UNIVERSAL_TARGET
+  void store_result(const T& result) const
+  {
+    if(Mode == access::mode::discard_write ||
+       Mode == access::mode::discard_read_write)
+      _acc[0] = result;
+    else
+      _acc[0] = _combiner(_acc[0], result);
+  }
+private:
+  accessor_type _acc;
+  T _identity;
+  BinaryOperation _combiner;
+};
+
+}
+
+/// Creates a reduction into the first element of the buffer accessed
+/// by \a acc, for use with handler::parallel_for(). \a combiner
+/// must be associative and commutative, since work items and work groups
+/// are combined in no particular order.
+template<class T, access::mode Mode, class BinaryOperation>
+detail::reduction_descriptor<T, Mode, BinaryOperation>
+reduction(accessor<T, 1, Mode, access::target::global_buffer> acc,
+          const T& identity,
+          BinaryOperation combiner)
+{
+  return detail::reduction_descriptor<T, Mode, BinaryOperation>{
+    acc, identity, combiner};
+}
+
+/// Creates a reduction with one of the built-in combiners plus,
+/// minimum and maximum, whose identities are known.
+template<class T, access::mode Mode, class BinaryOperation>
+detail::reduction_descriptor<T, Mode, BinaryOperation>
+reduction(accessor<T, 1, Mode, access::target::global_buffer> acc,
+          BinaryOperation combiner)
+{
+  static_assert(detail::known_identity<BinaryOperation>::available,
+                "The identity of custom combiners must be specified");
+
+  return detail::reduction_descriptor<T, Mode, BinaryOperation>{
+    acc, detail::known_identity<BinaryOperation>::get(), combiner};
+}
+
+}
+}
+
+#endif
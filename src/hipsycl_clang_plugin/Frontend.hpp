@@ -308,6 +308,12 @@ public:
     CompilationStateManager::getASTPassState().setDeviceCompilation(
         Instance.getSema().getLangOpts().CUDAIsDevice);
 
+    // When compiling for the CPU, the plugin is only loaded
+    // for its IR passes - there are no __device__ functions
+    // to be marked.
+    if(!Instance.getSema().getLangOpts().CUDA)
+      return;
+
     if(CompilationStateManager::getASTPassState().isDeviceCompilation())
       HIPSYCL_DEBUG_INFO << " ****** Entering compilation mode for __device__ ****** " << std::endl;
     else
@@ -48,6 +48,24 @@ static llvm::RegisterStandardPasses
   RegisterFunctionPruningIRPass(llvm::PassManagerBuilder::EP_EarlyAsPossible,
                                 registerFunctionPruningIRPass);
 
+static void registerBarrierAnalysisIRPass(const llvm::PassManagerBuilder &,
+                                          llvm::legacy::PassManagerBase &PM) {
+  PM.add(new BarrierAnalysisIRPass{});
+}
+
+static llvm::RegisterStandardPasses
+  RegisterBarrierAnalysisIRPass(llvm::PassManagerBuilder::EP_EarlyAsPossible,
+                                registerBarrierAnalysisIRPass);
+
+static void registerBarrierLoweringIRPass(const llvm::PassManagerBuilder &,
+                                          llvm::legacy::PassManagerBase &PM) {
+  PM.add(new BarrierLoweringIRPass{});
+}
+
+static llvm::RegisterStandardPasses
+  RegisterBarrierLoweringIRPass(llvm::PassManagerBuilder::EP_EarlyAsPossible,
+                                registerBarrierLoweringIRPass);
+
 
 } // namespace hipsycl
 
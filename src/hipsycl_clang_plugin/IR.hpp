@@ -29,25 +29,88 @@
 #define HIPSYCL_IR_HPP
 
 
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/raw_ostream.h"
+#if LLVM_VERSION_MAJOR < 11
+#include "llvm/IR/CallSite.h"
+#endif
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/Demangle/Demangle.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Support/MathExtras.h"
 
 #include "CompilationState.hpp"
 
 #include "CL/sycl/detail/debug.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
 namespace hipsycl {
 
+// LLVM 11 has removed CallSite in favor of CallBase, which older
+// versions do not support in all of the APIs used here.
+#if LLVM_VERSION_MAJOR >= 11
+using CallSiteRef = llvm::CallBase*;
+#else
+using CallSiteRef = llvm::CallSite;
+#endif
+
+/// \return The call site of \c I, which converts to false if \c I
+/// is not a call or invoke instruction
+inline CallSiteRef getCallSite(llvm::Instruction& I)
+{
+#if LLVM_VERSION_MAJOR >= 11
+  return llvm::dyn_cast<llvm::CallBase>(&I);
+#else
+  return llvm::CallSite{&I};
+#endif
+}
+
+/// \return The function called by \c CS, or nullptr for indirect
+/// calls and inline assembly
+inline llvm::Function* getCallee(CallSiteRef CS)
+{
+#if LLVM_VERSION_MAJOR >= 11
+  if(CS->isInlineAsm())
+    return nullptr;
+  return llvm::dyn_cast<llvm::Function>(
+      CS->getCalledOperand()->stripPointerCasts());
+#else
+  if(CS.isInlineAsm())
+    return nullptr;
+  return llvm::dyn_cast<llvm::Function>(
+      CS.getCalledValue()->stripPointerCasts());
+#endif
+}
+
+/// Inlines the function called by \c CS without lifetime markers.
+/// \return whether inlining succeeded
+inline bool inlineCall(CallSiteRef CS, llvm::InlineFunctionInfo& IFI)
+{
+#if LLVM_VERSION_MAJOR >= 11
+  return llvm::InlineFunction(*CS, IFI, nullptr, false).isSuccess();
+#else
+  return static_cast<bool>(llvm::InlineFunction(CS, IFI, nullptr, false));
+#endif
+}
+
 class CallGraph
 {
 public:
@@ -218,6 +281,461 @@ private:
 
 char FunctionPruningIRPass::ID = 0;
 
+/// \return The demangled name of \c F, or its name if it is not mangled.
+inline std::string getDemangledName(const llvm::Function* F)
+{
+  std::string Name = F->getName().str();
+  int Status = 0;
+  char* Demangled = llvm::itaniumDemangle(Name.c_str(), nullptr, nullptr, &Status);
+  if(Demangled)
+  {
+    Name = Demangled;
+    std::free(Demangled);
+  }
+  return Name;
+}
+
+/// \return All calls of the runtime function whose demangled name
+/// contains \c QueryName, e.g. host_dispatch::barrier_free_kernel_query().
+inline std::vector<llvm::CallInst*> findQueryCalls(llvm::Module& M,
+                                                   const std::string& QueryName)
+{
+  std::vector<llvm::CallInst*> Calls;
+  for(llvm::Function& F : M)
+  {
+    if(getDemangledName(&F).find(QueryName) == std::string::npos)
+      continue;
+
+    for(llvm::User* U : F.users())
+      if(llvm::CallInst* C = llvm::dyn_cast<llvm::CallInst>(U))
+        if(C->getCalledFunction() == &F)
+          Calls.push_back(C);
+  }
+  return Calls;
+}
+
+/// Finds out whether functions can synchronize the work items of
+/// a work group on the CPU.
+///
+/// SYCL requires kernels and all functions they call to be defined
+/// in the same translation unit, so functions without a definition
+/// (e.g. math functions) are assumed to not synchronize. Indirect calls
+/// and inline assembly could do anything and are assumed to synchronize.
+class SynchronizationAnalysis
+{
+public:
+  /// \return Whether \c F is one of the functions that synchronize the
+  /// work items of a group
+  static bool isSynchronizationFunction(const llvm::Function* F)
+  {
+    // hipCPU implements __syncthreads() as OpenMP barrier
+    if(F->getName() == "__syncthreads" || F->getName() == "__kmpc_barrier")
+      return true;
+
+    std::string Name = getDemangledName(F);
+    if(Name.compare(0, 14, "__syncthreads(") == 0)
+      return true;
+
+    // All synchronizing functions of nd_item and group are
+    // implemented in terms of these.
+    if(Name.find("cl::sycl::nd_item<") != std::string::npos &&
+       Name.find(">::barrier(") != std::string::npos)
+      return true;
+    if((Name.find("cl::sycl::nd_item<") != std::string::npos ||
+        Name.find("cl::sycl::group<") != std::string::npos) &&
+       Name.find(">::mem_fence") != std::string::npos)
+      return true;
+
+    return false;
+  }
+
+  /// \return Whether \c F or any function reachable from it may synchronize
+  bool maySynchronize(llvm::Function* F)
+  {
+    auto Cached = Results.find(F);
+    if(Cached != Results.end())
+      return Cached->second;
+
+    std::unordered_set<llvm::Function*> Visited;
+    std::vector<llvm::Function*> Pending{F};
+
+    bool Result = false;
+    while(!Pending.empty() && !Result)
+    {
+      llvm::Function* Current = Pending.back();
+      Pending.pop_back();
+
+      if(!Visited.insert(Current).second)
+        continue;
+
+      if(isSynchronizationFunction(Current))
+      {
+        Result = true;
+        break;
+      }
+
+      for(llvm::BasicBlock& BB : *Current)
+        for(llvm::Instruction& I : BB)
+        {
+          CallSiteRef CS = getCallSite(I);
+          if(!CS)
+            continue;
+
+          llvm::Function* Callee = getCallee(CS);
+          if(!Callee)
+            Result = true;
+          else
+            Pending.push_back(Callee);
+        }
+    }
+
+    Results[F] = Result;
+    return Result;
+  }
+private:
+  std::unordered_map<llvm::Function*, bool> Results;
+};
+
+/// Decides whether the work items of nd_range kernels on the CPU can be
+/// executed as a loop. The runtime asks this by calling
+/// host_dispatch::barrier_free_kernel_query() with the kernel, which
+/// always returns false. This pass replaces these calls by true if no
+/// function reachable from the kernel can synchronize work items.
+struct BarrierAnalysisIRPass : public llvm::FunctionPass {
+  static char ID;
+
+  BarrierAnalysisIRPass()
+  : llvm::FunctionPass(ID)
+  {}
+
+  virtual bool runOnFunction(llvm::Function &) override
+  {
+    return false;
+  }
+
+  virtual bool doFinalization(llvm::Module& M) override
+  {
+    bool Modified = false;
+    for(llvm::CallInst* C : findQueryCalls(M,
+          "cl::sycl::detail::host_dispatch::barrier_free_kernel_query<"))
+    {
+      llvm::Function* Kernel = llvm::dyn_cast<llvm::Function>(
+          C->getArgOperand(0)->stripPointerCasts());
+
+      if(Kernel && !Analysis.maySynchronize(Kernel))
+      {
+        HIPSYCL_DEBUG_INFO << "IR Processing: Work items of kernel "
+                           << Kernel->getName().str()
+                           << " do not synchronize, executing them as loop"
+                           << std::endl;
+
+        C->replaceAllUsesWith(llvm::ConstantInt::get(C->getType(), 1));
+        C->eraseFromParent();
+        Modified = true;
+      }
+    }
+    return Modified;
+  }
+private:
+  SynchronizationAnalysis Analysis;
+};
+
+char BarrierAnalysisIRPass::ID = 0;
+
+/// Lowers the barriers of nd_range kernels on the CPU, such that
+/// the work items of a group can be executed by a single thread without
+/// switching between work item contexts.
+///
+/// The runtime asks for this by calling
+/// host_dispatch::work_item_frame_size_query() with the
+/// host_dispatch::work_item_region() instantiation of the kernel, which
+/// always returns 0. This pass inlines all functions that may synchronize
+/// into work_item_region() and splits it at each barrier:
+/// * Barrier number i is replaced by returning i. Calling the function with
+///   i as first argument continues execution after that barrier, and
+///   returning 0 means that the kernel has finished.
+/// * All local variables of the work item, including SSA values used
+///   across basic blocks, are moved to the work item frame that is passed
+///   as second argument, so that they survive between calls.
+/// The query is then replaced by the size of the frame. The runtime
+/// executes each region between barriers as a loop over the work items.
+///
+/// Functions that cannot be lowered, e.g. because they synchronize within
+/// exception handling code or an indirect call, are left alone and their
+/// work items are executed by hipCPU.
+struct BarrierLoweringIRPass : public llvm::FunctionPass {
+  static char ID;
+
+  BarrierLoweringIRPass()
+  : llvm::FunctionPass(ID)
+  {}
+
+  virtual bool runOnFunction(llvm::Function &) override
+  {
+    return false;
+  }
+
+  virtual bool doFinalization(llvm::Module& M) override
+  {
+    bool Modified = false;
+    std::unordered_map<llvm::Function*, uint64_t> FrameSizes;
+
+    for(llvm::CallInst* C : findQueryCalls(M,
+          "cl::sycl::detail::host_dispatch::work_item_frame_size_query<"))
+    {
+      llvm::Function* Region = llvm::dyn_cast<llvm::Function>(
+          C->getArgOperand(0)->stripPointerCasts());
+      if(!Region)
+        continue;
+
+      if(FrameSizes.find(Region) == FrameSizes.end())
+      {
+        FrameSizes[Region] = lowerBarriers(*Region);
+        // Inlining has modified the function even if lowering failed
+        Modified = true;
+      }
+
+      uint64_t FrameSize = FrameSizes[Region];
+      if(FrameSize > 0)
+      {
+        C->replaceAllUsesWith(llvm::ConstantInt::get(C->getType(), FrameSize));
+        C->eraseFromParent();
+      }
+    }
+    return Modified;
+  }
+private:
+  /// Inlines all calls of \c F that may synchronize and which are not
+  /// synchronization functions themselves.
+  /// \return whether all such calls could be inlined
+  bool inlineSynchronizingCalls(llvm::Function& F)
+  {
+    // Bounds the work for recursive functions, which cannot be
+    // inlined completely anyway
+    const int MaxInlinedCalls = 1024;
+
+    for(int NumInlinedCalls = 0; NumInlinedCalls < MaxInlinedCalls;
+        ++NumInlinedCalls)
+    {
+      CallSiteRef Candidate{};
+      for(llvm::BasicBlock& BB : F)
+        for(llvm::Instruction& I : BB)
+        {
+          CallSiteRef CS = getCallSite(I);
+          if(!CS || Candidate)
+            continue;
+
+          llvm::Function* Callee = getCallee(CS);
+          if(!Callee)
+            return false;
+
+          if(!SynchronizationAnalysis::isSynchronizationFunction(Callee) &&
+             Analysis.maySynchronize(Callee))
+            Candidate = CS;
+        }
+
+      if(!Candidate)
+        return true;
+
+      llvm::InlineFunctionInfo IFI;
+      if(!inlineCall(Candidate, IFI))
+        return false;
+    }
+    return false;
+  }
+
+  /// Transforms \c F into a function that returns at each barrier
+  /// as described above.
+  /// \return The size of the work item frame, or 0 if \c F cannot be
+  /// lowered. In the latter case, \c F remains semantically unchanged.
+  uint64_t lowerBarriers(llvm::Function& F)
+  {
+    llvm::LLVMContext& Ctx = F.getContext();
+    const llvm::DataLayout& DL = F.getParent()->getDataLayout();
+
+    if(F.isDeclaration() || F.arg_size() < 2 ||
+       !F.getReturnType()->isIntegerTy(32))
+      return 0;
+
+    llvm::Argument* RegionArg = &*F.arg_begin();
+    llvm::Argument* FrameArg = &*std::next(F.arg_begin());
+    if(!RegionArg->getType()->isIntegerTy(32) ||
+       FrameArg->getType() != llvm::Type::getInt8PtrTy(Ctx))
+      return 0;
+
+    if(!inlineSynchronizingCalls(F))
+    {
+      HIPSYCL_DEBUG_WARNING << "IR Processing: Cannot lower barriers of "
+                            << F.getName().str()
+                            << ", not all synchronizing calls can be inlined"
+                            << std::endl;
+      return 0;
+    }
+
+    std::vector<llvm::CallInst*> Barriers;
+    for(llvm::BasicBlock& BB : F)
+      for(llvm::Instruction& I : BB)
+      {
+        CallSiteRef CS = getCallSite(I);
+        if(!CS)
+          continue;
+        // inlineSynchronizingCalls() has made sure that there
+        // are no indirect calls
+        if(SynchronizationAnalysis::isSynchronizationFunction(getCallee(CS)))
+        {
+          if(!llvm::isa<llvm::CallInst>(&I))
+          {
+            HIPSYCL_DEBUG_WARNING << "IR Processing: Cannot lower barriers of "
+                                  << F.getName().str()
+                                  << ", barrier is invoked with exception handling"
+                                  << std::endl;
+            return 0;
+          }
+          Barriers.push_back(llvm::cast<llvm::CallInst>(&I));
+        }
+      }
+
+    if(Barriers.empty())
+      return 0;
+
+    // Split blocks behind barriers, so that each barrier is
+    // followed by the block that will be resumed.
+    std::vector<llvm::BasicBlock*> ResumeBlocks;
+    for(llvm::CallInst* Barrier : Barriers)
+      ResumeBlocks.push_back(llvm::SplitBlock(Barrier->getParent(),
+                                              Barrier->getNextNode()));
+
+    // Values used in other blocks would not be available when
+    // resuming, so store them in allocas instead (this is what the
+    // reg2mem pass does)
+    llvm::BasicBlock* OldEntry = &F.getEntryBlock();
+    std::vector<llvm::Instruction*> EscapingValues;
+    std::vector<llvm::PHINode*> Phis;
+    for(llvm::BasicBlock& BB : F)
+      for(llvm::Instruction& I : BB)
+      {
+        if(!(llvm::isa<llvm::AllocaInst>(&I) && &BB == OldEntry) &&
+           isUsedOutsideOfBlock(I))
+          EscapingValues.push_back(&I);
+        if(llvm::PHINode* Phi = llvm::dyn_cast<llvm::PHINode>(&I))
+          Phis.push_back(Phi);
+      }
+    for(llvm::Instruction* I : EscapingValues)
+      llvm::DemoteRegToStack(*I);
+    for(llvm::PHINode* Phi : Phis)
+      llvm::DemotePHIToStack(Phi);
+
+    // Lay out the work item frame
+    std::vector<llvm::AllocaInst*> Allocas;
+    std::vector<uint64_t> Offsets;
+    uint64_t FrameSize = 0;
+    for(llvm::BasicBlock& BB : F)
+      for(llvm::Instruction& I : BB)
+        if(llvm::AllocaInst* A = llvm::dyn_cast<llvm::AllocaInst>(&I))
+        {
+          llvm::ConstantInt* Count =
+              llvm::dyn_cast<llvm::ConstantInt>(A->getArraySize());
+          if(&BB != OldEntry || !Count)
+          {
+            HIPSYCL_DEBUG_WARNING << "IR Processing: Cannot lower barriers of "
+                                  << F.getName().str()
+                                  << ", it contains dynamic allocas"
+                                  << std::endl;
+            return 0;
+          }
+
+          uint64_t Alignment = std::max<uint64_t>(A->getAlignment(),
+              DL.getABITypeAlignment(A->getAllocatedType()));
+          if(Alignment > MaxFrameAlignment)
+          {
+            HIPSYCL_DEBUG_WARNING << "IR Processing: Cannot lower barriers of "
+                                  << F.getName().str()
+                                  << ", local variables need an alignment of "
+                                  << Alignment << std::endl;
+            return 0;
+          }
+
+          FrameSize = llvm::alignTo(FrameSize, Alignment);
+          Allocas.push_back(A);
+          Offsets.push_back(FrameSize);
+          FrameSize += DL.getTypeAllocSize(A->getAllocatedType()) *
+                       Count->getZExtValue();
+        }
+    FrameSize = std::max<uint64_t>(llvm::alignTo(FrameSize, MaxFrameAlignment),
+                                   MaxFrameAlignment);
+
+    // From here on, F is changed to the lowered form. Lifetime markers
+    // no longer make sense when variables live across calls.
+    std::vector<llvm::IntrinsicInst*> LifetimeMarkers;
+    for(llvm::BasicBlock& BB : F)
+      for(llvm::Instruction& I : BB)
+        if(llvm::IntrinsicInst* Intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&I))
+          if(Intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_start ||
+             Intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_end)
+            LifetimeMarkers.push_back(Intrinsic);
+    for(llvm::IntrinsicInst* Marker : LifetimeMarkers)
+      Marker->eraseFromParent();
+
+    llvm::BasicBlock* Entry =
+        llvm::BasicBlock::Create(Ctx, "region.entry", &F, OldEntry);
+    llvm::IRBuilder<> Builder{Entry};
+
+    for(std::size_t i = 0; i < Allocas.size(); ++i)
+    {
+      llvm::Value* Address = Builder.CreateInBoundsGEP(
+          Builder.getInt8Ty(), FrameArg, Builder.getInt64(Offsets[i]));
+      Address = Builder.CreateBitCast(Address, Allocas[i]->getType());
+      Address->takeName(Allocas[i]);
+
+      Allocas[i]->replaceAllUsesWith(Address);
+      Allocas[i]->eraseFromParent();
+    }
+
+    llvm::SwitchInst* Resume =
+        Builder.CreateSwitch(RegionArg, OldEntry, Barriers.size());
+    for(std::size_t i = 0; i < Barriers.size(); ++i)
+    {
+      llvm::ConstantInt* RegionId = Builder.getInt32(i + 1);
+      Resume->addCase(RegionId, ResumeBlocks[i]);
+
+      llvm::BasicBlock* BB = Barriers[i]->getParent();
+      BB->getTerminator()->eraseFromParent();
+      Barriers[i]->eraseFromParent();
+      llvm::ReturnInst::Create(Ctx, RegionId, BB);
+    }
+
+    // Other translation units may contain the original definition
+    F.setLinkage(llvm::GlobalValue::InternalLinkage);
+    F.setComdat(nullptr);
+
+    HIPSYCL_DEBUG_INFO << "IR Processing: Lowered " << Barriers.size()
+                       << " barrier(s) of " << F.getName().str()
+                       << ", work item frame size is " << FrameSize
+                       << std::endl;
+
+    return FrameSize;
+  }
+
+  static bool isUsedOutsideOfBlock(const llvm::Instruction& I)
+  {
+    for(const llvm::User* U : I.users())
+    {
+      const llvm::Instruction* UI = llvm::cast<llvm::Instruction>(U);
+      if(UI->getParent() != I.getParent() || llvm::isa<llvm::PHINode>(UI))
+        return true;
+    }
+    return false;
+  }
+
+  /// The runtime aligns work item frames to alignof(std::max_align_t)
+  static constexpr uint64_t MaxFrameAlignment = 16;
+
+  SynchronizationAnalysis Analysis;
+};
+
+char BarrierLoweringIRPass::ID = 0;
+constexpr uint64_t BarrierLoweringIRPass::MaxFrameAlignment;
+
 }
 
 #endif
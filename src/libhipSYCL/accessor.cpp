@@ -40,7 +40,8 @@ namespace detail {
 namespace accessor {
 
 void* obtain_host_access(buffer_ptr buff,
-                         access::mode access_mode)
+                         access::mode access_mode,
+                         buffer_region_list regions)
 {
 
   void* ptr = buff->get_host_ptr();
@@ -52,6 +53,7 @@ void* obtain_host_access(buffer_ptr buff,
   auto task_graph_node = detail::buffer_impl::access_host(
         buff,
         access_mode,
+        std::move(regions),
         stream,
         stream->get_error_handler());
 
@@ -64,17 +66,21 @@ void* obtain_host_access(buffer_ptr buff,
 
 void* obtain_device_access(buffer_ptr buff,
                            sycl::handler& cgh,
-                           access::mode access_mode)
+                           access::mode access_mode,
+                           buffer_region_list regions)
 {
-  void* ptr = buff->get_buffer_ptr();
+  void* ptr = buff->get_buffer_ptr(regions, cgh.get_stream());
 
   auto task_graph_node =
       detail::buffer_impl::access_device(buff,
                                          access_mode,
+                                         regions,
                                          cgh.get_stream(),
                                          cgh.get_stream()->get_error_handler());
 
-  cgh._detail_add_access(buff, access_mode, task_graph_node);
+  // The kernel only needs to wait for operations on the same regions
+  cgh._detail_add_access(buff, access_mode, task_graph_node,
+                         std::move(regions));
 
   return ptr;
 }
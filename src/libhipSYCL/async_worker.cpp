@@ -34,9 +34,29 @@ namespace cl {
 namespace sycl {
 namespace detail {
 
+namespace {
+
+// Must be a power of two. In practice, only very few operations are
+// pending at a time since the task graph collapses graph updates.
+constexpr std::size_t worker_queue_capacity = 1024;
+
+// Number of times the worker thread polls an empty queue before going
+// to sleep. Work that arrives within this window is picked up without
+// the producer having to wake up the worker.
+constexpr int worker_spin_iterations = 2000;
+
+// Number of times a thread in wait() polls before blocking
+constexpr int wait_spin_iterations = 100;
+
+}
 
 worker_thread::worker_thread()
-    : _continue{true}
+    : _continue{true},
+      _enqueued_operations{worker_queue_capacity},
+      _num_enqueued{0},
+      _num_processed{0},
+      _is_worker_sleeping{false},
+      _num_waiting_threads{0}
 {
   _worker_thread = std::thread{[this](){ work(); } };
 }
@@ -46,19 +66,29 @@ worker_thread::~worker_thread()
 {
   halt();
 
-  assert(_enqueued_operations.empty());
+  assert(queue_size() == 0);
 }
 
 void worker_thread::wait()
 {
-  std::unique_lock<std::mutex> lock(_mutex);
-  if(!_enqueued_operations.empty())
+  // Only wait for operations that have been enqueued up to now,
+  // otherwise we might never return if other threads keep
+  // enqueuing operations.
+  const std::size_t target = _num_enqueued.load();
+
+  for(int i = 0; i < wait_spin_iterations; ++i)
   {
-    // Before going to sleep, wake up the other thread to avoid deadlocks
-    _condition_wait.notify_one();
-    // Wait until no operation is pending
-    _condition_wait.wait(lock, [this]{return _enqueued_operations.empty();});
+    if(_num_processed.load() >= target)
+      return;
+    std::this_thread::yield();
   }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  ++_num_waiting_threads;
+  _work_completed.wait(lock, [this, target]{
+    return _num_processed.load() >= target;
+  });
+  --_num_waiting_threads;
 }
 
 
@@ -66,8 +96,11 @@ void worker_thread::halt()
 {
   wait();
 
-  _continue = false;
-  _condition_wait.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _continue = false;
+  }
+  _work_available.notify_one();
 
   if(_worker_thread.joinable())
     _worker_thread.join();
@@ -77,63 +110,104 @@ void worker_thread::work()
 {
   // This is the main function executed by the worker thread.
   // The loop is executed as long as there are enqueued operations,
-  // (_is_operation_pending) or we should wait for new operations
-  // (_continue).
-  while(_continue || _enqueued_operations.size() > 0)
+  // or we should wait for new operations (_continue).
+  for(;;)
   {
+    async_function operation;
+
+    // Operations in the ring buffer were enqueued before those that
+    // overflowed, so the latter are only processed once it is empty.
+    bool has_operation = _enqueued_operations.pop(operation);
+    if(!has_operation && !_overflow_operations.empty())
     {
-      std::unique_lock<std::mutex> lock(_mutex);
-
-      // Before going to sleep, wake up the other thread in case it is is waiting
-      // for the queue to get empty
-      _condition_wait.notify_one();
-      // Wait until we have work, or until _continue becomes false
-      _condition_wait.wait(lock,
-                           [this](){
-        return _enqueued_operations.size()>0 || !_continue;
-      });
+      operation = std::move(_overflow_operations.front());
+      _overflow_operations.pop_front();
+      has_operation = true;
     }
 
-    // In any way, process the pending operations
+    if(has_operation)
+    {
+      HIPSYCL_DEBUG_INFO << "Async worker thread: Processing op, "
+                            "remaining queue size: "
+                         << queue_size() - 1
+                         << std::endl;
 
-    async_function operation = [](){};
+      operation();
+      // Release resources captured by the operation before
+      // signalling completion
+      operation = async_function{};
 
-    {
-      std::lock_guard<std::mutex> lock(_mutex);
+      ++_num_processed;
 
-      if(!_enqueued_operations.empty())
+      // Only pay for the lock if someone is actually
+      // waiting for the queue to drain
+      if(_num_waiting_threads.load() > 0)
       {
-        operation = _enqueued_operations.front();
-        _enqueued_operations.pop();
-
-        HIPSYCL_DEBUG_INFO << "Async worker thread: Processing op, "
-                              "remaining queue size: "
-                  << _enqueued_operations.size()
-                  << std::endl;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _work_completed.notify_all();
       }
     }
+    else if(_continue)
+      wait_for_work();
+    else
+      return;
+  }
+}
 
-    operation();
-
-    _condition_wait.notify_one();
-
+void worker_thread::wait_for_work()
+{
+  for(int i = 0; i < worker_spin_iterations; ++i)
+  {
+    if(!_enqueued_operations.empty() || !_continue)
+      return;
+    if(i % 64 == 63)
+      std::this_thread::yield();
   }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  // Producers check this flag after publishing an operation,
+  // and we check the queue after setting it, so at least
+  // one side is guaranteed to see the other.
+  _is_worker_sleeping = true;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  _work_available.wait(lock, [this](){
+    return !_enqueued_operations.empty() || !_continue;
+  });
+  _is_worker_sleeping = false;
 }
 
 void worker_thread::operator()(worker_thread::async_function f)
 {
-  std::unique_lock<std::mutex> lock(_mutex);
+  ++_num_enqueued;
 
-  _enqueued_operations.push(f);
+  if(std::this_thread::get_id() == _worker_thread.get_id())
+  {
+    // Waiting for room would deadlock, since only the worker makes
+    // room. Once an operation has overflowed, subsequent ones
+    // follow it to preserve their order.
+    if(!_overflow_operations.empty() ||
+       !_enqueued_operations.push(std::move(f)))
+      _overflow_operations.push_back(std::move(f));
+    // The worker is obviously not sleeping
+    return;
+  }
 
-  lock.unlock();
-  _condition_wait.notify_one();
+  // If the queue is full, the worker is busy anyway - just
+  // give it some time to make room.
+  while(!_enqueued_operations.push(std::move(f)))
+    std::this_thread::yield();
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if(_is_worker_sleeping.load())
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _work_available.notify_one();
+  }
 }
 
 std::size_t worker_thread::queue_size() const
 {
-  std::lock_guard<std::mutex> lock(_mutex);
-  return _enqueued_operations.size();
+  return _num_enqueued.load() - _num_processed.load();
 }
 
 }
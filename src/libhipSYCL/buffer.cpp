@@ -28,14 +28,23 @@
 #include "CL/sycl/backend/backend.hpp"
 #include "CL/sycl/detail/buffer.hpp"
 #include "CL/sycl/exception.hpp"
+#include "CL/sycl/buffer.hpp"
+#include "CL/sycl/queue.hpp"
 #include "CL/sycl/detail/application.hpp"
 #include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/detail/device_memory_pool.hpp"
+#include "CL/sycl/detail/staging_buffer_pool.hpp"
 
 #include <cstring>
 #include <cassert>
 #include <mutex>
 #include <algorithm>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 
 namespace cl {
 namespace sycl {
@@ -52,23 +61,89 @@ static void* aligned_malloc(size_t size)
   return reinterpret_cast<void*>(new max_aligned_vector [num_aligned_units]);
 }
 
+static void free_buffer_memory(bool svm,
+                               const vector_class<void*>& device_ptrs,
+                               bool owns_host_memory,
+                               bool pinned_memory,
+                               void* host_ptr,
+                               size_t mapped_file_size)
+{
+  if(svm)
+  {
+#ifdef HIPSYCL_PLATFORM_CUDA
+    cudaFree(device_ptrs.front());
+#endif
+  }
+  else
+  {
+    for(void* device_ptr : device_ptrs)
+      device_memory_pool::get().release(device_ptr);
+
+    if(mapped_file_size > 0)
+      munmap(host_ptr, mapped_file_size);
+    else if(owns_host_memory)
+    {
+      if(pinned_memory)
+        hipHostFree(host_ptr);
+      else
+        delete [] reinterpret_cast<max_aligned_vector*>(host_ptr);
+    }
+  }
+}
+
+/// \return Whether device memory lives in the same address space as host
+/// memory, such that buffers do not need separate device allocations.
+static bool is_unified_memory_platform()
+{
+#ifdef HIPSYCL_PLATFORM_CPU
+  return true;
+#else
+  return false;
+#endif
+}
+
 static void* memory_offset(void* ptr, size_t bytes)
 {
   return reinterpret_cast<void*>(reinterpret_cast<char*>(ptr)+bytes);
 }
 
+/// Invokes f(device_ptr, begin, end) for each part of [begin, end) that
+/// is present in one of the device segments.
+template<class Segment_list, class F>
+static void for_each_device_part(const Segment_list& segments,
+                                 size_t begin, size_t end, F f)
+{
+  for(const auto& segment : segments)
+  {
+    size_t part_begin = std::max(begin, segment.begin);
+    size_t part_end = std::min(end, segment.end);
+    if(part_begin < part_end)
+      f(memory_offset(segment.ptr, part_begin - segment.begin),
+        part_begin, part_end);
+  }
+}
+
 buffer_impl::buffer_impl(size_t buffer_size,
                          void* host_ptr)
   : _svm{false},
+    _unified_memory{is_unified_memory_platform()},
     _pinned_memory{false},
     _owns_host_memory{false},
+    _host_alloc_mode{host_alloc_mode::regular},
+    _buffer_pointer{nullptr},
     _host_memory{host_ptr},
     _size{buffer_size},
     _write_back{true},
-    _write_back_memory{host_ptr}
+    _write_back_memory{host_ptr},
+    _monitor{_unified_memory, buffer_size},
+    _dependency_manager{std::make_shared<buffer_access_log>()},
+    _offset{0},
+    _staged_transfers{false},
+    _mapped_file_size{0},
+    _out_of_core{false},
+    _chunk_size{0},
+    _segment_use_counter{0}
 {
-  detail::check_error(hipMalloc(&_buffer_pointer, buffer_size));
-
   // This tells the buffer state monitor that the host pointer
   // may already have been modified, and guarantees that it will
   // be copied to the device before being used.
@@ -79,12 +154,22 @@ buffer_impl::buffer_impl(size_t buffer_size,
                          device_alloc_mode device_mode,
                          host_alloc_mode host_mode)
   : _svm{false},
+    _unified_memory{false},
     _pinned_memory{false},
     _owns_host_memory{false},
+    _host_alloc_mode{host_mode},
+    _buffer_pointer{nullptr},
     _host_memory{nullptr},
     _size{buffer_size},
     _write_back{true},
-    _write_back_memory{nullptr}
+    _write_back_memory{nullptr},
+    _dependency_manager{std::make_shared<buffer_access_log>()},
+    _offset{0},
+    _staged_transfers{false},
+    _mapped_file_size{0},
+    _out_of_core{false},
+    _chunk_size{0},
+    _segment_use_counter{0}
 {
   if((device_mode == device_alloc_mode::svm &&
       host_mode != host_alloc_mode::svm) ||
@@ -101,7 +186,10 @@ buffer_impl::buffer_impl(size_t buffer_size,
 #endif
 
   if(host_mode != host_alloc_mode::svm)
+  {
     _owns_host_memory = true;
+    _unified_memory = is_unified_memory_platform();
+  }
 
   if(_svm)
   {
@@ -112,52 +200,194 @@ buffer_impl::buffer_impl(size_t buffer_size,
     _host_memory = _buffer_pointer;
 #endif
   }
-  else
-  {
-    if(_owns_host_memory)
-    {
-      if(host_mode == host_alloc_mode::allow_pinned)
-      {
-        // Try pinned memory
-        if(hipHostMalloc(&_host_memory, _size, hipHostMallocDefault) == hipSuccess)
-          _pinned_memory = true;
-      }
+  // Otherwise, host and device memory are allocated once they are
+  // first accessed, see get_host_ptr() and get_buffer_ptr().
 
-      if(!_pinned_memory)
-        // Pinned memory was either not requested or allocation was
-        // unsuccessful
-        _host_memory = aligned_malloc(buffer_size);
-    }
+  _monitor = buffer_state_monitor{this->_svm || this->_unified_memory,
+                                  buffer_size};
+}
 
-    _write_back_memory = _host_memory;
-    detail::check_error(hipMalloc(&_buffer_pointer, buffer_size));
+buffer_impl::buffer_impl(buffer_ptr parent, size_t offset, size_t size)
+  : _svm{parent->_svm},
+    _unified_memory{parent->_unified_memory},
+    _pinned_memory{parent->_pinned_memory},
+    _owns_host_memory{false},
+    _host_alloc_mode{host_alloc_mode::regular},
+    _buffer_pointer{nullptr},
+    _host_memory{nullptr},
+    _size{size},
+    _write_back{false},
+    _write_back_memory{nullptr},
+    _monitor{parent->_svm, 0},
+    _dependency_manager{std::make_shared<buffer_access_log>()},
+    _parent{parent},
+    _offset{offset},
+    _staged_transfers{false},
+    _mapped_file_size{0},
+    _out_of_core{false},
+    _chunk_size{0},
+    _segment_use_counter{0}
+{}
+
+buffer_ptr buffer_impl::create_sub_buffer(buffer_ptr parent,
+                                          size_t offset,
+                                          size_t size)
+{
+  // Sub-buffers of sub-buffers directly refer to the root buffer
+  if(parent->_parent)
+  {
+    offset += parent->_offset;
+    parent = parent->_parent;
   }
 
-  _monitor = buffer_state_monitor{this->_svm};
+  if(offset + size > parent->_size)
+    throw invalid_object_error{"buffer_impl: Sub-buffer exceeds the "
+                               "bounds of its parent buffer"};
+
+  buffer_ptr sub_buffer{new buffer_impl{parent, offset, size}};
+
+  std::lock_guard<mutex_class> lock(parent->_mutex);
+
+  auto& sub_buffers = parent->_sub_buffers;
+  // Forget about sub-buffers that have been destroyed and
+  // whose accesses have all completed
+  sub_buffers.erase(std::remove_if(sub_buffers.begin(), sub_buffers.end(),
+                                   [](const sub_buffer_log& sub){
+    return sub.buffer.expired() && !sub.log->has_pending_operations();
+  }), sub_buffers.end());
+
+  sub_buffers.push_back(sub_buffer_log{offset, size, sub_buffer,
+                                       sub_buffer->_dependency_manager});
+
+  return sub_buffer;
 }
 
-buffer_impl::~buffer_impl()
+bool buffer_impl::is_sub_buffer() const
 {
-  _dependency_manager.wait_dependencies();
+  return _parent != nullptr;
+}
 
-  if(_svm)
+size_t buffer_impl::get_offset() const
+{
+  return _offset;
+}
+
+size_t buffer_impl::get_size() const
+{
+  return _size;
+}
+
+buffer_impl* buffer_impl::get_root()
+{
+  if(_parent)
+    return _parent.get();
+  return this;
+}
+
+task_graph_node_list
+buffer_impl::calculate_dependencies(access::mode m,
+                                    const buffer_region_list& root_regions)
+{
+  buffer_impl* root = get_root();
+
+  auto dependencies =
+      _dependency_manager->calculate_dependencies(m, root_regions);
+
+  auto add_dependencies = [&](const buffer_access_log& log){
+    auto additional_dependencies = log.calculate_dependencies(m, root_regions);
+    dependencies.insert(dependencies.end(),
+                        additional_dependencies.begin(),
+                        additional_dependencies.end());
+  };
+
+  if(root != this)
+    add_dependencies(*root->_dependency_manager);
+
+  for(const sub_buffer_log& sub : root->_sub_buffers)
   {
-#ifdef HIPSYCL_PLATFORM_CUDA
-    cudaFree(this->_buffer_pointer);
-#endif
+    if(sub.log == _dependency_manager)
+      continue;
+
+    bool overlapping = (root == this) ||
+        (_offset < sub.offset + sub.size && sub.offset < _offset + _size);
+
+    if(overlapping)
+      add_dependencies(*sub.log);
   }
-  else
+  return dependencies;
+}
+
+task_graph_node_list
+buffer_impl::calculate_dependencies(access::mode m)
+{
+  return calculate_dependencies(m, get_root_regions(get_full_region()));
+}
+
+buffer_region_list
+buffer_impl::get_root_regions(buffer_region_list regions) const
+{
+  for(buffer_region& r : regions)
   {
-    hipFree(_buffer_pointer);
+    r.begin = _offset + std::min(r.begin, _size);
+    r.end = _offset + std::min(r.end, _size);
+  }
+  return regions;
+}
 
-    if(_owns_host_memory)
-    {
-      if(_pinned_memory)
-        hipHostFree(_host_memory);
-      else
-        delete [] reinterpret_cast<max_aligned_vector*>(_host_memory);
-    }
+buffer_impl::~buffer_impl()
+{
+  // Sub-buffers do not own any memory. Their operations are
+  // tracked by the root buffer, which outlives them.
+  if(_parent)
+    return;
+
+  task_graph_node_list pending =
+      _dependency_manager->get_pending_operations();
+  for(const sub_buffer_log& sub : _sub_buffers)
+  {
+    auto sub_pending = sub.log->get_pending_operations();
+    pending.insert(pending.end(), sub_pending.begin(), sub_pending.end());
+  }
+
+  bool svm = _svm;
+  bool owns_host_memory = _owns_host_memory;
+  bool pinned_memory = _pinned_memory;
+  void* host_ptr = _host_memory;
+  size_t mapped_file_size = _mapped_file_size;
+  vector_class<void*> device_ptrs;
+  for(const device_segment& segment : get_device_segments())
+    device_ptrs.push_back(segment.ptr);
+
+  if(pending.empty())
+  {
+    free_buffer_memory(svm, device_ptrs, owns_host_memory,
+                       pinned_memory, host_ptr, mapped_file_size);
+    return;
   }
+
+  // The last reference to a buffer may be dropped while operations
+  // are still running, e.g. on hipCPU, where kernels (and the
+  // accessors they have captured) are destroyed by the thread executing
+  // the stream. Blocking here could then deadlock, so the memory is
+  // released by a task once all operations have completed.
+  // The task is inserted into the graph of the pending operations
+  // rather than the application's graph, since the runtime may
+  // already be shutting down if the buffer is destroyed as part
+  // of its cleanup. Since we may also be called while the graph
+  // is locked (when a task releases its functor during submission),
+  // the insertion happens asynchronously.
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Deferring release of memory "
+                        "until pending operations have completed"
+                     << std::endl;
+
+  detail::stream_ptr stream = pending.front()->get_stream();
+  task_graph* tg = pending.front()->get_graph();
+  tg->insert_deferred([=]() -> task_state {
+    free_buffer_memory(svm, device_ptrs, owns_host_memory,
+                       pinned_memory, host_ptr, mapped_file_size);
+    return task_state::complete;
+  }, pending, stream, stream->get_error_handler(),
+     task_execution_kind::host_synchronized, "free_buffer");
 }
 
 void buffer_impl::perform_writeback(detail::stream_ptr stream)
@@ -176,96 +406,130 @@ void buffer_impl::perform_writeback(detail::stream_ptr stream)
   }
   else
   {
-    if(_write_back &&
-       _write_back_memory != nullptr)
+    task_graph_node_ptr node = enqueue_writeback(stream);
+    if(node)
     {
+      node->wait();
+      assert(node->is_done());
+    }
+  }
+}
 
-      task_graph_node_ptr node;
+task_graph_node_ptr buffer_impl::enqueue_writeback(detail::stream_ptr stream)
+{
+  if(!_write_back || _write_back_memory == nullptr)
+  {
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Skipping write-back, write-back was disabled "
+                          "or target memory is NULL"
+                       << std::endl;
+    return nullptr;
+  }
 
-      {
-        
-        HIPSYCL_DEBUG_INFO << "buffer_impl: Preparing write-back"
-                           << std::endl;
-        std::lock_guard<mutex_class> lock(_mutex);
-
-        task_graph& tg = detail::application::get_task_graph();
-
-        auto dependencies =
-            _dependency_manager.calculate_dependencies(access::mode::read);
-
-        // It's fine to capture this here, since we will wait
-        // for this task anyway.
-        auto task = [this, stream] () -> task_state{
-
-          // If host memory is outdated, we need to perform a device->host
-          // copy to the writeback memory buffer
-          if(_monitor.is_host_outdated())
-          {
-            HIPSYCL_DEBUG_INFO << "buffer_impl: Executing async "
-                                "Device->Host copy for writeback to host buffer"
-                                << std::endl;
-                                
-            detail::check_error(hipMemcpyAsync(_write_back_memory,
-                                              _buffer_pointer,
-                                              _size,
-                                              hipMemcpyDeviceToHost,
-                                              stream->get_stream()));
-            
-            return task_state::enqueued;
-          }
-          else if (_write_back_memory != _host_memory) 
-          {
-            // If host is already up-to-date, we only need a regular memcpy from internal
-            // to writeback buffer if we use a separate writeback buffer
-            HIPSYCL_DEBUG_INFO << "buffer_impl: Copying host buffer content "
-                                  "to separate writeback buffer [host memory is already updated]"
-                               << std::endl;
-
-            // TODO Use memory_offset()
-            std::copy(reinterpret_cast<char *>(_host_memory),
-                      reinterpret_cast<char *>(_host_memory) + _size,
-                      reinterpret_cast<char *>(_write_back_memory));
-            return task_state::complete;
-          } 
-          else 
-          {
-            HIPSYCL_DEBUG_INFO << "buffer_impl: Skipping write-back, device memory and "
-                                  "write-back memory are already in sync."
-                               << std::endl;
-            return task_state::complete;
-          }
-
-        };
-
-        node = tg.insert(task,
-                         dependencies,
-                         stream,
-                         stream->get_error_handler());
-        // Write-back is logically always a read operation since
-        // it is executed at buffer destruction when the buffer cannot
-        // be changed anymore
-        _dependency_manager.add_operation(node, access::mode::read);
-      }
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Preparing write-back"
+                     << std::endl;
+  std::lock_guard<mutex_class> lock(_mutex);
 
-      assert(node != nullptr);
-      node->wait();
-      assert(node->is_done());
-      
+  task_graph& tg = detail::application::get_task_graph();
+
+  // This includes accesses through sub-buffers
+  auto dependencies = calculate_dependencies(access::mode::read);
+
+  device_segment_list segments = get_device_segments();
+
+  // The buffer may be released before the task runs if the
+  // write-back is not waited for.
+  buffer_ptr self = shared_from_this();
+  auto task = [self, stream, segments] () -> task_state{
+    return self->write_back_outdated(segments, stream);
+  };
+
+  task_graph_node_ptr node = tg.insert(task,
+                                       dependencies,
+                                       stream,
+                                       stream->get_error_handler(),
+                                       task_execution_kind::host_synchronized,
+                                       "write_back");
+  // Write-back is logically always a read operation since
+  // it is executed at buffer destruction when the buffer cannot
+  // be changed anymore
+  _dependency_manager->add_operation(node, access::mode::read,
+                                     get_root_regions(get_full_region()));
+  return node;
+}
+
+task_state
+buffer_impl::write_back_outdated(const device_segment_list& segments,
+                                 detail::stream_ptr stream)
+{
+  buffer_region_list outdated_regions;
+  {
+    std::lock_guard<mutex_class> lock(_state_mutex);
+    outdated_regions = _monitor.get_outdated_host_regions();
+  }
+
+  // If we use a separate writeback buffer, the parts that are
+  // up-to-date on the host are copied from the host memory.
+  // If the host memory has never been accessed, it does not
+  // contain any data.
+  if(_host_memory != nullptr &&
+     _write_back_memory != _host_memory)
+  {
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Copying host buffer content "
+                          "to separate writeback buffer"
+                       << std::endl;
+
+    size_t current_begin = 0;
+    auto copy_from_host = [this](size_t begin, size_t end){
+      std::copy(reinterpret_cast<char *>(memory_offset(_host_memory, begin)),
+                reinterpret_cast<char *>(memory_offset(_host_memory, end)),
+                reinterpret_cast<char *>(memory_offset(_write_back_memory, begin)));
+    };
+    for(const buffer_region& r : outdated_regions)
+    {
+      copy_from_host(current_begin, r.begin);
+      current_begin = r.end;
     }
-    else
-      HIPSYCL_DEBUG_INFO << "buffer_impl: Skipping write-back, write-back was disabled "
-                            "or target memory is NULL"
-                         << std::endl;
+    copy_from_host(current_begin, _size);
+  }
+
+  // Parts that are outdated on the host need a device->host
+  // copy to the writeback memory buffer
+  if(!outdated_regions.empty())
+  {
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Executing async "
+                        "Device->Host copy of " << outdated_regions.size()
+                       << " region(s) for writeback to host buffer"
+                        << std::endl;
+
+    for(const buffer_region& r : outdated_regions)
+      for_each_device_part(segments, r.begin, r.end,
+                           [&](void* device, size_t begin, size_t end){
+        this->memcpy_d2h(memory_offset(_write_back_memory, begin),
+                         device,
+                         end - begin,
+                         stream->get_stream());
+      });
+
+    return task_state::enqueued;
   }
+
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Skipping device->host copy for write-back, "
+                        "host memory is already up-to-date."
+                     << std::endl;
+  return task_state::complete;
 }
 
 bool buffer_impl::is_writeback_enabled() const
 {
+  if(_parent)
+    return _parent->is_writeback_enabled();
   return _write_back;
 }
 
 void* buffer_impl::get_writeback_ptr() const
 {
+  if(_parent)
+    return _parent->get_writeback_ptr();
   return _write_back_memory;
 }
 
@@ -279,17 +543,55 @@ void buffer_impl::finalize_host(detail::stream_ptr stream)
   // of scope after the buffer (but not buffer_impl) object
   // is destroyed.
   if(!_owns_host_memory)
-    _dependency_manager.wait_dependencies();
+  {
+    task_graph_node_list accesses;
+    {
+      std::lock_guard<mutex_class> lock(_mutex);
+      // This includes accesses through sub-buffers
+      accesses = calculate_dependencies(access::mode::read_write);
+    }
+    for(const auto& access : accesses)
+      access->wait();
+  }
 
   // Writeback must be triggered in any case
   perform_writeback(stream);
 }
 
+task_graph_node_ptr buffer_impl::finalize_host_async(detail::stream_ptr stream)
+{
+  // The SVM write-back is a plain memcpy on the host
+  if(_svm)
+  {
+    finalize_host(stream);
+    return nullptr;
+  }
+  return enqueue_writeback(stream);
+}
+
+task_graph_node_list buffer_impl::get_pending_operations()
+{
+  buffer_impl* root = get_root();
+  std::lock_guard<mutex_class> lock(root->_mutex);
+  // This includes accesses through sub-buffers
+  task_graph_node_list pending;
+  for(const task_graph_node_ptr& node :
+      calculate_dependencies(access::mode::read_write))
+    if(!node->is_done())
+      pending.push_back(node);
+  return pending;
+}
+
 bool buffer_impl::is_svm_buffer() const
 {
   return _svm;
 }
 
+bool buffer_impl::is_unified_memory_buffer() const
+{
+  return _unified_memory;
+}
+
 bool buffer_impl::owns_host_memory() const
 {
   return _owns_host_memory;
@@ -300,39 +602,52 @@ bool buffer_impl::owns_pinned_host_memory() const
   return _pinned_memory;
 }
 
-void buffer_impl::update_host(size_t begin, size_t end, hipStream_t stream)
+void buffer_impl::update_host(size_t begin, size_t end,
+                              const device_segment_list& segments,
+                              hipStream_t stream)
 {
-  if(!_svm)
+  if(!_svm && !_unified_memory)
   {
     assert(_host_memory != nullptr);
-    this->memcpy_d2h(memory_offset(_host_memory, begin),
-                     memory_offset(_buffer_pointer, begin),
-                     end-begin,
-                     stream);
+    for_each_device_part(segments, begin, end,
+                         [&](void* device, size_t part_begin, size_t part_end){
+      this->memcpy_d2h(memory_offset(_host_memory, part_begin),
+                       device,
+                       part_end - part_begin,
+                       stream);
+    });
   }
 }
 
-void buffer_impl::update_host(hipStream_t stream)
-{
-  update_host(0, this->_size, stream);
-}
-
 
-void buffer_impl::update_device(size_t begin, size_t end, hipStream_t stream)
+void buffer_impl::update_device(size_t begin, size_t end,
+                                const device_segment_list& segments,
+                                hipStream_t stream)
 {
-  if(!_svm)
+  if(!_svm && !_unified_memory)
   {
     assert(_host_memory != nullptr);
-    this->memcpy_h2d(memory_offset(_buffer_pointer, begin),
-                     memory_offset(_host_memory, begin),
-                     end-begin,
-                     stream);
+    if(_mapped_file_size > 0)
+    {
+      // Start reading the range from the file before it is copied
+      size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      size_t page_begin = (begin / page_size) * page_size;
+      madvise(memory_offset(_host_memory, page_begin),
+              end - page_begin, MADV_WILLNEED);
+    }
+    for_each_device_part(segments, begin, end,
+                         [&](void* device, size_t part_begin, size_t part_end){
+      this->memcpy_h2d(device,
+                       memory_offset(_host_memory, part_begin),
+                       part_end - part_begin,
+                       stream);
+    });
   }
 }
 
-void buffer_impl::update_device(hipStream_t stream)
+buffer_region_list buffer_impl::get_full_region() const
 {
-  update_device(0, this->_size, stream);
+  return buffer_region_list{{0, _size}};
 }
 
 void buffer_impl::write(const void* host_data, hipStream_t stream, bool async)
@@ -340,40 +655,70 @@ void buffer_impl::write(const void* host_data, hipStream_t stream, bool async)
   std::lock_guard<mutex_class> lock(_mutex);
 
   assert(host_data != nullptr);
-  if(!_svm)
+  if(_mapped_file_size > 0)
+    throw invalid_parameter_error{"buffer_impl: File-backed buffers cannot "
+                                  "be initialized from host data"};
+
+  if(_out_of_core)
+  {
+    // Out-of-core buffers are initialized on the host, and paged
+    // into device memory once they are accessed.
+    memcpy(this->get_host_ptr(), host_data, _size);
+
+    std::lock_guard<mutex_class> state_lock(_state_mutex);
+    _monitor.register_host_access(access::mode::discard_write);
+  }
+  else if(!_svm && !_unified_memory)
   {
-    this->memcpy_h2d(_buffer_pointer, host_data, _size, stream);
+    this->memcpy_h2d(this->get_buffer_ptr(), host_data, _size, stream);
     if(!async)
       detail::check_error(hipStreamSynchronize(stream));
+
+    // The data is only present on the device
+    std::lock_guard<mutex_class> state_lock(_state_mutex);
+    _monitor.register_device_access(access::mode::discard_write);
   }
   else
   {
-    memcpy(_buffer_pointer, _host_memory, _size);
+    memcpy(this->get_buffer_ptr(), host_data, _size);
   }
 }
 
 
 void buffer_impl::set_write_back(void* ptr)
 {
+  // Sub-buffers share the write-back settings of their parent
+  if(_parent)
+    return _parent->set_write_back(ptr);
+
   std::lock_guard<mutex_class> lock(_mutex);
   this->_write_back_memory = ptr;
 }
 
 void buffer_impl::enable_write_back(bool writeback)
 {
+  if(_parent)
+    return _parent->enable_write_back(writeback);
+
   std::lock_guard<mutex_class> lock(_mutex);
   this->_write_back = writeback;
 }
 
 task_state
-buffer_impl::execute_buffer_action(buffer_action a, hipStream_t stream)
+buffer_impl::execute_buffer_action(buffer_action a,
+                                   const buffer_region_list& regions,
+                                   const device_segment_list& segments,
+                                   hipStream_t stream)
 {
-  if(a != buffer_action::none)
+  if(a != buffer_action::none && !regions.empty())
   {
-    if(a == buffer_action::update_device)
-      this->update_device(stream);
-    else if(a == buffer_action::update_host)
-      this->update_host(stream);
+    for(const buffer_region& r : regions)
+    {
+      if(a == buffer_action::update_device)
+        this->update_device(r.begin, r.end, segments, stream);
+      else if(a == buffer_action::update_host)
+        this->update_host(r.begin, r.end, segments, stream);
+    }
 
     return task_state::enqueued;
   }
@@ -386,47 +731,113 @@ buffer_impl::execute_buffer_action(buffer_action a, hipStream_t stream)
 
 void buffer_impl::memcpy_d2h(void* host, const void* device, size_t len, hipStream_t stream)
 {
-  HIPSYCL_DEBUG_INFO << "buffer_impl: Executing async "
-                        "Device->Host copy of size "
+  bool staged = this->is_staging_required(host, len);
+
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Executing "
+                     << (staged ? "staged " : "async ")
+                     << "Device->Host copy of size "
                      << len
                      << std::endl;
 
-  detail::check_error(hipMemcpyAsync(host, device, len,
-                                     hipMemcpyDeviceToHost, stream));
+  if(tracer::is_enabled())
+    tracer::get().record_transfer(staged ? "memcpy_d2h_staged" : "memcpy_d2h",
+                                  len, stream);
+
+  if(staged)
+    staging_buffer_pool::get().memcpy_d2h(host, device, len, stream);
+  else
+    detail::check_error(hipMemcpyAsync(host, device, len,
+                                       hipMemcpyDeviceToHost, stream));
 
 }
 
 void buffer_impl::memcpy_h2d(void* device, const void* host, size_t len, hipStream_t stream)
 {
-  HIPSYCL_DEBUG_INFO << "buffer_impl: Executing async "
-                        "Host->Device copy of size " 
+  bool staged = this->is_staging_required(host, len);
+
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Executing "
+                     << (staged ? "staged " : "async ")
+                     << "Host->Device copy of size "
                      << len
                      << std::endl;
 
-  detail::check_error(hipMemcpyAsync(device, host, len,
-                                     hipMemcpyHostToDevice, stream));
+  if(tracer::is_enabled())
+    tracer::get().record_transfer(staged ? "memcpy_h2d_staged" : "memcpy_h2d",
+                                  len, stream);
+
+  if(staged)
+    staging_buffer_pool::get().memcpy_h2d(device, host, len, stream);
+  else
+    detail::check_error(hipMemcpyAsync(device, host, len,
+                                       hipMemcpyHostToDevice, stream));
+}
+
+bool buffer_impl::is_staging_required(const void* host, size_t len) const
+{
+  if(!_staged_transfers || len < staging_buffer_pool::min_staged_size)
+    return false;
+
+  // The write-back memory may be pageable even if our host memory is pinned
+  const char* host_begin = reinterpret_cast<const char*>(_host_memory);
+  const char* ptr = reinterpret_cast<const char*>(host);
+  bool is_pinned = _pinned_memory &&
+                   ptr >= host_begin && ptr < host_begin + _size;
+
+  return !is_pinned;
+}
+
+void buffer_impl::enable_pinned_staging(bool staging)
+{
+  // Transfers are performed by the root buffer
+  if(_parent)
+    return _parent->enable_pinned_staging(staging);
+
+  std::lock_guard<mutex_class> lock(_mutex);
+  this->_staged_transfers = staging;
 }
 
 task_graph_node_ptr
 buffer_impl::access_host(detail::buffer_ptr buff,
                          access::mode m,
+                         buffer_region_list regions,
                          detail::stream_ptr stream,
                          async_handler error_handler)
 {
-  std::lock_guard<mutex_class> lock(buff->_mutex);
+  // Sub-buffers use the memory and data state of their root buffer
+  buffer_ptr root = buff->_parent ? buff->_parent : buff;
+  regions = buff->get_root_regions(std::move(regions));
+  // Usually, the memory has already been allocated when the
+  // accessor was constructed.
+  root->get_host_ptr();
+
+  std::lock_guard<mutex_class> lock(root->_mutex);
 
   task_graph& tg = detail::application::get_task_graph();
 
-  auto dependencies = buff->_dependency_manager.calculate_dependencies(m);
+  auto dependencies = buff->calculate_dependencies(m, regions);
+  auto segments = root->get_device_segments();
 
-  auto task = [buff, m, stream] () -> task_state {
-    return buff->execute_buffer_action(
-          buff->_monitor.register_host_access(m),
-          stream->get_stream());
+  // The segments are only needed by the task and can be moved into it
+  auto task = [root, m, regions, segments = std::move(segments), stream]
+      () -> task_state {
+    buffer_region_list transfers;
+    {
+      // Accesses to disjoint sub-buffers may run concurrently
+      std::lock_guard<mutex_class> lock(root->_state_mutex);
+      transfers = root->_monitor.register_host_access(m, regions);
+    }
+    return root->execute_buffer_action(buffer_action::update_host,
+                                       transfers,
+                                       segments,
+                                       stream->get_stream());
   };
 
-  task_graph_node_ptr node = tg.insert(task, dependencies, stream, error_handler);
-  buff->_dependency_manager.add_operation(node, m);
+  // Buffer actions only enqueue memory transfers on the stream
+  task_graph_node_ptr node = tg.insert(task, std::move(dependencies), stream,
+                                       error_handler,
+                                       task_execution_kind::stream_ordered,
+                                       "access_host");
+  buff->_dependency_manager->add_operation(node, m, std::move(regions));
 
   return node;
 }
@@ -434,24 +845,47 @@ buffer_impl::access_host(detail::buffer_ptr buff,
 task_graph_node_ptr
 buffer_impl::access_device(detail::buffer_ptr buff,
                            access::mode m,
+                           buffer_region_list regions,
                            detail::stream_ptr stream,
                            async_handler error_handler)
 {
-  std::lock_guard<mutex_class> lock(buff->_mutex);
+  // Sub-buffers use the memory and data state of their root buffer
+  buffer_ptr root = buff->_parent ? buff->_parent : buff;
+  regions = buff->get_root_regions(std::move(regions));
+  // Usually, the memory has already been allocated (or, for out-of-core
+  // buffers, the regions have been mapped) when the accessor was
+  // constructed.
+  root->get_buffer_ptr(regions, stream);
 
-  task_graph& tg = detail::application::get_task_graph();
+  std::lock_guard<mutex_class> lock(root->_mutex);
 
-  auto dependencies = buff->_dependency_manager.calculate_dependencies(m);
+  task_graph& tg = detail::application::get_task_graph();
 
-  auto task = [buff, m, stream] () -> task_state {
-    return buff->execute_buffer_action(
-          buff->_monitor.register_device_access(m),
-          stream->get_stream());
+  auto dependencies = buff->calculate_dependencies(m, regions);
+  auto segments = root->get_device_segments();
 
+  // The segments are only needed by the task and can be moved into it
+  auto task = [root, m, regions, segments = std::move(segments), stream]
+      () -> task_state {
+    buffer_region_list transfers;
+    {
+      // Accesses to disjoint sub-buffers may run concurrently
+      std::lock_guard<mutex_class> lock(root->_state_mutex);
+      transfers = root->_monitor.register_device_access(m, regions);
+    }
+    return root->execute_buffer_action(buffer_action::update_device,
+                                       transfers,
+                                       segments,
+                                       stream->get_stream());
   };
 
-  task_graph_node_ptr node = tg.insert(task, dependencies, stream, error_handler);
-  buff->_dependency_manager.add_operation(node, m);
+  // Buffer actions only enqueue memory transfers on the stream
+  task_graph_node_ptr node = tg.insert(std::move(task),
+                                       std::move(dependencies), stream,
+                                       error_handler,
+                                       task_execution_kind::stream_ordered,
+                                       "access_device");
+  buff->_dependency_manager->add_operation(node, m, std::move(regions));
 
   return node;
 }
@@ -460,136 +894,597 @@ void
 buffer_impl::register_external_access(const task_graph_node_ptr& task,
                                       access::mode m)
 {
-  std::lock_guard<mutex_class> lock(_mutex);
-  this->_dependency_manager.add_operation(task, m);
+  register_external_access(task, m, get_full_region());
+}
+
+void
+buffer_impl::register_external_access(const task_graph_node_ptr& task,
+                                      access::mode m,
+                                      buffer_region_list regions)
+{
+  buffer_impl* root = get_root();
+  std::lock_guard<mutex_class> lock(root->_mutex);
+  this->_dependency_manager->add_operation(task, m,
+                                           get_root_regions(std::move(regions)));
+
+  // Segments mapped for the operation may now be evicted, since
+  // evictions will wait for it.
+  for(device_segment& segment : root->_segments)
+    segment.pending_use = false;
 }
 
-void* buffer_impl::get_buffer_ptr() const
+void* buffer_impl::get_buffer_ptr()
 {
+  if(_parent)
+    return memory_offset(_parent->get_buffer_ptr(), _offset);
+
+  if(_out_of_core)
+    throw feature_not_supported{"buffer_impl: Out-of-core buffers are only "
+                                "accessible on the device through accessors "
+                                "that are not placeholders"};
+
+  // Kernels work directly on the host memory
+  if(_unified_memory)
+    return get_host_ptr();
+
+  std::lock_guard<mutex_class> lock(_allocation_mutex);
+  if(_buffer_pointer == nullptr)
+  {
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Allocating device memory "
+                          "on first device access" << std::endl;
+    _buffer_pointer = device_memory_pool::get().allocate(_size);
+  }
   return _buffer_pointer;
 }
 
-void* buffer_impl::get_host_ptr() const
+void* buffer_impl::get_buffer_ptr(const buffer_region_list& regions,
+                                  detail::stream_ptr stream)
 {
+  buffer_impl* root = get_root();
+  if(!root->_out_of_core)
+    return get_buffer_ptr();
+
+  buffer_region_list root_regions = get_root_regions(regions);
+  size_t begin = root->_size;
+  size_t end = 0;
+  for(const buffer_region& r : root_regions)
+  {
+    begin = std::min(begin, r.begin);
+    end = std::max(end, r.end);
+  }
+  if(begin >= end)
+  {
+    begin = std::min(_offset, root->_size);
+    end = begin;
+  }
+
+  std::unique_lock<mutex_class> lock(root->_mutex);
+  return memory_offset(root->map_out_of_core_range(begin, end, lock,
+                                                   std::move(stream)),
+                       _offset);
+}
+
+void* buffer_impl::get_host_ptr()
+{
+  if(_parent)
+    return memory_offset(_parent->get_host_ptr(), _offset);
+
+  std::lock_guard<mutex_class> lock(_allocation_mutex);
+  if(_host_memory == nullptr && _owns_host_memory)
+  {
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Allocating host memory "
+                          "on first host access" << std::endl;
+
+    if(_host_alloc_mode == host_alloc_mode::allow_pinned)
+    {
+      // Try pinned memory
+      if(hipHostMalloc(&_host_memory, _size, hipHostMallocDefault) == hipSuccess)
+        _pinned_memory = true;
+    }
+
+    if(!_pinned_memory)
+      // Pinned memory was either not requested or allocation was
+      // unsuccessful
+      _host_memory = aligned_malloc(_size);
+  }
   return _host_memory;
 }
 
-// ----------- buffer_state_monitor ----------------
+buffer_impl::device_segment_list
+buffer_impl::get_device_segments() const
+{
+  if(_out_of_core)
+    return _segments;
+  return device_segment_list{
+    device_segment{0, _size, _buffer_pointer, 0, false}};
+}
 
-buffer_state_monitor::buffer_state_monitor(bool is_svm)
-  : _svm{is_svm}, _host_data_version{0}, _device_data_version{0}
-{}
+void* buffer_impl::map_out_of_core_range(size_t begin, size_t end,
+                                         std::unique_lock<mutex_class>& lock,
+                                         detail::stream_ptr stream)
+{
+  // The host memory holds all parts of the buffer that are not
+  // present on the device
+  this->get_host_ptr();
+
+  ++_segment_use_counter;
+
+  auto get_base_ptr = [](const device_segment& segment){
+    return reinterpret_cast<void*>(
+        reinterpret_cast<char*>(segment.ptr) - segment.begin);
+  };
 
+  size_t chunk_begin = (begin / _chunk_size) * _chunk_size;
+  size_t chunk_end = std::max(end, chunk_begin + 1);
+  chunk_end = std::min(_size,
+                       ((chunk_end + _chunk_size - 1) / _chunk_size) * _chunk_size);
 
-buffer_action buffer_state_monitor::register_host_access(access::mode m)
+  for(;;)
+  {
+    for(device_segment& segment : _segments)
+    {
+      if(segment.begin <= begin && end <= segment.end)
+      {
+        segment.last_use = _segment_use_counter;
+        segment.pending_use = true;
+        return get_base_ptr(segment);
+      }
+    }
+
+    HIPSYCL_DEBUG_INFO << "buffer_impl: Mapping out-of-core range ["
+                       << chunk_begin << ", " << chunk_end
+                       << ") into device memory" << std::endl;
+
+    // Every part of the buffer is present in at most one segment,
+    // so segments overlapping the new one are evicted first.
+    task_graph_node_list evictions;
+    for(auto segment = _segments.begin(); segment != _segments.end();)
+    {
+      if(segment->begin < chunk_end && chunk_begin < segment->end)
+      {
+        if(segment->pending_use)
+          throw feature_not_supported{"buffer_impl: Overlapping ranges of an "
+                                      "out-of-core buffer that are accessed by "
+                                      "one command group must lie within the "
+                                      "same chunks"};
+        evictions.push_back(evict_segment(*segment, stream));
+        segment = _segments.erase(segment);
+      }
+      else
+        ++segment;
+    }
+
+    void* ptr = device_memory_pool::get().try_allocate(chunk_end - chunk_begin);
+    if(ptr != nullptr)
+    {
+      _segments.push_back(device_segment{chunk_begin, chunk_end, ptr,
+                                         _segment_use_counter, true});
+      return get_base_ptr(_segments.back());
+    }
+
+    if(evictions.empty())
+    {
+      auto lru = _segments.end();
+      for(auto segment = _segments.begin(); segment != _segments.end(); ++segment)
+        if(!segment->pending_use &&
+           (lru == _segments.end() || segment->last_use < lru->last_use))
+          lru = segment;
+
+      if(lru == _segments.end())
+        throw memory_allocation_error{"buffer_impl: The ranges of an "
+                                      "out-of-core buffer accessed by a "
+                                      "command group exceed the available "
+                                      "device memory"};
+
+      HIPSYCL_DEBUG_INFO << "buffer_impl: Out of device memory, evicting "
+                            "out-of-core range ["
+                         << lru->begin << ", " << lru->end << ")"
+                         << std::endl;
+      evictions.push_back(evict_segment(*lru, stream));
+      _segments.erase(lru);
+    }
+
+    // Evictions release their memory once they have completed. They
+    // may depend on operations that need the mutex, and other threads
+    // may map or evict segments in the meantime, such that the
+    // segments are looked up again afterwards.
+    lock.unlock();
+    for(const auto& eviction : evictions)
+      eviction->wait();
+    lock.lock();
+  }
+}
+
+task_graph_node_ptr buffer_impl::evict_segment(const device_segment& segment,
+                                               detail::stream_ptr stream)
 {
+  task_graph& tg = detail::application::get_task_graph();
+
+  // Only operations on the segment use its memory
+  buffer_region_list segment_region{{segment.begin, segment.end}};
+  auto dependencies = calculate_dependencies(access::mode::read_write,
+                                             segment_region);
+  buffer_ptr self = shared_from_this();
+
+  auto task = [self, segment, stream]() -> task_state {
+    // Registering a host write guarantees that the range is
+    // transferred again before it is used on the device
+    buffer_region_list modified;
+    {
+      std::lock_guard<mutex_class> lock(self->_state_mutex);
+      modified = self->_monitor.register_host_access(
+          access::mode::read_write,
+          buffer_region_list{{segment.begin, segment.end}});
+    }
+
+    for(const buffer_region& r : modified)
+      self->memcpy_d2h(memory_offset(self->_host_memory, r.begin),
+                       memory_offset(segment.ptr, r.begin - segment.begin),
+                       r.end - r.begin,
+                       stream->get_stream());
+
+    if(modified.empty())
+    {
+      device_memory_pool::get().release(segment.ptr);
+      return task_state::complete;
+    }
+    device_memory_pool::get().release(segment.ptr, stream->get_stream());
+    return task_state::enqueued;
+  };
+
+  task_graph_node_ptr node = tg.insert(task, std::move(dependencies), stream,
+                                       stream->get_error_handler(),
+                                       task_execution_kind::host_synchronized,
+                                       "evict_segment");
+  _dependency_manager->add_operation(node, access::mode::read_write,
+                                     std::move(segment_region));
+  return node;
+}
+
+void buffer_impl::enable_out_of_core(size_t chunk_size)
+{
+  if(chunk_size == 0)
+    throw invalid_parameter_error{"buffer_impl: The chunk size of "
+                                  "out-of-core buffers must not be 0"};
   if(_svm)
+    throw invalid_parameter_error{"buffer_impl: SVM buffers cannot "
+                                  "be out-of-core"};
+
+  std::lock_guard<mutex_class> lock(_mutex);
+  _out_of_core = true;
+  _chunk_size = chunk_size;
+  // Paging requires device memory that is separate from the host memory
+  _unified_memory = false;
+
+  std::lock_guard<mutex_class> state_lock(_state_mutex);
+  _monitor = buffer_state_monitor{false, _size};
+  // Nothing is present on the device yet
+  _monitor.register_host_access(access::mode::read_write);
+}
+
+bool buffer_impl::is_out_of_core() const
+{
+  if(_parent)
+    return _parent->is_out_of_core();
+  return _out_of_core;
+}
+
+void buffer_impl::map_file(const string_class& path, bool writable)
+{
+  if(_parent || !_owns_host_memory)
+    throw invalid_parameter_error{"buffer_impl: Only buffers that allocate "
+                                  "their own host memory can be file-backed"};
+
+  std::lock_guard<mutex_class> lock(_mutex);
+  std::lock_guard<mutex_class> allocation_lock(_allocation_mutex);
+  if(_host_memory != nullptr)
+    throw invalid_object_error{"buffer_impl: Files must be mapped before "
+                               "the buffer is accessed"};
+
+  int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+  if(fd < 0)
+    throw invalid_parameter_error{"buffer_impl: Could not open file " + path};
+
+  struct stat file_info;
+  bool is_large_enough = fstat(fd, &file_info) == 0 &&
+                         static_cast<size_t>(file_info.st_size) >= _size;
+  if(!is_large_enough &&
+     (!writable || ftruncate(fd, static_cast<off_t>(_size)) != 0))
   {
-    // With svm, host and device are always in sync
-    _host_data_version = 0;
-    _device_data_version = 0;
+    close(fd);
+    throw invalid_parameter_error{"buffer_impl: File " + path +
+                                  " is smaller than the buffer"};
   }
-  else
-  {
-    HIPSYCL_DEBUG_INFO << "buffer_state_info: host access, current data versions: host-side is @"
-                       << _host_data_version
-                       << ", device side is @"
-                       << _device_data_version
-                       << std::endl;
 
-    // Make sure host is up-to-date before reading
-    bool copy_required = this->is_host_outdated();
-    bool read_only = (m == access::mode::read);
+  // Private mappings are copy-on-write, so that read-only files may
+  // still be modified through the buffer.
+  void* ptr = mmap(nullptr, _size, PROT_READ | PROT_WRITE,
+                   writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  // The mapping remains valid without the descriptor
+  close(fd);
+  if(ptr == MAP_FAILED)
+    throw memory_allocation_error{"buffer_impl: Could not map file " + path};
+
+  HIPSYCL_DEBUG_INFO << "buffer_impl: Mapped file " << path
+                     << (writable ? " for reading and writing" : " for reading")
+                     << std::endl;
 
-    // If we are discarding the previous content anyway,
-    // a data transfer is never required
-    if(m == access::mode::discard_write ||
-       m == access::mode::discard_read_write)
-      copy_required = false;
+  // Large inputs are typically streamed through from beginning to end
+  madvise(ptr, _size, MADV_SEQUENTIAL);
 
-    size_t version_bump = read_only ? 0 : 1;
-    _host_data_version =
-      std::max(_host_data_version, _device_data_version) + version_bump;
+  _host_memory = ptr;
+  _mapped_file_size = _size;
+  _owns_host_memory = false;
+  _write_back = writable;
+  _write_back_memory = writable ? ptr : nullptr;
 
-    HIPSYCL_DEBUG_INFO << "buffer_state_info: (new state: host @"
-                       << _host_data_version << ", device @"
-                       << _device_data_version << ")"
-                       << std::endl;
+  std::lock_guard<mutex_class> state_lock(_state_mutex);
+  // The file content is only present on the host
+  _monitor.register_host_access(access::mode::read_write);
+}
+
+bool buffer_impl::is_file_backed() const
+{
+  if(_parent)
+    return _parent->is_file_backed();
+  return _mapped_file_size > 0;
+}
+
+// ----------- buffer_state_monitor ----------------
+
+buffer_state_monitor::buffer_state_monitor(bool is_svm, size_t buffer_size)
+  : _svm{is_svm}, _size{buffer_size}
+{
+  _regions[0] = region_state::synchronized;
+}
+
+void buffer_state_monitor::split_at(size_t pos)
+{
+  if(pos >= _size)
+    return;
+
+  // The region containing pos
+  auto it = _regions.upper_bound(pos);
+  --it;
+  if(it->first != pos)
+    _regions.emplace_hint(std::next(it), pos, it->second);
+}
 
-    if(copy_required)
-      return buffer_action::update_host;
+void buffer_state_monitor::merge_regions(size_t begin, size_t end)
+{
+  auto it = _regions.upper_bound(begin);
+  // Start at the region before the one containing begin,
+  // since it may have to be merged as well
+  if(it != _regions.begin())
+    --it;
+  if(it != _regions.begin())
+    --it;
+
+  while(it != _regions.end() && it->first <= end)
+  {
+    auto next = std::next(it);
+    if(next != _regions.end() && next->second == it->second)
+      _regions.erase(next);
+    else
+      it = next;
   }
-  return buffer_action::none;
 }
 
-buffer_action buffer_state_monitor::register_device_access(access::mode m)
+size_t
+buffer_state_monitor::get_region_end(region_map::const_iterator it) const
 {
-  if(_svm)
+  auto next = std::next(it);
+  if(next == _regions.end())
+    return _size;
+  return next->first;
+}
+
+buffer_region_list
+buffer_state_monitor::register_access(const buffer_region_list& regions,
+                                      region_state outdated_state,
+                                      bool discard,
+                                      bool written)
+{
+  // After a write, the accessing side holds the newest data
+  region_state written_state = (outdated_state == region_state::device_newer) ?
+        region_state::host_newer : region_state::device_newer;
+
+  buffer_region_list outdated_regions;
+
+  for(const buffer_region& r : regions)
   {
-    // With svm, host and device are always in sync
-    _host_data_version = 0;
-    _device_data_version = 0;
+    size_t begin = std::min(r.begin, _size);
+    size_t end = std::min(r.end, _size);
+    if(begin >= end)
+      continue;
+
+    this->split_at(begin);
+    this->split_at(end);
+
+    for(auto it = _regions.find(begin);
+        it != _regions.end() && it->first < end;
+        ++it)
+    {
+      // If we are discarding the previous content anyway,
+      // a data transfer is never required
+      if(it->second == outdated_state && !discard)
+        outdated_regions.push_back({it->first, get_region_end(it)});
+
+      if(written)
+        it->second = written_state;
+      else if(it->second == outdated_state)
+        it->second = region_state::synchronized;
+    }
+
+    this->merge_regions(begin, end);
   }
-  else
+
+  // Regions may have been passed in any order, so sort
+  // before merging adjacent transfers
+  std::sort(outdated_regions.begin(), outdated_regions.end(),
+            [](const buffer_region& a, const buffer_region& b){
+    return a.begin < b.begin;
+  });
+
+  buffer_region_list transfers;
+  for(const buffer_region& r : outdated_regions)
   {
-     HIPSYCL_DEBUG_INFO << "buffer_state_info: device access, current data versions: host-side is @"
-                       << _host_data_version
-                       << ", device side is @"
-                       << _device_data_version
-                       << std::endl;
+    if(!transfers.empty() && transfers.back().end >= r.begin)
+      transfers.back().end = std::max(transfers.back().end, r.end);
+    else
+      transfers.push_back(r);
+  }
+  return transfers;
+}
 
-    // Make sure device is up-to-date before reading
-    bool copy_required = this->is_device_outdated();
-    bool read_only = (m == access::mode::read);
+buffer_region_list
+buffer_state_monitor::register_host_access(access::mode m,
+                                           const buffer_region_list& regions)
+{
+  if(_svm)
+    // With svm, host and device are always in sync
+    return buffer_region_list{};
 
-    // If we are discarding the previous content anyway,
-    // a data transfer is never required
-    if(m == access::mode::discard_write ||
-       m == access::mode::discard_read_write)
-      copy_required = false;
+  HIPSYCL_DEBUG_INFO << "buffer_state_info: host access to "
+                     << regions.size() << " region(s), "
+                     << _regions.size() << " tracked region(s)"
+                     << std::endl;
 
-    size_t version_bump = read_only ? 0 : 1;
-    _device_data_version =
-      std::max(_host_data_version, _device_data_version) + version_bump;
+  // Make sure host is up-to-date before reading
+  return register_access(regions,
+                         region_state::device_newer,
+                         m == access::mode::discard_write ||
+                         m == access::mode::discard_read_write,
+                         m != access::mode::read);
+}
 
-    HIPSYCL_DEBUG_INFO << "buffer_state_info: (new state: host @"
-                       << _host_data_version << ", device @"
-                       << _device_data_version << ")"
-                       << std::endl;
+buffer_region_list
+buffer_state_monitor::register_device_access(access::mode m,
+                                             const buffer_region_list& regions)
+{
+  if(_svm)
+    // With svm, host and device are always in sync
+    return buffer_region_list{};
 
-    if(copy_required)
-      return buffer_action::update_device;
+  HIPSYCL_DEBUG_INFO << "buffer_state_info: device access to "
+                     << regions.size() << " region(s), "
+                     << _regions.size() << " tracked region(s)"
+                     << std::endl;
 
-  }
-  return buffer_action::none;
+  // Make sure device is up-to-date before reading
+  return register_access(regions,
+                         region_state::host_newer,
+                         m == access::mode::discard_write ||
+                         m == access::mode::discard_read_write,
+                         m != access::mode::read);
+}
+
+buffer_region_list
+buffer_state_monitor::register_host_access(access::mode m)
+{
+  return register_host_access(m, buffer_region_list{{0, _size}});
+}
+
+buffer_region_list
+buffer_state_monitor::register_device_access(access::mode m)
+{
+  return register_device_access(m, buffer_region_list{{0, _size}});
 }
 
 bool buffer_state_monitor::is_host_outdated() const
 {
-  return this->_host_data_version < this->_device_data_version;
+  for(const auto& region : _regions)
+    if(region.second == region_state::device_newer)
+      return true;
+  return false;
 }
 
 bool buffer_state_monitor::is_device_outdated() const
 {
-  return this->_device_data_version < this->_host_data_version;
+  for(const auto& region : _regions)
+    if(region.second == region_state::host_newer)
+      return true;
+  return false;
+}
+
+buffer_region_list
+buffer_state_monitor::get_outdated_host_regions() const
+{
+  buffer_region_list result;
+  for(auto it = _regions.begin(); it != _regions.end(); ++it)
+    if(it->second == region_state::device_newer)
+      result.push_back({it->first, get_region_end(it)});
+  return result;
+}
+
+std::size_t buffer_state_monitor::get_num_tracked_regions() const
+{
+  return _regions.size();
 }
 
 // -------------- buffer_access_log ----------------
 
 
+/// \return Whether any of the sorted regions \a a overlaps with
+/// any of the sorted regions \a b
+static bool regions_overlap(const buffer_region_list& a,
+                            const buffer_region_list& b)
+{
+  auto it_a = a.begin();
+  auto it_b = b.begin();
+  while(it_a != a.end() && it_b != b.end())
+  {
+    if(it_a->begin < it_b->end && it_b->begin < it_a->end)
+      return true;
+    // The region that ends first cannot overlap with any
+    // later region of the other list
+    if(it_a->end <= it_b->end)
+      ++it_a;
+    else
+      ++it_b;
+  }
+  return false;
+}
+
+/// \return Whether each of the sorted regions \a inner lies
+/// within one of the sorted regions \a outer
+static bool regions_cover(const buffer_region_list& outer,
+                          const buffer_region_list& inner)
+{
+  auto it_outer = outer.begin();
+  for(const buffer_region& r : inner)
+  {
+    while(it_outer != outer.end() && it_outer->end <= r.begin)
+      ++it_outer;
+    if(it_outer == outer.end() ||
+       it_outer->begin > r.begin || it_outer->end < r.end)
+      return false;
+  }
+  return true;
+}
+
 void buffer_access_log::add_operation(const task_graph_node_ptr& task,
-                                      access::mode access)
-{  
-  _operations.push_back({task, access});
+                                      access::mode access,
+                                      buffer_region_list regions)
+{
+  // A write depends on all previous operations on the regions it
+  // covers, so any later access to them is ordered after those
+  // operations through the write. They then no longer need to be
+  // tracked, which keeps the dependency lists of back-to-back
+  // accesses short.
+  const bool supersedes = access != access::mode::read;
 
   for(auto it = _operations.begin();
       it != _operations.end();)
   {
-    if(it->task->is_done())
+    if(it->task->is_done() ||
+       (supersedes && regions_cover(regions, it->regions)))
       it = _operations.erase(it);
     else
       ++it;
   }
+
+  _operations.push_back({task, access, std::move(regions)});
 }
 
 bool buffer_access_log::is_buffer_in_use() const
@@ -597,37 +1492,50 @@ bool buffer_access_log::is_buffer_in_use() const
   return _operations.size() > 0;
 }
 
-buffer_access_log::~buffer_access_log()
-{
-  for(auto& op : _operations)
-    op.task->wait();
-}
-
 
-vector_class<task_graph_node_ptr>
-buffer_access_log::calculate_dependencies(access::mode m) const
+task_graph_node_list
+buffer_access_log::calculate_dependencies(
+    access::mode m,
+    const buffer_region_list& regions) const
 {
-  vector_class<task_graph_node_ptr> deps;
+  // Not reserved for all operations, since reads skip other reads
+  // and the list usually fits into its inline storage
+  task_graph_node_list deps;
 
-  if(m != access::mode::read)
-  {
-    // Write operations need to wait until all previous
-    // reads and writes have finished to guarantee consistency
-    for(auto op : _operations)
-      deps.push_back(op.task);
-  }
-  else
+  for(const auto& op : _operations)
   {
     // Read-only operations do not need to depend on previous
-    // read operations
-    for(auto op: _operations)
-      if(op.access_mode != access::mode::read)
-        deps.push_back(op.task);
+    // read operations, write operations need to wait until all
+    // previous reads and writes have finished to guarantee consistency.
+    if(m == access::mode::read && op.access_mode == access::mode::read)
+      continue;
+    // Operations on disjoint parts of the buffer may run concurrently
+    if(regions_overlap(regions, op.regions))
+      deps.push_back(op.task);
   }
 
   return deps;
 }
 
+task_graph_node_list
+buffer_access_log::get_pending_operations() const
+{
+  task_graph_node_list pending;
+  for(const auto& op : _operations)
+    if(!op.task->is_done())
+      pending.push_back(op.task);
+  return pending;
+}
+
+bool
+buffer_access_log::has_pending_operations() const
+{
+  for(auto op : _operations)
+    if(!op.task->is_done())
+      return true;
+  return false;
+}
+
 bool
 buffer_access_log::is_write_operation_pending() const
 {
@@ -655,6 +1563,35 @@ buffer_cleanup_trigger::~buffer_cleanup_trigger()
 {
   HIPSYCL_DEBUG_INFO << "buffer_cleanup_trigger: Buffer went out of scope,"
                         " triggering cleanup" << std::endl;
+  if(_detached_stream)
+  {
+    _buff->finalize_host_async(_detached_stream);
+    if(_callbacks.empty() && _retained_data.empty())
+      return;
+
+    // The pending operations include the write-back, which the callbacks
+    // must run after. Retained data must stay alive until all operations
+    // on the buffer have completed.
+    task_graph_node_list requirements =
+        _buff->get_pending_operations();
+
+    auto callbacks = std::move(_callbacks);
+    auto retained_data = std::move(_retained_data);
+    buffer_ptr buff = _buff;
+    detail::application::get_task_graph().insert(
+        [callbacks, retained_data, buff]() -> task_state {
+          for(auto callback : callbacks)
+            callback();
+          return task_state::complete;
+        },
+        std::move(requirements),
+        _detached_stream,
+        _detached_stream->get_error_handler(),
+        task_execution_kind::host_synchronized,
+        "buffer_cleanup");
+    return;
+  }
+
   detail::stream_ptr stream = std::make_shared<detail::stream_manager>();
   _buff->finalize_host(stream);
 
@@ -675,6 +1612,34 @@ buffer_cleanup_trigger::remove_cleanup_callbacks()
   this->_callbacks.clear();
 }
 
+void
+buffer_cleanup_trigger::retain(shared_ptr_class<void> data)
+{
+  this->_retained_data.push_back(data);
+}
+
+void
+buffer_cleanup_trigger::enable_detached_cleanup(detail::stream_ptr stream)
+{
+  this->_detached_stream = stream;
+}
+
+}
+}
+}
+
+namespace cl {
+namespace sycl {
+namespace hipsycl {
+namespace property {
+namespace buffer {
+
+detach_on_destruction::detach_on_destruction(const queue& q)
+  : _stream{q.get_stream()}
+{}
+
+}
+}
 }
 }
 }
@@ -0,0 +1,265 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/command_graph.hpp"
+#include "CL/sycl/detail/command_graph.hpp"
+#include "CL/sycl/detail/application.hpp"
+#include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/exception.hpp"
+
+#include <algorithm>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+bool is_write_access(access::mode m)
+{
+  return m != access::mode::read;
+}
+
+bool is_discard_access(access::mode m)
+{
+  return m == access::mode::discard_write ||
+         m == access::mode::discard_read_write;
+}
+
+void add_dependency(vector_class<std::size_t>& dependencies,
+                    std::size_t command)
+{
+  if(std::find(dependencies.begin(), dependencies.end(), command)
+      == dependencies.end())
+    dependencies.push_back(command);
+}
+
+}
+
+constexpr std::size_t command_graph_recorder::no_command;
+
+command_graph_recorder::buffer_state&
+command_graph_recorder::get_buffer_state(const buffer_ptr& buff,
+                                         access::mode first_access)
+{
+  for(auto& state : _buffers)
+    if(state.buff == buff)
+      return state;
+
+  // Recorded kernels keep their device pointers, but the device
+  // memory of out-of-core buffers may move between replays.
+  if(buff->is_out_of_core())
+    throw feature_not_supported{"command_graph: Out-of-core buffers cannot "
+                                "be used in recorded command graphs"};
+
+  // If the first access discards the buffer content, the whole
+  // graph does so as well.
+  access::mode combined_mode = access::mode::read;
+  if(is_discard_access(first_access))
+    combined_mode = first_access;
+
+  _buffers.push_back(buffer_state{buff, combined_mode, no_command, {}});
+  return _buffers.back();
+}
+
+std::size_t
+command_graph_recorder::record(replayable_task task,
+                               const vector_class<buffer_usage>& accesses,
+                               std::size_t predecessor)
+{
+  const std::size_t index = _commands.size();
+
+  command cmd;
+  cmd.task = std::make_shared<replayable_task>(std::move(task));
+  cmd.accesses = accesses;
+
+  if(predecessor != no_command)
+    add_dependency(cmd.dependencies, predecessor);
+
+  // Apply the same rules as buffer_access_log: Writes depend on all
+  // previous accesses, reads only on previous writes.
+  for(const auto& access : accesses)
+  {
+    buffer_state& state = get_buffer_state(access.buff, access.access_mode);
+
+    if(state.last_write != no_command)
+      add_dependency(cmd.dependencies, state.last_write);
+
+    if(is_write_access(access.access_mode))
+    {
+      for(std::size_t read : state.reads_since_last_write)
+        add_dependency(cmd.dependencies, read);
+
+      state.reads_since_last_write.clear();
+      state.last_write = index;
+
+      if(!is_discard_access(state.combined_access_mode))
+        state.combined_access_mode = access::mode::read_write;
+    }
+    else
+      state.reads_since_last_write.push_back(index);
+  }
+  // A command may access the same buffer through several accessors
+  cmd.dependencies.erase(std::remove(cmd.dependencies.begin(),
+                                     cmd.dependencies.end(),
+                                     index),
+                         cmd.dependencies.end());
+
+  HIPSYCL_DEBUG_INFO << "command_graph: Recorded command " << index
+                     << " with " << cmd.dependencies.size()
+                     << " dependencies" << std::endl;
+
+  _commands.push_back(std::move(cmd));
+  return index;
+}
+
+task_graph_node_ptr
+command_graph_recorder::replay(stream_ptr stream,
+                               async_handler handler) const
+{
+  if(_commands.empty())
+    return nullptr;
+
+  task_graph& tg = application::get_task_graph();
+
+  // Make each buffer available on the device once. This also
+  // takes care of dependencies on work outside of the graph.
+  vector_class<task_graph_node_ptr> buffer_nodes;
+  buffer_nodes.reserve(_buffers.size());
+  for(const auto& state : _buffers)
+    buffer_nodes.push_back(buffer_impl::access_device(state.buff,
+                                                      state.combined_access_mode,
+                                                      state.buff->get_full_region(),
+                                                      stream,
+                                                      handler));
+
+  task_graph_node_list command_nodes;
+  command_nodes.reserve(_commands.size());
+
+  for(const auto& cmd : _commands)
+  {
+    task_graph_node_list requirements;
+    requirements.reserve(cmd.dependencies.size() + cmd.accesses.size());
+
+    for(std::size_t dependency : cmd.dependencies)
+      requirements.push_back(command_nodes[dependency]);
+
+    for(const auto& access : cmd.accesses)
+      for(std::size_t i = 0; i < _buffers.size(); ++i)
+        if(_buffers[i].buff == access.buff)
+          requirements.push_back(buffer_nodes[i]);
+
+    shared_ptr_class<replayable_task> task = cmd.task;
+    task_graph_node_ptr node = tg.insert([task]() { return (*task)(); },
+                                         std::move(requirements),
+                                         stream,
+                                         handler,
+                                         task_execution_kind::stream_ordered,
+                                         "command_graph_command");
+
+    // Make sure subsequent accesses outside of the graph
+    // wait for the replayed commands
+    for(const auto& access : cmd.accesses)
+      access.buff->register_external_access(node, access.access_mode);
+
+    command_nodes.push_back(node);
+  }
+
+  // Since commands are not necessarily submitted in order, the last
+  // command completing does not imply that all commands have completed.
+  // The final node is only done once all commands are.
+  return tg.insert([]() { return task_state::complete; },
+                   std::move(command_nodes),
+                   stream,
+                   handler,
+                   task_execution_kind::stream_ordered,
+                   "command_graph_replay");
+}
+
+std::size_t command_graph_recorder::get_num_commands() const
+{
+  return _commands.size();
+}
+
+} // detail
+
+namespace hipsycl {
+
+command_graph::command_graph(const queue& q)
+  : _stream{q.get_stream()},
+    _recorder{std::make_shared<detail::command_graph_recorder>()}
+{}
+
+command_graph::~command_graph()
+{
+  if(is_recording())
+    end_recording();
+}
+
+void command_graph::begin_recording()
+{
+  if(_stream->get_recorder() != nullptr)
+    throw invalid_object_error{"command_graph: The queue is already "
+                               "being recorded"};
+
+  _recorder = std::make_shared<detail::command_graph_recorder>();
+  _stream->set_recorder(_recorder.get());
+}
+
+void command_graph::end_recording()
+{
+  if(is_recording())
+    _stream->set_recorder(nullptr);
+}
+
+bool command_graph::is_recording() const
+{
+  return _stream->get_recorder() == _recorder.get();
+}
+
+std::size_t command_graph::get_num_commands() const
+{
+  return _recorder->get_num_commands();
+}
+
+event command_graph::replay()
+{
+  if(is_recording())
+    throw invalid_object_error{"command_graph: Cannot replay while "
+                               "recording"};
+
+  _stream->activate_device();
+
+  auto node = _recorder->replay(_stream, _stream->get_error_handler());
+  if(!node)
+    return event{};
+  return event{node};
+}
+
+} // hipsycl
+} // sycl
+} // cl
@@ -0,0 +1,208 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/cpu_topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+/// Parses sizes such as "32K" or "8M" from sysfs
+std::size_t parse_size(const std::string& value)
+{
+  std::size_t pos = 0;
+  std::size_t size = 0;
+  try
+  {
+    size = std::stoull(value, &pos);
+  }
+  catch(...)
+  {
+    return 0;
+  }
+
+  if(pos < value.size())
+  {
+    if(value[pos] == 'K')
+      size *= 1024;
+    else if(value[pos] == 'M')
+      size *= 1024 * 1024;
+    else if(value[pos] == 'G')
+      size *= 1024 * 1024 * 1024;
+  }
+  return size;
+}
+
+std::string read_first_line(const std::string& path)
+{
+  std::ifstream file{path};
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+/// \return The value of the first entry with the given key
+/// in /proc/cpuinfo, or an empty string
+std::string read_cpuinfo(const std::string& key)
+{
+  std::ifstream file{"/proc/cpuinfo"};
+  std::string line;
+  while(std::getline(file, line))
+  {
+    if(line.compare(0, key.size(), key) != 0)
+      continue;
+
+    std::size_t colon = line.find(':');
+    if(colon == std::string::npos)
+      continue;
+    std::size_t begin = line.find_first_not_of(" \t", colon + 1);
+    if(begin == std::string::npos)
+      return std::string{};
+    return line.substr(begin);
+  }
+  return std::string{};
+}
+
+std::size_t get_simd_width()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return 64;
+  if(__builtin_cpu_supports("avx"))
+    return 32;
+  if(__builtin_cpu_supports("sse2"))
+    return 16;
+  return sizeof(double);
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(__ALTIVEC__)
+  return 16;
+#else
+  return sizeof(double);
+#endif
+}
+
+}
+
+const cpu_topology& cpu_topology::get()
+{
+  static cpu_topology topology;
+  return topology;
+}
+
+cpu_topology::cpu_topology()
+  : num_cores{std::max(1u, std::thread::hardware_concurrency())},
+    max_clock_frequency{0},
+    l1_cache_size{0},
+    l2_cache_size{0},
+    l3_cache_size{0},
+    cache_line_size{0},
+    simd_width{get_simd_width()},
+    memory_size{0}
+{
+  name = read_cpuinfo("model name");
+  if(name.empty())
+    name = "CPU";
+
+  // Data and unified caches of the first core
+  for(int index = 0; ; ++index)
+  {
+    std::string dir = "/sys/devices/system/cpu/cpu0/cache/index"
+                    + std::to_string(index) + "/";
+    std::string level = read_first_line(dir + "level");
+    if(level.empty())
+      break;
+
+    if(read_first_line(dir + "type") == "Instruction")
+      continue;
+
+    std::size_t size = parse_size(read_first_line(dir + "size"));
+    if(level == "1")
+      l1_cache_size = size;
+    else if(level == "2")
+      l2_cache_size = size;
+    else if(level == "3")
+      l3_cache_size = size;
+
+    if(cache_line_size == 0)
+      cache_line_size =
+          parse_size(read_first_line(dir + "coherency_line_size"));
+  }
+
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+  // Fall back to glibc, which may know the caches
+  // if sysfs is not available
+  if(l1_cache_size == 0 && sysconf(_SC_LEVEL1_DCACHE_SIZE) > 0)
+    l1_cache_size = static_cast<std::size_t>(sysconf(_SC_LEVEL1_DCACHE_SIZE));
+  if(l2_cache_size == 0 && sysconf(_SC_LEVEL2_CACHE_SIZE) > 0)
+    l2_cache_size = static_cast<std::size_t>(sysconf(_SC_LEVEL2_CACHE_SIZE));
+  if(l3_cache_size == 0 && sysconf(_SC_LEVEL3_CACHE_SIZE) > 0)
+    l3_cache_size = static_cast<std::size_t>(sysconf(_SC_LEVEL3_CACHE_SIZE));
+  if(cache_line_size == 0 && sysconf(_SC_LEVEL1_DCACHE_LINESIZE) > 0)
+    cache_line_size =
+        static_cast<std::size_t>(sysconf(_SC_LEVEL1_DCACHE_LINESIZE));
+#endif
+
+  // cpuinfo_max_freq is given in kHz
+  std::size_t max_freq = parse_size(read_first_line(
+      "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq"));
+  if(max_freq > 0)
+    max_clock_frequency = max_freq / 1000;
+  else
+  {
+    std::string mhz = read_cpuinfo("cpu MHz");
+    if(!mhz.empty())
+      max_clock_frequency = parse_size(mhz);
+  }
+
+  long num_pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if(num_pages > 0 && page_size > 0)
+    memory_size = static_cast<std::size_t>(num_pages) *
+                  static_cast<std::size_t>(page_size);
+}
+
+std::size_t cpu_topology::get_last_level_cache_size() const
+{
+  if(l3_cache_size > 0)
+    return l3_cache_size;
+  if(l2_cache_size > 0)
+    return l2_cache_size;
+  return l1_cache_size;
+}
+
+}
+}
+}
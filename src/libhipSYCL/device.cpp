@@ -46,9 +46,17 @@ platform device::get_platform() const  {
 vector_class<device> device::get_devices(
     info::device_type deviceType)
 {
+#ifdef HIPSYCL_PLATFORM_CPU
+  // On the CPU platform, the only device is the CPU, which also
+  // serves as host device.
+  if(deviceType == info::device_type::gpu ||
+     deviceType == info::device_type::accelerator)
+    return vector_class<device>();
+#else
   if(deviceType == info::device_type::cpu ||
      deviceType == info::device_type::host)
     return vector_class<device>();
+#endif
 
   vector_class<device> result;
   int num_devices = get_num_devices();
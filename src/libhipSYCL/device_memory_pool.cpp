@@ -0,0 +1,355 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/device_memory_pool.hpp"
+#include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/exception.hpp"
+
+#include <cstdlib>
+#include <limits>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+std::size_t get_size_from_environment(const char* name, const char* description)
+{
+  const char* env = std::getenv(name);
+  if(env != nullptr)
+  {
+    char* end = nullptr;
+    unsigned long long limit = std::strtoull(env, &end, 10);
+    if(end != env && *end == '\0')
+      return static_cast<std::size_t>(limit);
+
+    HIPSYCL_DEBUG_WARNING << "device_memory_pool: Invalid value for "
+                          << name << ": " << env
+                          << ", not limiting " << description << std::endl;
+  }
+  return std::numeric_limits<std::size_t>::max();
+}
+
+}
+
+device_memory_pool& device_memory_pool::get()
+{
+  // Intentionally leaked: Buffers may be destroyed during static
+  // destruction, so the pool must outlive all other static objects.
+  static device_memory_pool* pool =
+      new device_memory_pool{
+        get_size_from_environment("HIPSYCL_DEVICE_POOL_LIMIT",
+                                  "cached memory"),
+        get_size_from_environment("HIPSYCL_DEVICE_MEMORY_LIMIT",
+                                  "device memory")};
+  return *pool;
+}
+
+device_memory_pool::device_memory_pool(std::size_t max_cached_bytes,
+                                       std::size_t device_memory_limit)
+  : _max_cached_bytes{max_cached_bytes},
+    _device_memory_limit{device_memory_limit}
+{}
+
+device_memory_pool::~device_memory_pool()
+{
+  this->trim();
+}
+
+void* device_memory_pool::allocate(std::size_t size)
+{
+  return this->allocate(size, false, 0, true);
+}
+
+void* device_memory_pool::allocate(std::size_t size, hipStream_t stream)
+{
+  return this->allocate(size, true, stream, true);
+}
+
+void* device_memory_pool::try_allocate(std::size_t size)
+{
+  return this->allocate(size, false, 0, false);
+}
+
+void device_memory_pool::release(void* ptr)
+{
+  this->release(ptr, false, 0);
+}
+
+void device_memory_pool::release(void* ptr, hipStream_t stream)
+{
+  this->release(ptr, true, stream);
+}
+
+void* device_memory_pool::allocate(std::size_t size,
+                                   bool stream_ordered,
+                                   hipStream_t stream,
+                                   bool throw_if_exhausted)
+{
+  if(size == 0)
+    return nullptr;
+
+  std::size_t size_class = get_size_class(size);
+  int device = get_active_device();
+
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  device_pool& pool = _devices[device];
+  ++pool.stats.num_allocations;
+
+  void* ptr = nullptr;
+
+  auto bin = pool.free_blocks.find(size_class);
+  if(bin != pool.free_blocks.end())
+  {
+    vector_class<cached_block>& blocks = bin->second;
+    // Prefer the most recently released blocks
+    for(auto block = blocks.rbegin(); block != blocks.rend(); ++block)
+    {
+      if(is_reusable(*block, stream_ordered, stream))
+      {
+        ptr = block->ptr;
+        if(block->release_event != nullptr)
+          hipEventDestroy(block->release_event);
+
+        blocks.erase(std::next(block).base());
+        pool.stats.bytes_cached -= size_class;
+        ++pool.stats.num_cache_hits;
+        break;
+      }
+    }
+  }
+
+  if(ptr == nullptr)
+  {
+    hipError_t err = allocate_block(pool, &ptr, size_class);
+    if(err == hipErrorMemoryAllocation)
+    {
+      HIPSYCL_DEBUG_INFO << "device_memory_pool: Out of memory on device "
+                         << device << ", freeing cached allocations"
+                         << std::endl;
+      trim_device(pool, 0);
+      err = allocate_block(pool, &ptr, size_class);
+    }
+    if(err == hipErrorMemoryAllocation && !throw_if_exhausted)
+      return nullptr;
+    detail::check_error(err);
+    // check_error() does not throw if no device is available
+    if(ptr == nullptr)
+      return nullptr;
+
+    std::size_t reserved = pool.stats.bytes_in_use +
+                           pool.stats.bytes_cached + size_class;
+    if(reserved > pool.stats.peak_bytes_reserved)
+      pool.stats.peak_bytes_reserved = reserved;
+  }
+
+  pool.stats.bytes_in_use += size_class;
+  if(pool.stats.bytes_in_use > pool.stats.peak_bytes_in_use)
+    pool.stats.peak_bytes_in_use = pool.stats.bytes_in_use;
+
+  _live_blocks[ptr] = live_block{device, size_class};
+
+  return ptr;
+}
+
+void device_memory_pool::release(void* ptr,
+                                 bool stream_ordered,
+                                 hipStream_t stream)
+{
+  if(ptr == nullptr)
+    return;
+
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  auto live = _live_blocks.find(ptr);
+  if(live == _live_blocks.end())
+  {
+    HIPSYCL_DEBUG_ERROR << "device_memory_pool: Attempted to release "
+                           "memory that was not allocated by the pool"
+                        << std::endl;
+    return;
+  }
+
+  std::size_t size_class = live->second.size_class;
+  device_pool& pool = _devices[live->second.device];
+  _live_blocks.erase(live);
+
+  pool.stats.bytes_in_use -= size_class;
+
+  cached_block block{ptr, nullptr, stream};
+
+  if(stream_ordered)
+  {
+    detail::check_error(hipEventCreate(&block.release_event));
+    detail::check_error(hipEventRecord(block.release_event, stream));
+  }
+
+  if(pool.stats.bytes_cached + size_class > _max_cached_bytes)
+  {
+    free_block(block);
+    return;
+  }
+
+  pool.free_blocks[size_class].push_back(block);
+  pool.stats.bytes_cached += size_class;
+}
+
+void device_memory_pool::trim(std::size_t bytes_to_keep)
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  for(auto& pool : _devices)
+    trim_device(pool.second, bytes_to_keep);
+}
+
+void device_memory_pool::trim(int device, std::size_t bytes_to_keep)
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  auto pool = _devices.find(device);
+  if(pool != _devices.end())
+    trim_device(pool->second, bytes_to_keep);
+}
+
+void device_memory_pool::set_max_cached_bytes(std::size_t bytes)
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  _max_cached_bytes = bytes;
+  for(auto& pool : _devices)
+    trim_device(pool.second, bytes);
+}
+
+std::size_t device_memory_pool::get_max_cached_bytes() const
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+  return _max_cached_bytes;
+}
+
+void device_memory_pool::set_device_memory_limit(std::size_t bytes)
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+  _device_memory_limit = bytes;
+}
+
+std::size_t device_memory_pool::get_device_memory_limit() const
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+  return _device_memory_limit;
+}
+
+device_memory_pool_statistics
+device_memory_pool::get_statistics(int device) const
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+
+  auto pool = _devices.find(device);
+  if(pool == _devices.end())
+    return device_memory_pool_statistics{};
+  return pool->second.stats;
+}
+
+std::size_t device_memory_pool::get_size_class(std::size_t size)
+{
+  if(size > large_size_threshold)
+    return ((size + large_size_granularity - 1) / large_size_granularity) *
+           large_size_granularity;
+
+  std::size_t size_class = min_size_class;
+  while(size_class < size)
+    size_class *= 2;
+  return size_class;
+}
+
+bool device_memory_pool::is_reusable(const cached_block& block,
+                                     bool stream_ordered,
+                                     hipStream_t stream) const
+{
+  if(block.release_event == nullptr)
+    return true;
+  // Operations on the same stream are executed after the release
+  if(stream_ordered && block.release_stream == stream)
+    return true;
+  return hipEventQuery(block.release_event) == hipSuccess;
+}
+
+void device_memory_pool::trim_device(device_pool& pool,
+                                     std::size_t bytes_to_keep)
+{
+  // Free the largest blocks first
+  for(auto bin = pool.free_blocks.rbegin();
+      bin != pool.free_blocks.rend() &&
+      pool.stats.bytes_cached > bytes_to_keep;
+      ++bin)
+  {
+    vector_class<cached_block>& blocks = bin->second;
+    while(!blocks.empty() && pool.stats.bytes_cached > bytes_to_keep)
+    {
+      free_block(blocks.back());
+      blocks.pop_back();
+      pool.stats.bytes_cached -= bin->first;
+    }
+  }
+}
+
+void device_memory_pool::free_block(cached_block& block)
+{
+  if(block.release_event != nullptr)
+  {
+    // The memory may still be in use by operations enqueued
+    // before the release
+    hipEventSynchronize(block.release_event);
+    hipEventDestroy(block.release_event);
+    block.release_event = nullptr;
+  }
+  hipFree(block.ptr);
+}
+
+hipError_t device_memory_pool::allocate_block(const device_pool& pool,
+                                              void** ptr,
+                                              std::size_t size_class) const
+{
+  std::size_t reserved = pool.stats.bytes_in_use + pool.stats.bytes_cached;
+  if(size_class > _device_memory_limit ||
+     reserved > _device_memory_limit - size_class)
+    return hipErrorMemoryAllocation;
+
+  return hipMalloc(ptr, size_class);
+}
+
+int device_memory_pool::get_active_device()
+{
+  int device = 0;
+  detail::check_error(hipGetDevice(&device));
+  return device;
+}
+
+}
+}
+}
@@ -35,7 +35,8 @@ namespace sycl {
 handler::handler(const queue& q, async_handler handler)
 : _queue{&q},
   _local_mem_allocator{q.get_device()},
-  _handler{handler}
+  _handler{handler},
+  _last_recorded_command{detail::command_graph_recorder::no_command}
 {}
 
 hipStream_t handler::get_hip_stream() const
@@ -48,6 +49,13 @@ detail::stream_ptr handler::get_stream() const
   return _queue->get_stream();
 }
 
+void handler::ensure_not_recording(const char* operation) const
+{
+  if(get_stream()->get_recorder() != nullptr)
+    throw feature_not_supported{string_class{operation} +
+                                " cannot be recorded into a command graph"};
+}
+
 void handler::select_device() const
 {
   detail::set_device(this->_queue->get_device());
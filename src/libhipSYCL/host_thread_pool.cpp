@@ -0,0 +1,231 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/host_thread_pool.hpp"
+#include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/exception.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+std::size_t get_num_threads_from_environment()
+{
+  std::size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  const char* env = std::getenv("HIPSYCL_CPU_THREADS");
+  if(env != nullptr)
+  {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(env, &end, 10);
+    if(end != env && *end == '\0' && value > 0)
+      return static_cast<std::size_t>(value);
+
+    HIPSYCL_DEBUG_WARNING << "host_thread_pool: Invalid value for "
+                             "HIPSYCL_CPU_THREADS: " << env
+                          << ", using " << num_threads << " threads"
+                          << std::endl;
+  }
+  return num_threads;
+}
+
+struct host_work
+{
+  function_class<void ()> f;
+  stream_ptr stream;
+};
+
+void execute_host_work(hipStream_t, hipError_t, void* user_data)
+{
+  std::unique_ptr<host_work> work{reinterpret_cast<host_work*>(user_data)};
+  // Exceptions must not escape the stream callback
+  try
+  {
+    work->f();
+  }
+  catch(...)
+  {
+    HIPSYCL_DEBUG_ERROR << "host_thread_pool: Host work threw an exception, "
+                           "invoking async handler." << std::endl;
+
+    exception_ptr e = std::current_exception();
+    work->stream->get_error_handler()(sycl::exception_list{e});
+  }
+}
+
+}
+
+host_thread_pool& host_thread_pool::get()
+{
+  // Intentionally leaked, since kernels may still be
+  // executed during static destruction.
+  static host_thread_pool* pool =
+      new host_thread_pool{get_num_threads_from_environment()};
+  return *pool;
+}
+
+host_thread_pool::host_thread_pool(std::size_t num_threads)
+  : _shutdown{false}
+{
+  // The thread calling run() participates in the execution
+  for(std::size_t i = 1; i < num_threads; ++i)
+    _workers.push_back(std::thread{[this](){ this->work(); }});
+}
+
+host_thread_pool::~host_thread_pool()
+{
+  {
+    std::lock_guard<mutex_class> lock{_mutex};
+    _shutdown = true;
+  }
+  _job_available.notify_all();
+
+  for(std::thread& worker : _workers)
+    worker.join();
+}
+
+void host_thread_pool::run(std::size_t num_tasks, const task_function& f)
+{
+  if(num_tasks == 0)
+    return;
+
+  // Not worth waking up the workers
+  if(num_tasks == 1 || _workers.empty())
+  {
+    for(std::size_t i = 0; i < num_tasks; ++i)
+      f(i);
+    return;
+  }
+
+  job j;
+  j.f = &f;
+  j.num_tasks = num_tasks;
+  j.next_task = 0;
+  j.num_workers = 0;
+  {
+    std::lock_guard<mutex_class> lock{_mutex};
+    _jobs.push_back(&j);
+  }
+  _job_available.notify_all();
+
+  execute_tasks(j);
+
+  // The job must stay valid until all workers are done with it
+  std::unique_lock<mutex_class> lock{_mutex};
+  remove_job(j);
+  _job_done.wait(lock, [&](){ return j.num_workers == 0; });
+
+  if(j.error)
+    std::rethrow_exception(j.error);
+}
+
+std::size_t host_thread_pool::get_num_threads() const
+{
+  return _workers.size() + 1;
+}
+
+void host_thread_pool::work()
+{
+  for(;;)
+  {
+    job* j = nullptr;
+    {
+      std::unique_lock<mutex_class> lock{_mutex};
+      _job_available.wait(lock, [this](){
+        return _shutdown || !_jobs.empty();
+      });
+      if(_shutdown)
+        return;
+      j = _jobs.front();
+      ++j->num_workers;
+    }
+
+    execute_tasks(*j);
+
+    {
+      std::lock_guard<mutex_class> lock{_mutex};
+      // All tasks have been taken, so other workers
+      // should move on to the next job.
+      remove_job(*j);
+      --j->num_workers;
+    }
+    // Several threads may wait for their jobs
+    _job_done.notify_all();
+  }
+}
+
+void host_thread_pool::execute_tasks(job& j)
+{
+  for(std::size_t task = j.next_task.fetch_add(1);
+      task < j.num_tasks;
+      task = j.next_task.fetch_add(1))
+  {
+    try
+    {
+      (*j.f)(task);
+    }
+    catch(...)
+    {
+      {
+        std::lock_guard<mutex_class> lock{_mutex};
+        if(!j.error)
+          j.error = std::current_exception();
+      }
+      // Skip the remaining tasks
+      j.next_task = j.num_tasks;
+    }
+  }
+}
+
+void host_thread_pool::remove_job(job& j)
+{
+  auto it = std::find(_jobs.begin(), _jobs.end(), &j);
+  if(it != _jobs.end())
+    _jobs.erase(it);
+}
+
+void enqueue_host_work(const stream_ptr& stream, function_class<void ()> f)
+{
+  auto* work = new host_work{std::move(f), stream};
+  hipError_t err = hipStreamAddCallback(stream->get_stream(), execute_host_work,
+                                        reinterpret_cast<void*>(work), 0);
+  if(err != hipSuccess)
+  {
+    delete work;
+    detail::check_error(err);
+  }
+}
+
+}
+}
+}
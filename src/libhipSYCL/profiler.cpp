@@ -0,0 +1,167 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/profiler.hpp"
+#include "CL/sycl/exception.hpp"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/// A device event together with the host time at which it
+/// has completed.
+class profiling_reference
+{
+public:
+  /// Records the reference event on the default stream of the
+  /// active device and waits for it.
+  profiling_reference()
+  {
+    detail::check_error(hipEventCreate(&_event));
+    detail::check_error(hipEventRecord(_event, 0));
+    detail::check_error(hipEventSynchronize(_event));
+    _host_time = task_profiler::get_host_time();
+  }
+
+  ~profiling_reference()
+  {
+    hipEventDestroy(_event);
+  }
+
+  hipEvent_t get_event() const
+  { return _event; }
+
+  cl_ulong get_host_time() const
+  { return _host_time; }
+private:
+  hipEvent_t _event;
+  cl_ulong _host_time;
+};
+
+namespace {
+
+// hipEventElapsedTime() returns milliseconds as float, so the
+// precision degrades the further apart two events are. Renew the
+// reference regularly to keep the offsets small.
+constexpr cl_ulong reference_renewal_interval = 1000000000ull;
+
+/// \return The reference for the active device
+shared_ptr_class<profiling_reference> get_profiling_reference()
+{
+  static mutex_class mutex;
+  static std::unordered_map<int, shared_ptr_class<profiling_reference>> references;
+
+  int dev = 0;
+  detail::check_error(hipGetDevice(&dev));
+
+  std::lock_guard<mutex_class> lock{mutex};
+
+  shared_ptr_class<profiling_reference>& ref = references[dev];
+  if(!ref ||
+     task_profiler::get_host_time() - ref->get_host_time() > reference_renewal_interval)
+    ref = std::make_shared<profiling_reference>();
+
+  return ref;
+}
+
+}
+
+task_profiler::task_profiler()
+  : _submit_time{get_host_time()},
+    _start{nullptr},
+    _end{nullptr}
+{}
+
+task_profiler::~task_profiler()
+{
+  if(_start)
+    hipEventDestroy(_start);
+  if(_end)
+    hipEventDestroy(_end);
+}
+
+void task_profiler::record_start(hipStream_t stream)
+{
+  _reference = get_profiling_reference();
+
+  detail::check_error(hipEventCreate(&_start));
+  detail::check_error(hipEventRecord(_start, stream));
+}
+
+void task_profiler::record_end(hipStream_t stream)
+{
+  detail::check_error(hipEventCreate(&_end));
+  detail::check_error(hipEventRecord(_end, stream));
+}
+
+cl_ulong task_profiler::get_submit_time() const
+{
+  return _submit_time;
+}
+
+cl_ulong task_profiler::get_start_time() const
+{
+  return get_event_time(_start);
+}
+
+cl_ulong task_profiler::get_end_time() const
+{
+  return get_event_time(_end);
+}
+
+bool task_profiler::has_device_timestamps() const
+{
+  return _start != nullptr && _end != nullptr;
+}
+
+cl_ulong task_profiler::get_host_time()
+{
+  return static_cast<cl_ulong>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+cl_ulong task_profiler::get_event_time(hipEvent_t evt) const
+{
+  detail::check_error(hipEventSynchronize(evt));
+
+  float ms = 0.0f;
+  detail::check_error(hipEventElapsedTime(&ms, _reference->get_event(), evt));
+
+  // The event may precede the reference if the reference
+  // has been renewed in the meantime
+  long long offset = static_cast<long long>(static_cast<double>(ms) * 1.e6);
+  return static_cast<cl_ulong>(
+    static_cast<long long>(_reference->get_host_time()) + offset);
+}
+
+}
+}
+}
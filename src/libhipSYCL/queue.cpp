@@ -42,7 +42,9 @@ stream_manager::stream_manager(const device& d)
 stream_manager::stream_manager(const device& d,
                                async_handler handler)
   : _dev{d},
-    _handler{handler}
+    _handler{handler},
+    _recorder{nullptr},
+    _profiling_enabled{false}
 {
   detail::set_device(d);
   detail::check_error(hipStreamCreateWithFlags(&_stream, hipStreamNonBlocking));
@@ -55,7 +57,9 @@ stream_manager::stream_manager()
 stream_manager::stream_manager(async_handler handler)
   : _stream{0},
     _dev{},
-    _handler{handler}
+    _handler{handler},
+    _recorder{nullptr},
+    _profiling_enabled{false}
 {}
 
 stream_manager::~stream_manager()
@@ -87,6 +91,26 @@ async_handler stream_manager::get_error_handler() const
   return this->_handler;
 }
 
+void stream_manager::set_recorder(command_graph_recorder* recorder)
+{
+  _recorder = recorder;
+}
+
+command_graph_recorder* stream_manager::get_recorder() const
+{
+  return _recorder;
+}
+
+void stream_manager::set_profiling_enabled(bool enabled)
+{
+  _profiling_enabled = enabled;
+}
+
+bool stream_manager::is_profiling_enabled() const
+{
+  return _profiling_enabled;
+}
+
 }
 
 
@@ -95,8 +119,7 @@ queue::queue(const property_list &propList)
     _device{device{}},
     _handler{[](exception_list){}}
 {
-  _stream = detail::stream_ptr(new detail::stream_manager{_device,
-                                                          _handler});
+  this->init_stream();
 }
 
 /// \todo constructors do not yet use asyncHandler
@@ -106,8 +129,7 @@ queue::queue(const async_handler &asyncHandler,
     _device{device{}},
     _handler{asyncHandler}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{_device,
-                                                          _handler}};
+  this->init_stream();
 }
 
 
@@ -117,8 +139,7 @@ queue::queue(const device_selector &deviceSelector,
     _device{deviceSelector.select_device()},
     _handler{[](exception_list){}}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{_device,
-                                                          _handler}};
+  this->init_stream();
 }
 
 
@@ -128,8 +149,7 @@ queue::queue(const device_selector &deviceSelector,
     _device{deviceSelector.select_device()},
     _handler{asyncHandler}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{_device,
-                                                          _handler}};
+  this->init_stream();
 }
 
 
@@ -138,8 +158,7 @@ queue::queue(const device &syclDevice, const property_list &propList)
     _device{syclDevice},
     _handler{[](exception_list){}}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{_device,
-                                                          _handler}};
+  this->init_stream();
 }
 
 
@@ -149,8 +168,7 @@ queue::queue(const device &syclDevice, const async_handler &asyncHandler,
     _device{syclDevice},
     _handler{asyncHandler}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{_device,
-                                                          _handler}};
+  this->init_stream();
 }
 
 
@@ -160,9 +178,7 @@ queue::queue(const context &syclContext, const device_selector &deviceSelector,
     _device{deviceSelector.select_device()},
     _handler{[](exception_list){}}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{
-      _device,
-      _handler}};
+  this->init_stream();
 }
 
 
@@ -172,12 +188,18 @@ queue::queue(const context &syclContext, const device_selector &deviceSelector,
     _device{deviceSelector.select_device()},
     _handler{asyncHandler}
 {
-  _stream = detail::stream_ptr{new detail::stream_manager{
-      _device,
-      _handler}};
+  this->init_stream();
 }
 
 
+void queue::init_stream()
+{
+  _stream = detail::stream_ptr{new detail::stream_manager{_device,
+                                                          _handler}};
+  _stream->set_profiling_enabled(
+        this->has_property<property::queue::enable_profiling>());
+}
+
 context queue::get_context() const {
   return context{this->_device.get_platform()};
 }
@@ -0,0 +1,235 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/staging_buffer_pool.hpp"
+#include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/exception.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+void* byte_offset(void* ptr, std::size_t bytes)
+{
+  return reinterpret_cast<char*>(ptr) + bytes;
+}
+
+const void* byte_offset(const void* ptr, std::size_t bytes)
+{
+  return reinterpret_cast<const char*>(ptr) + bytes;
+}
+
+}
+
+constexpr std::size_t staging_buffer_pool::block_size;
+
+staging_buffer_pool& staging_buffer_pool::get()
+{
+  // Intentionally leaked, since transfers may happen
+  // during static destruction.
+  static staging_buffer_pool* pool = new staging_buffer_pool;
+  return *pool;
+}
+
+staging_buffer_pool::staging_buffer_pool()
+  : _next_block{0}
+{}
+
+staging_buffer_pool::~staging_buffer_pool()
+{
+  for(auto& block : _blocks)
+  {
+    hipEventSynchronize(block->last_use);
+    hipEventDestroy(block->last_use);
+    hipHostFree(block->ptr);
+  }
+}
+
+void staging_buffer_pool::memcpy_h2d(void* device, const void* host,
+                                     std::size_t len, hipStream_t stream)
+{
+  for(std::size_t offset = 0; offset < len; offset += block_size)
+  {
+    std::size_t chunk_size = std::min(block_size, len - offset);
+
+    staging_block* block = this->acquire();
+    if(block == nullptr)
+    {
+      // Fall back to a direct copy of the remaining data
+      detail::check_error(hipMemcpyAsync(byte_offset(device, offset),
+                                         byte_offset(host, offset),
+                                         len - offset,
+                                         hipMemcpyHostToDevice, stream));
+      return;
+    }
+
+    // While we copy into this block, the DMA of the previous
+    // chunk can already run.
+    std::memcpy(block->ptr, byte_offset(host, offset), chunk_size);
+    detail::check_error(hipMemcpyAsync(byte_offset(device, offset),
+                                       block->ptr, chunk_size,
+                                       hipMemcpyHostToDevice, stream));
+    this->release(block, stream);
+  }
+}
+
+void staging_buffer_pool::memcpy_d2h(void* host, const void* device,
+                                     std::size_t len, hipStream_t stream)
+{
+  // The chunk whose DMA has been enqueued, but which has not
+  // yet been copied to its destination
+  staging_block* pending_block = nullptr;
+  std::size_t pending_offset = 0;
+  std::size_t pending_size = 0;
+
+  auto complete_pending = [&](){
+    if(pending_block != nullptr)
+    {
+      detail::check_error(hipEventSynchronize(pending_block->last_use));
+      std::memcpy(byte_offset(host, pending_offset),
+                  pending_block->ptr, pending_size);
+      this->release(pending_block);
+      pending_block = nullptr;
+    }
+  };
+
+  for(std::size_t offset = 0; offset < len; offset += block_size)
+  {
+    std::size_t chunk_size = std::min(block_size, len - offset);
+
+    staging_block* block = this->acquire();
+    if(block == nullptr)
+    {
+      complete_pending();
+      detail::check_error(hipMemcpyAsync(byte_offset(host, offset),
+                                         byte_offset(device, offset),
+                                         len - offset,
+                                         hipMemcpyDeviceToHost, stream));
+      detail::check_error(hipStreamSynchronize(stream));
+      return;
+    }
+
+    detail::check_error(hipMemcpyAsync(block->ptr,
+                                       byte_offset(device, offset),
+                                       chunk_size,
+                                       hipMemcpyDeviceToHost, stream));
+    detail::check_error(hipEventRecord(block->last_use, stream));
+
+    // While the DMA of this chunk runs, the previous
+    // chunk is copied to its destination.
+    complete_pending();
+
+    pending_block = block;
+    pending_offset = offset;
+    pending_size = chunk_size;
+  }
+  complete_pending();
+}
+
+std::size_t staging_buffer_pool::get_num_blocks() const
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+  return _blocks.size();
+}
+
+staging_buffer_pool::staging_block* staging_buffer_pool::acquire()
+{
+  staging_block* block = nullptr;
+  {
+    std::lock_guard<mutex_class> lock{_mutex};
+
+    if(_blocks.size() >= initial_num_blocks)
+    {
+      for(std::size_t i = 0; i < _blocks.size(); ++i)
+      {
+        std::size_t index = (_next_block + i) % _blocks.size();
+        if(!_blocks[index]->acquired)
+        {
+          block = _blocks[index].get();
+          _next_block = index + 1;
+          break;
+        }
+      }
+    }
+
+    if(block == nullptr)
+    {
+      std::unique_ptr<staging_block> new_block = allocate_block();
+      if(new_block == nullptr)
+        return nullptr;
+
+      block = new_block.get();
+      _blocks.push_back(std::move(new_block));
+    }
+    block->acquired = true;
+  }
+  // Wait until the previous DMA from or to the block has completed
+  detail::check_error(hipEventSynchronize(block->last_use));
+  return block;
+}
+
+void staging_buffer_pool::release(staging_block* block, hipStream_t stream)
+{
+  detail::check_error(hipEventRecord(block->last_use, stream));
+  this->release(block);
+}
+
+void staging_buffer_pool::release(staging_block* block)
+{
+  std::lock_guard<mutex_class> lock{_mutex};
+  block->acquired = false;
+}
+
+std::unique_ptr<staging_buffer_pool::staging_block>
+staging_buffer_pool::allocate_block() const
+{
+  void* ptr = nullptr;
+  if(hipHostMalloc(&ptr, block_size, hipHostMallocDefault) != hipSuccess)
+  {
+    HIPSYCL_DEBUG_WARNING << "staging_buffer_pool: Could not allocate "
+                             "pinned staging memory, transferring "
+                             "directly from pageable memory" << std::endl;
+    return nullptr;
+  }
+
+  std::unique_ptr<staging_block> block{new staging_block{ptr, nullptr, false}};
+  if(hipEventCreate(&block->last_use) != hipSuccess)
+  {
+    hipHostFree(ptr);
+    return nullptr;
+  }
+  return block;
+}
+
+}
+}
+}
@@ -27,14 +27,57 @@
 
 #include "CL/sycl/detail/task_graph.hpp"
 #include "CL/sycl/detail/debug.hpp"
+#include "CL/sycl/detail/pool_allocator.hpp"
 
 #include <mutex>
 #include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 namespace cl {
 namespace sycl {
 namespace detail {
 
+namespace {
+
+struct wait_parameters
+{
+  // Number of times the completion is polled before yielding
+  int spin_iterations;
+  // Number of times the waiting thread yields before it blocks
+  int yield_iterations;
+};
+
+wait_parameters get_wait_parameters(wait_policy policy)
+{
+  if(policy == wait_policy::latency)
+    return wait_parameters{100000, 10000};
+  return wait_parameters{1000, 10};
+}
+
+wait_policy get_default_wait_policy()
+{
+  const char* env = std::getenv("HIPSYCL_WAIT_POLICY");
+  if(env != nullptr)
+  {
+    if(std::strcmp(env, "latency") == 0)
+    {
+      return wait_policy::latency;
+    }
+    else if(std::strcmp(env, "cpu_efficiency") != 0)
+    {
+      HIPSYCL_DEBUG_WARNING << "task_graph: Invalid value for "
+                               "HIPSYCL_WAIT_POLICY: " << env
+                            << ", using cpu_efficiency" << std::endl;
+    }
+  }
+  return wait_policy::cpu_efficiency;
+}
+
+}
+
 void task_done_callback(hipStream_t stream,
                         hipError_t status,
                         void *userData)
@@ -61,12 +104,15 @@ void task_done_callback(hipStream_t stream,
   // As soon as the task is set to done, the task graph
   // may decide to delete it - after this point, the node
   // should hence not be accessed anymore.
-  node->set_done();
+  bool successors_ready = node->set_done();
 
   try
   {
     detail::check_error(status);
-    graph->invoke_async_submission(error_handler);
+    // Only nodes that depend on this node can have become
+    // ready, so there's nothing to do if none of them did.
+    if(successors_ready)
+      graph->invoke_async_submission(error_handler);
   }
   catch (...)
   {
@@ -80,19 +126,61 @@ void task_done_callback(hipStream_t stream,
 
 }
 
+namespace {
+
+std::atomic<std::size_t> num_live_nodes{0};
+
+}
+
 task_graph_node::task_graph_node(task_functor tf,
-                                 const vector_class<task_graph_node_ptr>& requirements,
+                                 task_graph_node_list requirements,
                                  stream_ptr stream,
                                  async_handler error_handler,
-                                 task_graph* tgraph)
+                                 task_graph* tgraph,
+                                 task_execution_kind kind,
+                                 const char* label)
   : _submitted{false},
     _task_done{false},
-    _tf{tf},
-    _requirements{requirements},
+    _tf{std::move(tf)},
+    _requirements{std::move(requirements)},
+    _num_unmet_requirements{1},
+    _successors_closed{false},
+    _execution_kind{kind},
     _stream{stream},
     _handler{error_handler},
     _parent_graph{tgraph}
-{}
+{
+  if(_stream->is_profiling_enabled())
+    _profiler.reset(new task_profiler{});
+
+  if(tracer::is_enabled())
+    _trace = tracer::get().create_node_info(label, _stream->get_stream());
+
+  ++num_live_nodes;
+}
+
+task_graph_node::~task_graph_node()
+{
+  --num_live_nodes;
+}
+
+const task_profiler*
+task_graph_node::get_profiler() const
+{
+  return _profiler.get();
+}
+
+const node_trace_info*
+task_graph_node::get_trace_info() const
+{
+  return _trace.get();
+}
+
+std::size_t
+task_graph_node::get_num_live_nodes()
+{
+  return num_live_nodes;
+}
 
 async_handler
 task_graph_node::get_error_handler() const
@@ -107,10 +195,7 @@ bool task_graph_node::is_submitted() const
 
 bool task_graph_node::is_ready() const
 {
-  for(const auto& requirement : _requirements)
-    if(!requirement->is_done())
-      return false;
-  return true;
+  return _num_unmet_requirements == 0;
 }
 
 bool task_graph_node::is_done() const
@@ -133,7 +218,25 @@ task_graph_node::submit()
                        << this << std::endl;
 
     _stream->activate_device();
+
+    if(_trace)
+    {
+      tracer::get().begin_submit(*_trace);
+      for(const auto& requirement : _requirements)
+        if(requirement->_trace)
+          tracer::get().record_dependency(*requirement->_trace, *_trace);
+    }
+
+    if(_profiler)
+      _profiler->record_start(_stream->get_stream());
+
     task_state state = _tf();
+
+    if(_profiler)
+      _profiler->record_end(_stream->get_stream());
+
+    if(_trace)
+      tracer::get().end_submit(*_trace);
     
     // Remove the task functor after execution to avoid
     // cyclic dependencies between buffer objects (that store
@@ -141,9 +244,36 @@ task_graph_node::submit()
     // the captured accessors
     this->_tf = task_functor{};
 
-    _submitted = true;
+    // Stream ordered nodes may have been submitted before their
+    // requirements on the same stream have completed. In this case,
+    // we can only consider the node as done once the stream has
+    // caught up, even if the node itself did not enqueue anything.
+    bool requirements_pending = false;
+    for(const auto& requirement : _requirements)
+      if(!requirement->is_done())
+        requirements_pending = true;
+
+    // All requirements have completed or are guaranteed to complete
+    // before this node at this point, so there's no need to keep them
+    // alive any longer. Otherwise, each node would keep the entire chain
+    // of its predecessors alive.
+    this->release_requirements();
+
+    task_graph_successor_list submission_successors;
+    {
+      std::lock_guard<mutex_class> lock{_successor_mutex};
+      _submitted = true;
+      submission_successors.swap(_submission_successors);
+    }
 
-    if(state == task_state::enqueued)
+    // Successors on the same stream can now be submitted right away.
+    // This must happen before the completion callback is triggered,
+    // since the node may be deleted once it is done.
+    for(task_graph_node* successor : submission_successors)
+      if(successor->requirement_done())
+        _parent_graph->add_ready_node(successor);
+
+    if(state == task_state::enqueued || requirements_pending)
     {
       detail::check_error(
           hipStreamAddCallback(_stream->get_stream(), task_done_callback,
@@ -162,23 +292,134 @@ task_graph_node::submit()
   {
     HIPSYCL_DEBUG_ERROR << "task_graph: submit() caught async error, "
                            " invoking async handler." << std::endl;
+    bool requirements_pending = false;
+    for(const auto& requirement : _requirements)
+      if(!requirement->is_done())
+        requirements_pending = true;
+
     // Submitted must be set to true to avoid
     // subsequent submissions
-    _submitted = true;
+    task_graph_successor_list submission_successors;
+    {
+      std::lock_guard<mutex_class> lock{_successor_mutex};
+      _submitted = true;
+      submission_successors.swap(_submission_successors);
+    }
     this->_tf = task_functor{};
-    // ToDo: Should we also consider the task as done here?
-    // Or at least trigger the callback?
+    this->release_requirements();
+
+    for(task_graph_node* successor : submission_successors)
+      if(successor->requirement_done())
+        _parent_graph->add_ready_node(successor);
 
     exception_ptr e = std::current_exception();
     _handler(sycl::exception_list{e});
+
+    // The node is still completed, otherwise its successors and anyone
+    // waiting for it would block forever. As on success, completion
+    // must wait for requirements on the same stream. If the exception
+    // came from registering the callback, the node completes right away.
+    if(!requirements_pending ||
+       hipStreamAddCallback(_stream->get_stream(), task_done_callback,
+                            reinterpret_cast<void*>(this), 0) != hipSuccess)
+      task_done_callback(_stream->get_stream(),
+                         hipSuccess,
+                         reinterpret_cast<void*>(this));
   }
 
 }
 
-void
+bool
 task_graph_node::set_done()
 {
+  // The node may be deleted as soon as _task_done is set,
+  // so we must not access any members afterwards.
+  task_graph* graph = _parent_graph;
+  task_graph_successor_list successors;
+
+  if(_trace)
+    tracer::get().record_done(*_trace);
+  {
+    std::lock_guard<mutex_class> lock{_successor_mutex};
+    _successors_closed = true;
+    successors.swap(_successors);
+  }
   this->_task_done = true;
+
+  graph->notify_node_completed();
+
+  bool successors_ready = false;
+  for(task_graph_node* successor : successors)
+  {
+    if(successor->requirement_done())
+    {
+      graph->add_ready_node(successor);
+      successors_ready = true;
+    }
+  }
+  return successors_ready;
+}
+
+bool
+task_graph_node::add_successor(task_graph_node* successor)
+{
+  std::lock_guard<mutex_class> lock{_successor_mutex};
+  if(_successors_closed)
+    return false;
+
+  _successors.push_back(successor);
+  return true;
+}
+
+bool
+task_graph_node::add_submission_successor(task_graph_node* successor)
+{
+  std::lock_guard<mutex_class> lock{_successor_mutex};
+  if(_submitted)
+    return false;
+
+  _submission_successors.push_back(successor);
+  return true;
+}
+
+bool
+task_graph_node::is_on_same_stream(const task_graph_node& other) const
+{
+  return this->get_stream()->get_stream() == other.get_stream()->get_stream();
+}
+
+bool
+task_graph_node::requirement_done()
+{
+  return --_num_unmet_requirements == 0;
+}
+
+bool
+task_graph_node::register_with_requirements()
+{
+  for(const auto& requirement : _requirements)
+  {
+    // If we only enqueue work on the same stream as the requirement,
+    // the stream already guarantees the correct execution order - there's
+    // no need to wait for the requirement to complete. Any host-side work
+    // of the requirement has been carried out once it is submitted.
+    bool stream_ordered =
+        _execution_kind == task_execution_kind::stream_ordered &&
+        this->is_on_same_stream(*requirement);
+
+    bool is_pending = stream_ordered ?
+          requirement->add_submission_successor(this) :
+          requirement->add_successor(this);
+
+    if(is_pending)
+      ++_num_unmet_requirements;
+  }
+
+  // Requirements may complete while we are still registering,
+  // which is why _num_unmet_requirements starts at 1. Dropping
+  // this extra count now guarantees that exactly one of the
+  // completing requirements or ourselves sees the node becoming ready.
+  return requirement_done();
 }
 
 
@@ -201,36 +442,32 @@ task_graph_node::get_stream() const
 }
 
 void
-task_graph_node::wait()
+task_graph_node::release_requirements()
 {
-  if(!_submitted)
-  {
-    for(auto& requirement : _requirements)
-      requirement->wait();
-  }
-  // wait until submission - this shouldn't take long, once
-  // all requirements are met
-  while(!_submitted);
-
-  assert(_submitted);
+  _requirements.clear();
+  _requirements.shrink_to_fit();
+}
 
+void
+task_graph_node::wait()
+{
+  // The node is submitted by the task graph as soon as all requirements
+  // have completed, so we only need to wait for the node itself.
   // The callback should be executed immediately after
   // the event's completion
-  while(!_task_done);
-
+  _parent_graph->wait_until_done(this);
 }
 
 bool
 task_graph_node::are_requirements_on_same_stream() const
 {
   for(const auto& requirement : _requirements)
-    if(requirement->get_stream()->get_stream() !=
-       this->get_stream()->get_stream())
+    if(!this->is_on_same_stream(*requirement))
       return false;
   return true;
 }
 
-const vector_class<task_graph_node_ptr>&
+const task_graph_node_list&
 task_graph_node::get_requirements() const
 {
   return _requirements;
@@ -238,6 +475,60 @@ task_graph_node::get_requirements() const
 
 ///////////////// task_graph /////////////////////////
 
+task_graph::task_graph()
+  : _wait_policy{get_default_wait_policy()}
+{
+  // Make sure the tracer is constructed before (and hence destroyed
+  // after) the task graph, so that the trace includes all tasks
+  if(tracer::is_enabled())
+    tracer::get();
+}
+
+void task_graph::set_wait_policy(wait_policy policy)
+{
+  _wait_policy = policy;
+}
+
+wait_policy task_graph::get_wait_policy() const
+{
+  return _wait_policy;
+}
+
+void task_graph::wait_until_done(const task_graph_node* node)
+{
+  const wait_parameters params = get_wait_parameters(_wait_policy);
+
+  for(int i = 0; i < params.spin_iterations; ++i)
+    if(node->is_done())
+      return;
+
+  for(int i = 0; i < params.yield_iterations; ++i)
+  {
+    if(node->is_done())
+      return;
+    std::this_thread::yield();
+  }
+
+  std::unique_lock<mutex_class> lock{_completion_mutex};
+  // Registering as waiter before checking the node state guarantees
+  // that either we see the node as done, or notify_node_completed()
+  // sees us waiting.
+  ++_num_blocked_waiters;
+  _node_completed.wait(lock, [node](){ return node->is_done(); });
+  --_num_blocked_waiters;
+}
+
+void task_graph::notify_node_completed()
+{
+  if(_num_blocked_waiters > 0)
+  {
+    // Taking the lock guarantees that waiters are either not yet
+    // checking the node state or already waiting on the condition variable
+    std::lock_guard<mutex_class> lock{_completion_mutex};
+    _node_completed.notify_all();
+  }
+}
+
 task_graph::~task_graph()
 {
   this->finish();
@@ -253,27 +544,47 @@ task_graph::~task_graph()
 
 task_graph_node_ptr
 task_graph::insert(task_functor tf,
-                   const vector_class<task_graph_node_ptr>& requirements,
+                   task_graph_node_list requirements,
                    detail::stream_ptr stream,
-                   async_handler handler)
+                   async_handler handler,
+                   task_execution_kind kind,
+                   const char* label)
 {
-  task_graph_node_ptr node = std::make_shared<task_graph_node>(tf,
-                                                               requirements,
-                                                               stream,
-                                                               handler,
-                                                               this);
+  // Nodes (together with their shared_ptr control block) are allocated
+  // from a pool, since they are created and destroyed at a high rate.
+  task_graph_node_ptr node =
+      std::allocate_shared<task_graph_node>(pool_allocator<task_graph_node>{},
+                                            std::move(tf),
+                                            std::move(requirements),
+                                            stream,
+                                            handler,
+                                            this,
+                                            kind,
+                                            label);
 
   HIPSYCL_DEBUG_INFO << "task_graph: Receiving task node "
                      << node.get() << std::endl;
   HIPSYCL_DEBUG_INFO << "task_graph:  Dependencies: " << std::endl;
-  for(const auto& req : requirements)
+  for(const auto& req : node->get_requirements())
     HIPSYCL_DEBUG_INFO << "task_graph:    " << req.get() << std::endl;
 
   std::lock_guard<mutex_class> lock{_mutex};
 
-  this->purge_finished_tasks();
+  // Purging is linear in the number of nodes, so only do it
+  // once the graph has grown sufficiently since the last purge.
+  if(_nodes.size() >= _purge_threshold)
+  {
+    this->purge_finished_tasks();
+    _purge_threshold = std::max(static_cast<std::size_t>(64), 2 * _nodes.size());
+  }
   _nodes.push_back(node);
 
+  if(const node_trace_info* trace = node->get_trace_info())
+    tracer::get().record_insert(*trace);
+
+  if(node->register_with_requirements())
+    this->add_ready_node(node.get());
+
   // Trigger the invoke_async_submission function to make sure
   // the task gets submitted if it is the first one
 
@@ -286,25 +597,50 @@ task_graph::insert(task_functor tf,
 void
 task_graph::purge_finished_tasks()
 {
-  for(auto it = _nodes.begin();
-      it != _nodes.end();)
-  {
-    if((*it)->is_done())
-      it = _nodes.erase(it);
-    else
-      ++it;
-  }
+  _nodes.erase(std::remove_if(_nodes.begin(), _nodes.end(),
+                              [](const task_graph_node_ptr& node){
+                                return node->is_done();
+                              }),
+               _nodes.end());
 }
 
 void
 task_graph::submit_eligible_tasks()
 {
-  for(const auto& node : _nodes)
-    if(!node->is_submitted() && node->is_ready())
+  vector_class<task_graph_node*>& ready_nodes = _submitting_nodes;
+  // Submitting a node may complete it immediately (e.g. if
+  // the buffer action is a no-op), which can in turn make
+  // successors ready - so keep going until no ready nodes are left.
+  for(;;)
+  {
     {
+      std::lock_guard<mutex_class> lock{_ready_mutex};
+      if(_ready_nodes.empty())
+        return;
+      ready_nodes.swap(_ready_nodes);
+    }
+
+    for(task_graph_node* node : ready_nodes)
+    {
+      assert(!node->is_submitted());
       node->submit();
       assert(node->is_submitted());
     }
+    ready_nodes.clear();
+  }
+}
+
+void
+task_graph::add_ready_node(task_graph_node* node)
+{
+  HIPSYCL_DEBUG_INFO << "task_graph: node "
+                     << node << " is ready for submission" << std::endl;
+
+  if(const node_trace_info* trace = node->get_trace_info())
+    tracer::get().record_ready(*trace);
+
+  std::lock_guard<mutex_class> lock{_ready_mutex};
+  _ready_nodes.push_back(node);
 }
 
 void
@@ -324,26 +660,53 @@ void task_graph::flush()
   this->submit_eligible_tasks();
 }
 
-void task_graph::finish()
+void task_graph::insert_deferred(task_functor tf,
+                                 task_graph_node_list requirements,
+                                 detail::stream_ptr stream,
+                                 async_handler handler,
+                                 task_execution_kind kind,
+                                 const char* label)
 {
+  // task_functor is move-only, but async functions must be copyable
+  auto functor = std::make_shared<task_functor>(std::move(tf));
+  _worker([=](){
+    this->insert(std::move(*functor), requirements,
+                 stream, handler, kind, label);
+  });
+}
 
-  // We work on a copy of the task graph; this allows us
-  // to wait without locking the task graph the entire time
-  vector_class<task_graph_node_ptr> nodes_snapshot;
+void task_graph::finish()
+{
+  // Tasks may be inserted while we wait, e.g. by insert_deferred().
+  // We therefore repeat until no unfinished tasks remain.
+  for(;;)
   {
-    std::lock_guard<mutex_class> lock{_mutex};
+    {
+      std::lock_guard<mutex_class> lock{_mutex};
 
-    // Update the task graph one last time
-    this->purge_finished_tasks();
-    this->submit_eligible_tasks();
+      // Update the task graph one last time
+      this->purge_finished_tasks();
+      this->submit_eligible_tasks();
+    }
+    // Wait until everything is submitted
+    _worker.wait();
 
-    nodes_snapshot = _nodes;
-  }
-  // Wait until everything is submitted
-  _worker.wait();
+    // We work on a copy of the task graph; this allows us
+    // to wait without locking the task graph the entire time
+    vector_class<task_graph_node_ptr> nodes_snapshot;
+    {
+      std::lock_guard<mutex_class> lock{_mutex};
+      for(const auto& node : _nodes)
+        if(!node->is_done())
+          nodes_snapshot.push_back(node);
+    }
 
-  for(auto& node : nodes_snapshot)
-    node->wait();
+    if(nodes_snapshot.empty())
+      return;
+
+    for(auto& node : nodes_snapshot)
+      node->wait();
+  }
 }
 
 void task_graph::finish(detail::stream_ptr stream)
@@ -371,8 +734,22 @@ void task_graph::invoke_async_submission(async_handler error_handler)
   // separate worker thread because CUDA (and HIP?) forbid
   // calling functions that operate on streams in stream callbacks.
 
-  _worker([this, error_handler]()
+  // If a graph update is already pending that hasn't started yet, it
+  // will also pick up whatever triggered this call - so there's no
+  // need to enqueue another one. This collapses bursts of completion
+  // callbacks into a single wakeup of the worker.
+  if(_async_submission_pending.exchange(true))
+    return;
+
+  // Only capturing this keeps the function small enough to be
+  // stored without allocating.
+  _async_submission_handler = std::move(error_handler);
+  _worker([this]()
   {
+    async_handler error_handler = std::move(_async_submission_handler);
+    // Clear the flag before processing, such that nodes that become
+    // ready while we are processing result in a new graph update.
+    _async_submission_pending = false;
     try
     {
       this->process_graph();
@@ -0,0 +1,407 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CL/sycl/detail/tracer.hpp"
+#include "CL/sycl/detail/debug.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+namespace {
+
+std::uint64_t get_time()
+{
+  return static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// Turns kernel labels (see get_kernel_label()) back into
+/// readable kernel names
+string_class get_readable_label(const char* label)
+{
+  if(label == nullptr)
+    return "task";
+
+#ifdef __GNUG__
+  // Kernel labels are mangled pointer types, other labels are
+  // plain strings that never start with 'P'
+  if(label[0] == 'P')
+  {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(label, nullptr, nullptr, &status);
+    if(status == 0 && demangled != nullptr)
+    {
+      string_class result = demangled;
+      std::free(demangled);
+      if(!result.empty() && result.back() == '*')
+        result.pop_back();
+      return result;
+    }
+  }
+#endif
+  return label;
+}
+
+string_class escape_json(const string_class& s)
+{
+  string_class result;
+  result.reserve(s.size());
+  for(char c : s)
+  {
+    if(c == '"' || c == '\\')
+      result.push_back('\\');
+    result.push_back(c);
+  }
+  return result;
+}
+
+/// Chrome trace timestamps are given in microseconds
+void write_timestamp(std::ostream& ostr, std::uint64_t ns)
+{
+  ostr << ns / 1000 << "." << (ns % 1000) / 100 << (ns % 100) / 10 << ns % 10;
+}
+
+// Process ids of the tracks that events are shown on
+constexpr int host_pid = 0;
+constexpr int stream_pid = 1;
+
+}
+
+struct tracer::event
+{
+  enum class kind
+  {
+    insert,
+    ready,
+    submit,
+    running,
+    done,
+    dependency,
+    transfer
+  };
+
+  kind type;
+  std::uint64_t time;
+  std::uint64_t duration;
+  int thread;
+  // Copied from the node, since the node may not exist
+  // anymore when the trace is written.
+  std::uint64_t node_id;
+  const char* label;
+  hipStream_t stream;
+  // For dependencies, the requirement node and its submission
+  std::uint64_t other_node_id;
+  std::uint64_t other_time;
+  int other_thread;
+  std::uint64_t flow_id;
+  // For transfers
+  std::size_t num_bytes;
+};
+
+struct tracer::thread_buffer
+{
+  int thread_id;
+  // Only contended while the trace is being written
+  mutex_class mutex;
+  vector_class<event> events;
+};
+
+const char* tracer::get_trace_file()
+{
+  return std::getenv("HIPSYCL_TRACE_FILE");
+}
+
+tracer& tracer::get()
+{
+  static tracer t;
+  return t;
+}
+
+tracer::tracer()
+  : _start_time{get_time()},
+    _next_node_id{0},
+    _next_flow_id{0},
+    _next_thread_id{0}
+{}
+
+tracer::~tracer()
+{
+  this->write();
+}
+
+std::unique_ptr<node_trace_info>
+tracer::create_node_info(const char* label, hipStream_t stream)
+{
+  std::unique_ptr<node_trace_info> info{new node_trace_info{}};
+  info->id = _next_node_id++;
+  info->label = label;
+  info->stream = stream;
+  info->submit_time = 0;
+  info->submit_thread = 0;
+  return info;
+}
+
+tracer::thread_buffer& tracer::get_thread_buffer()
+{
+  // Buffers are shared with the tracer, so that events of
+  // threads that have already exited can still be written.
+  thread_local shared_ptr_class<thread_buffer> buffer;
+  if(!buffer)
+  {
+    buffer = std::make_shared<thread_buffer>();
+    buffer->thread_id = _next_thread_id++;
+
+    std::lock_guard<mutex_class> lock{_mutex};
+    _thread_buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void tracer::add_event(const event& evt)
+{
+  thread_buffer& buffer = get_thread_buffer();
+  std::lock_guard<mutex_class> lock{buffer.mutex};
+  buffer.events.push_back(evt);
+  buffer.events.back().thread = buffer.thread_id;
+}
+
+void tracer::record_insert(const node_trace_info& node)
+{
+  event evt{};
+  evt.type = event::kind::insert;
+  evt.time = get_time();
+  evt.node_id = node.id;
+  evt.label = node.label;
+  evt.stream = node.stream;
+  add_event(evt);
+}
+
+void tracer::record_ready(const node_trace_info& node)
+{
+  event evt{};
+  evt.type = event::kind::ready;
+  evt.time = get_time();
+  evt.node_id = node.id;
+  evt.label = node.label;
+  add_event(evt);
+}
+
+void tracer::begin_submit(node_trace_info& node)
+{
+  node.submit_time = get_time();
+  node.submit_thread = get_thread_buffer().thread_id;
+}
+
+void tracer::end_submit(const node_trace_info& node)
+{
+  event evt{};
+  evt.type = event::kind::submit;
+  evt.time = node.submit_time;
+  evt.duration = get_time() - node.submit_time;
+  evt.node_id = node.id;
+  evt.label = node.label;
+  evt.stream = node.stream;
+  add_event(evt);
+
+  evt.type = event::kind::running;
+  evt.duration = 0;
+  add_event(evt);
+}
+
+void tracer::record_dependency(const node_trace_info& requirement,
+                               const node_trace_info& node)
+{
+  event evt{};
+  evt.type = event::kind::dependency;
+  evt.time = node.submit_time;
+  evt.node_id = node.id;
+  evt.other_node_id = requirement.id;
+  evt.other_time = requirement.submit_time;
+  evt.other_thread = requirement.submit_thread;
+  evt.flow_id = _next_flow_id++;
+  add_event(evt);
+}
+
+void tracer::record_done(const node_trace_info& node)
+{
+  event evt{};
+  evt.type = event::kind::done;
+  evt.time = get_time();
+  evt.node_id = node.id;
+  evt.label = node.label;
+  evt.stream = node.stream;
+  add_event(evt);
+}
+
+void tracer::record_transfer(const char* name, std::size_t num_bytes,
+                             hipStream_t stream)
+{
+  event evt{};
+  evt.type = event::kind::transfer;
+  evt.time = get_time();
+  evt.label = name;
+  evt.stream = stream;
+  evt.num_bytes = num_bytes;
+  add_event(evt);
+}
+
+void tracer::write() const
+{
+  const char* filename = get_trace_file();
+  if(filename == nullptr)
+    return;
+
+  std::ofstream ostr{filename, std::ios::out | std::ios::trunc};
+  if(!ostr.is_open())
+  {
+    HIPSYCL_DEBUG_ERROR << "tracer: Could not open trace file "
+                        << filename << std::endl;
+    return;
+  }
+
+  std::unordered_map<hipStream_t, int> stream_tracks;
+  auto get_stream_track = [&](hipStream_t stream) -> int {
+    auto it = stream_tracks.find(stream);
+    if(it != stream_tracks.end())
+      return it->second;
+    int track = static_cast<int>(stream_tracks.size());
+    stream_tracks[stream] = track;
+    return track;
+  };
+
+  // Labels are shared by many events, so only demangle them once
+  std::unordered_map<const char*, string_class> labels;
+  auto get_label = [&](const char* label) -> const string_class& {
+    auto it = labels.find(label);
+    if(it == labels.end())
+      it = labels.emplace(label, escape_json(get_readable_label(label))).first;
+    return it->second;
+  };
+
+  bool first_event = true;
+  auto begin_event = [&](const char* phase, const string_class& name,
+                         std::uint64_t time, int pid, int tid) {
+    ostr << (first_event ? "\n" : ",\n");
+    first_event = false;
+    ostr << "{\"ph\":\"" << phase << "\",\"name\":\"" << name
+         << "\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"ts\":";
+    write_timestamp(ostr, time - std::min(time, _start_time));
+  };
+
+  ostr << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  std::lock_guard<mutex_class> lock{_mutex};
+  for(const auto& buffer : _thread_buffers)
+  {
+    std::lock_guard<mutex_class> buffer_lock{buffer->mutex};
+    for(const event& evt : buffer->events)
+    {
+      switch(evt.type)
+      {
+      case event::kind::insert:
+        begin_event("i", "insert", evt.time, host_pid, evt.thread);
+        ostr << ",\"s\":\"t\",\"args\":{\"node\":" << evt.node_id
+             << ",\"task\":\"" << get_label(evt.label)
+             << "\",\"stream\":" << get_stream_track(evt.stream) << "}}";
+        break;
+      case event::kind::ready:
+        begin_event("i", "ready", evt.time, host_pid, evt.thread);
+        ostr << ",\"s\":\"t\",\"args\":{\"node\":" << evt.node_id << "}}";
+        break;
+      case event::kind::submit:
+        begin_event("X", "submit " + get_label(evt.label), evt.time,
+                    host_pid, evt.thread);
+        ostr << ",\"dur\":";
+        write_timestamp(ostr, evt.duration);
+        ostr << ",\"args\":{\"node\":" << evt.node_id << "}}";
+        break;
+      case event::kind::running:
+        begin_event("b", get_label(evt.label), evt.time,
+                    stream_pid, get_stream_track(evt.stream));
+        ostr << ",\"cat\":\"task\",\"id\":" << evt.node_id
+             << ",\"args\":{\"node\":" << evt.node_id << "}}";
+        break;
+      case event::kind::done:
+        begin_event("e", get_label(evt.label), evt.time,
+                    stream_pid, get_stream_track(evt.stream));
+        ostr << ",\"cat\":\"task\",\"id\":" << evt.node_id << "}";
+        begin_event("i", "done", evt.time, host_pid, evt.thread);
+        ostr << ",\"s\":\"t\",\"args\":{\"node\":" << evt.node_id << "}}";
+        break;
+      case event::kind::dependency:
+        // Flow from the submission of the requirement to the
+        // submission of the dependent node
+        begin_event("s", "dependency", evt.other_time,
+                    host_pid, evt.other_thread);
+        ostr << ",\"cat\":\"dependency\",\"id\":" << evt.flow_id
+             << ",\"args\":{\"from\":" << evt.other_node_id
+             << ",\"to\":" << evt.node_id << "}}";
+        begin_event("f", "dependency", evt.time, host_pid, evt.thread);
+        ostr << ",\"cat\":\"dependency\",\"bp\":\"e\",\"id\":" << evt.flow_id
+             << "}";
+        break;
+      case event::kind::transfer:
+        begin_event("i", evt.label, evt.time, host_pid, evt.thread);
+        ostr << ",\"s\":\"t\",\"args\":{\"bytes\":" << evt.num_bytes
+             << ",\"stream\":" << get_stream_track(evt.stream) << "}}";
+        break;
+      }
+    }
+  }
+
+  for(const auto& track : stream_tracks)
+  {
+    begin_event("M", "thread_name", _start_time, stream_pid, track.second);
+    ostr << ",\"args\":{\"name\":\"stream " << track.second
+         << (track.first == 0 ? " (default)" : "") << "\"}}";
+  }
+  begin_event("M", "process_name", _start_time, host_pid, 0);
+  ostr << ",\"args\":{\"name\":\"host threads\"}}";
+  begin_event("M", "process_name", _start_time, stream_pid, 0);
+  ostr << ",\"args\":{\"name\":\"streams\"}}";
+
+  ostr << "\n]}\n";
+
+  HIPSYCL_DEBUG_INFO << "tracer: Wrote trace to " << filename << std::endl;
+}
+
+}
+}
+}
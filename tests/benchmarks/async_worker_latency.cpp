@@ -0,0 +1,113 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the latency between enqueuing an operation on the
+// asynchronous worker thread and its execution, while many producer
+// threads are enqueuing operations concurrently.
+
+#include <CL/sycl.hpp>
+#include <CL/sycl/detail/async_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+  std::size_t num_producers = 16;
+  std::size_t ops_per_producer = 10000;
+
+  if(argc > 1)
+    num_producers = std::max(1, std::atoi(argv[1]));
+  if(argc > 2)
+    ops_per_producer = std::max(1, std::atoi(argv[2]));
+
+  // One latency sample (in ns) per operation. Every slot is
+  // written by exactly one operation, so no synchronization is needed
+  // apart from worker_thread::wait().
+  std::vector<long long> latencies(num_producers * ops_per_producer);
+  std::atomic<std::size_t> num_executed{0};
+
+  cl::sycl::detail::worker_thread worker;
+
+  auto start = clock_type::now();
+
+  std::vector<std::thread> producers;
+  for(std::size_t p = 0; p < num_producers; ++p)
+  {
+    producers.emplace_back([&, p](){
+      for(std::size_t i = 0; i < ops_per_producer; ++i)
+      {
+        std::size_t slot = p * ops_per_producer + i;
+        auto enqueue_time = clock_type::now();
+
+        worker([&latencies, &num_executed, slot, enqueue_time](){
+          auto delta = clock_type::now() - enqueue_time;
+          latencies[slot] =
+              std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count();
+          ++num_executed;
+        });
+      }
+    });
+  }
+
+  for(auto& t : producers)
+    t.join();
+  worker.wait();
+
+  auto total = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count();
+
+  if(num_executed != latencies.size())
+  {
+    std::cout << "Error: Only " << num_executed << " of "
+              << latencies.size() << " operations were executed." << std::endl;
+    return -1;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p){
+    std::size_t idx = static_cast<std::size_t>(p * (latencies.size() - 1));
+    return latencies[idx] / 1000.0;
+  };
+
+  std::cout << "Producer threads:        " << num_producers << std::endl;
+  std::cout << "Operations per producer: " << ops_per_producer << std::endl;
+  std::cout << "Throughput:              "
+            << latencies.size() / (total * 1.e-6) << " ops/s" << std::endl;
+  std::cout << "Latency p50:             " << percentile(0.5) << " us" << std::endl;
+  std::cout << "Latency p99:             " << percentile(0.99) << " us" << std::endl;
+  std::cout << "Latency max:             " << percentile(1.0) << " us" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Compares eager submission of a sequence of command groups with
+// replaying the same sequence from a recorded command graph, both in
+// terms of host-side submission time and results.
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using clock_type = std::chrono::steady_clock;
+using namespace cl::sycl::access;
+
+constexpr std::size_t num_elements = 1024;
+
+void submit_step(cl::sycl::queue& q,
+                 cl::sycl::buffer<float, 1>& a,
+                 cl::sycl::buffer<float, 1>& b,
+                 cl::sycl::buffer<float, 1>& c)
+{
+  q.submit([&](cl::sycl::handler& cgh){
+    auto acc_a = a.get_access<mode::read>(cgh);
+    auto acc_b = b.get_access<mode::read>(cgh);
+    auto acc_c = c.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class command_graph_bench_kernel>(
+      cl::sycl::range<1>{num_elements},
+      [=](cl::sycl::id<1> idx){
+        acc_c[idx] = 0.5f * acc_c[idx] + acc_a[idx] * acc_b[idx];
+      });
+  });
+}
+
+void submit_sequence(cl::sycl::queue& q,
+                     std::size_t num_command_groups,
+                     cl::sycl::buffer<float, 1>& x,
+                     cl::sycl::buffer<float, 1>& y,
+                     cl::sycl::buffer<float, 1>& z)
+{
+  // Rotate buffer roles to obtain a nontrivial dependency structure
+  for(std::size_t i = 0; i < num_command_groups; ++i)
+  {
+    if(i % 3 == 0)
+      submit_step(q, x, y, z);
+    else if(i % 3 == 1)
+      submit_step(q, y, z, x);
+    else
+      submit_step(q, z, x, y);
+  }
+}
+
+void initialize(cl::sycl::buffer<float, 1>& buff, float value)
+{
+  auto acc = buff.get_access<mode::discard_write>();
+  for(std::size_t i = 0; i < num_elements; ++i)
+    acc[i] = value + 1.e-3f * i;
+}
+
+double seconds_since(clock_type::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t num_command_groups = 30;
+  std::size_t num_iterations = 200;
+
+  if(argc > 1)
+    num_command_groups = std::max(1, std::atoi(argv[1]));
+  if(argc > 2)
+    num_iterations = std::max(1, std::atoi(argv[2]));
+
+  cl::sycl::queue q;
+
+  cl::sycl::buffer<float, 1> eager_x{num_elements}, eager_y{num_elements},
+                             eager_z{num_elements};
+  cl::sycl::buffer<float, 1> graph_x{num_elements}, graph_y{num_elements},
+                             graph_z{num_elements};
+  for(auto* b : {&eager_x, &graph_x}) initialize(*b, 1.f);
+  for(auto* b : {&eager_y, &graph_y}) initialize(*b, 0.5f);
+  for(auto* b : {&eager_z, &graph_z}) initialize(*b, 0.f);
+
+  // Eager submission
+  auto start = clock_type::now();
+  for(std::size_t i = 0; i < num_iterations; ++i)
+    submit_sequence(q, num_command_groups, eager_x, eager_y, eager_z);
+  double eager_submit_time = seconds_since(start);
+  q.wait();
+  double eager_total_time = seconds_since(start);
+
+  // Record once, then replay
+  cl::sycl::hipsycl::command_graph graph{q};
+  start = clock_type::now();
+  graph.begin_recording();
+  submit_sequence(q, num_command_groups, graph_x, graph_y, graph_z);
+  graph.end_recording();
+  for(std::size_t i = 1; i < num_iterations; ++i)
+    graph.replay();
+  double graph_submit_time = seconds_since(start);
+  q.wait();
+  double graph_total_time = seconds_since(start);
+
+  bool results_match = true;
+  {
+    auto e = eager_x.get_access<mode::read>();
+    auto g = graph_x.get_access<mode::read>();
+    for(std::size_t i = 0; i < num_elements; ++i)
+      if(e[i] != g[i])
+        results_match = false;
+  }
+
+  std::size_t total_command_groups = num_command_groups * num_iterations;
+  std::cout << "Command groups per iteration: " << num_command_groups << std::endl;
+  std::cout << "Iterations:                   " << num_iterations << std::endl;
+  std::cout << "Eager:  submission " << eager_submit_time * 1.e6 / total_command_groups
+            << " us/command group, total " << eager_total_time << " s" << std::endl;
+  std::cout << "Replay: submission " << graph_submit_time * 1.e6 / total_command_groups
+            << " us/command group, total " << graph_total_time << " s" << std::endl;
+  std::cout << "Results match: " << (results_match ? "yes" : "no") << std::endl;
+
+  return results_match ? 0 : -1;
+}
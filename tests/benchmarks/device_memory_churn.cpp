@@ -0,0 +1,156 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the cost of short-lived temporary buffers, which are
+// created and destroyed in every iteration of a loop. The loop is run
+// once with the runtime's device memory pool caching released
+// allocations, and once with caching disabled, such that every
+// buffer allocates and frees its device memory through the backend.
+
+#include <CL/sycl.hpp>
+#include <CL/sycl/detail/device_memory_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using clock_type = std::chrono::steady_clock;
+using namespace cl::sycl::access;
+
+constexpr std::size_t num_elements = 1024;
+
+// Temporary buffer sizes cycle through a few different size classes
+constexpr std::size_t temporary_sizes[] = {1024, 3000, 64 * 1024, 1000 * 1000};
+
+double run_churn(cl::sycl::queue& q,
+                 cl::sycl::buffer<float, 1>& result,
+                 std::size_t num_iterations)
+{
+  auto start = clock_type::now();
+  for(std::size_t i = 0; i < num_iterations; ++i)
+  {
+    std::size_t temporary_size =
+        temporary_sizes[i % (sizeof(temporary_sizes) / sizeof(std::size_t))];
+
+    cl::sycl::buffer<float, 1> temporary{cl::sycl::range<1>{temporary_size}};
+
+    q.submit([&](cl::sycl::handler& cgh){
+      auto acc = temporary.get_access<mode::discard_write>(cgh);
+      cgh.parallel_for<class churn_fill>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> idx){
+          acc[idx] = static_cast<float>(idx[0]);
+        });
+    });
+    q.submit([&](cl::sycl::handler& cgh){
+      auto tmp = temporary.get_access<mode::read>(cgh);
+      auto res = result.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class churn_accumulate>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> idx){
+          res[idx] += tmp[idx];
+        });
+    });
+  }
+  q.wait();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+}
+
+void print_statistics(const cl::sycl::detail::device_memory_pool_statistics& s)
+{
+  std::cout << "  allocations: " << s.num_allocations
+            << ", cache hits: " << s.num_cache_hits
+            << ", peak bytes in use: " << s.peak_bytes_in_use
+            << ", peak bytes reserved: " << s.peak_bytes_reserved
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t num_iterations = 2000;
+  if(argc > 1)
+    num_iterations = std::max(1, std::atoi(argv[1]));
+
+  cl::sycl::queue q;
+  cl::sycl::detail::device_memory_pool& pool =
+      cl::sycl::detail::device_memory_pool::get();
+
+  int device = 0;
+  hipGetDevice(&device);
+
+  cl::sycl::buffer<float, 1> result{cl::sycl::range<1>{num_elements}};
+  {
+    auto acc = result.get_access<mode::discard_write>();
+    for(std::size_t i = 0; i < num_elements; ++i)
+      acc[i] = 0.f;
+  }
+
+  std::size_t max_cached_bytes = pool.get_max_cached_bytes();
+
+  pool.set_max_cached_bytes(0);
+  auto uncached_before = pool.get_statistics(device);
+  double uncached_time = run_churn(q, result, num_iterations);
+  auto uncached_after = pool.get_statistics(device);
+
+  pool.set_max_cached_bytes(max_cached_bytes);
+  double cached_time = run_churn(q, result, num_iterations);
+  auto cached_after = pool.get_statistics(device);
+
+  cl::sycl::detail::device_memory_pool_statistics uncached, cached;
+  uncached.num_allocations =
+      uncached_after.num_allocations - uncached_before.num_allocations;
+  uncached.num_cache_hits =
+      uncached_after.num_cache_hits - uncached_before.num_cache_hits;
+  uncached.peak_bytes_in_use = uncached_after.peak_bytes_in_use;
+  uncached.peak_bytes_reserved = uncached_after.peak_bytes_reserved;
+  cached.num_allocations =
+      cached_after.num_allocations - uncached_after.num_allocations;
+  cached.num_cache_hits =
+      cached_after.num_cache_hits - uncached_after.num_cache_hits;
+  cached.peak_bytes_in_use = cached_after.peak_bytes_in_use;
+  cached.peak_bytes_reserved = cached_after.peak_bytes_reserved;
+
+  bool correct = true;
+  {
+    auto acc = result.get_access<mode::read>();
+    for(std::size_t i = 0; i < num_elements; ++i)
+      if(acc[i] != 2.f * num_iterations * i)
+        correct = false;
+  }
+
+  std::cout << "Iterations: " << num_iterations << std::endl;
+  std::cout << "Without caching: " << uncached_time * 1.e6 / num_iterations
+            << " us/iteration" << std::endl;
+  print_statistics(uncached);
+  std::cout << "With caching:    " << cached_time * 1.e6 / num_iterations
+            << " us/iteration" << std::endl;
+  print_statistics(cached);
+  std::cout << "Results correct: " << (correct ? "yes" : "no") << std::endl;
+
+  return correct ? 0 : -1;
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the host<->device bandwidth of buffers that wrap pageable
+// user memory, with and without staging transfers through pinned
+// memory (the use_pinned_staging buffer property).
+// Host->device transfers are triggered by a kernel accessing the
+// buffer after the host has modified it, device->host transfers by
+// a host accessor after the kernel has modified it.
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using namespace cl::sycl::access;
+
+struct bandwidth
+{
+  double h2d;
+  double d2h;
+};
+
+double seconds_since(clock_type::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+}
+
+bandwidth measure(cl::sycl::queue& q,
+                  std::vector<float>& host_data,
+                  std::size_t num_iterations,
+                  const cl::sycl::property_list& props)
+{
+  std::size_t num_elements = host_data.size();
+  double h2d_time = 0.0;
+  double d2h_time = 0.0;
+
+  cl::sycl::buffer<float, 1> buf{host_data.data(),
+                                 cl::sycl::range<1>{num_elements},
+                                 props};
+  for(std::size_t i = 0; i < num_iterations; ++i)
+  {
+    // The kernel only touches a single element, but requires the
+    // entire buffer on the device.
+    auto start = clock_type::now();
+    q.submit([&](cl::sycl::handler& cgh){
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.single_task<class bandwidth_kernel>([=](){
+        acc[0] += 1.f;
+      });
+    });
+    q.wait();
+    h2d_time += seconds_since(start);
+
+    start = clock_type::now();
+    {
+      // Moves the buffer back to the host and marks
+      // it as modified on the host
+      auto acc = buf.get_access<mode::read_write>();
+      acc[1] += 1.f;
+    }
+    d2h_time += seconds_since(start);
+  }
+
+  double bytes = static_cast<double>(num_elements * sizeof(float)) *
+                 num_iterations;
+  return bandwidth{bytes / h2d_time * 1.e-9, bytes / d2h_time * 1.e-9};
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size_mb = 256;
+  std::size_t num_iterations = 10;
+  if(argc > 1)
+    size_mb = std::max(1, std::atoi(argv[1]));
+  if(argc > 2)
+    num_iterations = std::max(1, std::atoi(argv[2]));
+
+  std::size_t num_elements = size_mb * 1024 * 1024 / sizeof(float);
+  std::vector<float> host_data(num_elements, 0.f);
+
+  cl::sycl::queue q;
+
+  // Warm-up
+  measure(q, host_data, 1, {});
+
+  bandwidth pageable = measure(q, host_data, num_iterations, {});
+  bandwidth staged = measure(q, host_data, num_iterations,
+      {cl::sycl::hipsycl::property::buffer::use_pinned_staging{}});
+
+  std::cout << "Transfer size: " << size_mb << " MB, "
+            << num_iterations << " iterations" << std::endl;
+  std::cout << "Pageable: H2D " << pageable.h2d << " GB/s, D2H "
+            << pageable.d2h << " GB/s" << std::endl;
+  std::cout << "Staged:   H2D " << staged.h2d << " GB/s, D2H "
+            << staged.d2h << " GB/s" << std::endl;
+
+  return 0;
+}
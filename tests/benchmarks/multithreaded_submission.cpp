@@ -0,0 +1,103 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the throughput of queue::submit() when many host threads
+// submit kernels concurrently. Each thread works on its own buffers,
+// so that submissions are independent and any slowdown compared to
+// a single thread is caused by contention inside the runtime.
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+double run(std::size_t num_threads, std::size_t submissions_per_thread)
+{
+  using namespace cl::sycl::access;
+  constexpr std::size_t num_elements = 256;
+
+  auto start = clock_type::now();
+
+  std::vector<std::thread> threads;
+  for(std::size_t t = 0; t < num_threads; ++t)
+  {
+    threads.emplace_back([=](){
+      cl::sycl::queue q;
+      cl::sycl::buffer<float, 1> a{cl::sycl::range<1>{num_elements}};
+      cl::sycl::buffer<float, 1> b{cl::sycl::range<1>{num_elements}};
+
+      for(std::size_t i = 0; i < submissions_per_thread; ++i)
+      {
+        q.submit([&](cl::sycl::handler& cgh){
+          auto acc_a = a.get_access<mode::read>(cgh);
+          auto acc_b = b.get_access<mode::read_write>(cgh);
+          cgh.parallel_for<class multithreaded_submission_kernel>(
+            cl::sycl::range<1>{num_elements},
+            [=](cl::sycl::id<1> idx){
+              acc_b[idx] += acc_a[idx];
+            });
+        });
+      }
+      q.wait();
+    });
+  }
+
+  for(auto& t : threads)
+    t.join();
+
+  double seconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+
+  return num_threads * submissions_per_thread / seconds;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t max_threads = 32;
+  std::size_t submissions_per_thread = 1000;
+
+  if(argc > 1)
+    max_threads = std::max(1, std::atoi(argv[1]));
+  if(argc > 2)
+    submissions_per_thread = std::max(1, std::atoi(argv[2]));
+
+  std::cout << "Submissions per thread: " << submissions_per_thread << std::endl;
+  for(std::size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+  {
+    std::cout << num_threads << " thread(s): "
+              << run(num_threads, submissions_per_thread)
+              << " submissions/s" << std::endl;
+  }
+
+  return 0;
+}
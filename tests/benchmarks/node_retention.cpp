@@ -0,0 +1,97 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Submits a long chain of dependent command groups and reports the
+// submission throughput and the largest number of task graph nodes
+// alive at any time. Finished nodes are purged as the graph grows,
+// so the number of live nodes must stay bounded regardless of the
+// number of submissions.
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using clock_type = std::chrono::steady_clock;
+using namespace cl::sycl::access;
+
+int main(int argc, char** argv)
+{
+  std::size_t num_submissions = 1000000;
+  if(argc > 1)
+    num_submissions = std::max(1, std::atoi(argv[1]));
+
+  // Generous upper bound for the number of nodes that may be in flight
+  // (or awaiting purging) at any given time
+  constexpr std::size_t max_live_nodes = 10000;
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{1}};
+  {
+    auto acc = buf.get_access<mode::discard_write>();
+    acc[0] = 0;
+  }
+
+  std::size_t max_observed_nodes = 0;
+  auto start = clock_type::now();
+  for(std::size_t i = 0; i < num_submissions; ++i)
+  {
+    q.submit([&](cl::sycl::handler& cgh){
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.single_task<class node_retention_kernel>([=](){
+        acc[0] += 1;
+      });
+    });
+
+    if(i % 1000 == 0)
+      max_observed_nodes = std::max(max_observed_nodes,
+          cl::sycl::detail::task_graph_node::get_num_live_nodes());
+  }
+  q.wait();
+  double seconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+
+  int result = buf.get_access<mode::read>()[0];
+
+  std::cout << "Submissions: " << num_submissions << ", "
+            << num_submissions / seconds << " per second" << std::endl;
+  std::cout << "Max. live task graph nodes: " << max_observed_nodes << std::endl;
+
+  if(result != static_cast<int>(num_submissions))
+  {
+    std::cout << "Error: Counter is " << result << std::endl;
+    return 1;
+  }
+  if(max_observed_nodes >= max_live_nodes)
+  {
+    std::cout << "Error: Task graph nodes are not purged" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Compares summing up a buffer with the reduction API, which combines
+// work items within work groups (or per thread on the CPU), with the
+// naive approach of each work item atomically adding to the result.
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using namespace cl::sycl::access;
+
+double seconds_since(clock_type::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+        clock_type::now() - start).count() * 1.e-6;
+}
+
+void sum_with_reduction(cl::sycl::queue& q,
+                        cl::sycl::buffer<int, 1>& data,
+                        cl::sycl::buffer<int, 1>& result)
+{
+  q.submit([&](cl::sycl::handler& cgh){
+    auto data_acc = data.get_access<mode::read>(cgh);
+    auto result_acc = result.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class reduction_bench_kernel>(data.get_range(),
+      cl::sycl::reduction(result_acc, cl::sycl::plus<int>{}),
+      [=](cl::sycl::id<1> idx, auto& sum){
+        sum += data_acc[idx];
+      });
+  });
+}
+
+void sum_with_atomics(cl::sycl::queue& q,
+                      cl::sycl::buffer<int, 1>& data,
+                      cl::sycl::buffer<int, 1>& result)
+{
+  q.submit([&](cl::sycl::handler& cgh){
+    auto result_acc = result.get_access<mode::discard_write>(cgh);
+    cgh.single_task<class atomic_bench_init>([=](){
+      result_acc[0] = 0;
+    });
+  });
+
+  q.submit([&](cl::sycl::handler& cgh){
+    auto data_acc = data.get_access<mode::read>(cgh);
+    auto result_acc = result.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class atomic_bench_kernel>(data.get_range(),
+      [=](cl::sycl::id<1> idx){
+        cl::sycl::atomic<int> sum{result_acc.get_pointer()};
+        sum.fetch_add(data_acc[idx]);
+      });
+  });
+}
+
+template<class SumFunction>
+double measure(cl::sycl::queue& q,
+               cl::sycl::buffer<int, 1>& data,
+               cl::sycl::buffer<int, 1>& result,
+               std::size_t num_iterations,
+               SumFunction sum)
+{
+  // Warm-up
+  sum(q, data, result);
+  q.wait();
+
+  auto start = clock_type::now();
+  for(std::size_t i = 0; i < num_iterations; ++i)
+    sum(q, data, result);
+  q.wait();
+  return seconds_since(start) / num_iterations;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t num_elements = 64 * 1024 * 1024;
+  std::size_t num_iterations = 10;
+  if(argc > 1)
+    num_elements = std::max(1, std::atoi(argv[1])) * std::size_t{1024 * 1024};
+  if(argc > 2)
+    num_iterations = std::max(1, std::atoi(argv[2]));
+
+  // Small values, such that the sum does not overflow
+  std::vector<int> host_data(num_elements);
+  for(std::size_t i = 0; i < num_elements; ++i)
+    host_data[i] = static_cast<int>(i % 7) - 3;
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> data{host_data.data(),
+                                cl::sycl::range<1>{num_elements}};
+  cl::sycl::buffer<int, 1> reduction_result{cl::sycl::range<1>{1}};
+  cl::sycl::buffer<int, 1> atomic_result{cl::sycl::range<1>{1}};
+
+  double reduction_time = measure(q, data, reduction_result,
+                                  num_iterations, sum_with_reduction);
+  double atomic_time = measure(q, data, atomic_result,
+                               num_iterations, sum_with_atomics);
+
+  int reduction_sum = reduction_result.get_access<mode::read>()[0];
+  int atomic_sum = atomic_result.get_access<mode::read>()[0];
+
+  double gb = static_cast<double>(num_elements * sizeof(int)) * 1.e-9;
+  std::cout << "Elements: " << num_elements << ", "
+            << num_iterations << " iterations" << std::endl;
+  std::cout << "Reduction: " << reduction_time * 1.e3 << " ms ("
+            << gb / reduction_time << " GB/s), sum " << reduction_sum
+            << std::endl;
+  std::cout << "Atomics:   " << atomic_time * 1.e3 << " ms ("
+            << gb / atomic_time << " GB/s), sum " << atomic_sum
+            << std::endl;
+
+  if(reduction_sum != atomic_sum)
+  {
+    std::cout << "Error: Results differ" << std::endl;
+    return 1;
+  }
+  return 0;
+}
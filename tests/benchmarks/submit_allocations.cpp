@@ -0,0 +1,158 @@
+/*
+ * This file is part of hipSYCL, a SYCL implementation based on CUDA/HIP
+ *
+ * Copyright (c) 2018, 2019 Aksel Alpay and contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Reports the number of heap allocations per queue::submit() in
+// steady state, i.e. after buffers have been moved to the device and
+// the runtime's internal pools have been populated.
+// Only allocations performed by the submitting thread are counted,
+// since allocations by the backend's own threads (e.g. the hipCPU
+// kernel execution) are outside of the SYCL runtime's control.
+//
+// In steady state, submissions should not allocate at all. The lists
+// that the runtime creates per command group (accessed regions,
+// dependencies, successors, accessed buffers) store a few elements
+// inline, and task nodes and kernel functors use pooled or inline
+// storage. What remains are rare allocations when such a list
+// outgrows its inline capacity, or when a container that keeps its
+// capacity has to grow. The benchmark fails if a submission
+// allocates more than that on average.
+
+#include <CL/sycl.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace {
+
+thread_local std::size_t num_allocations = 0;
+
+}
+
+void* operator new(std::size_t size)
+{
+  ++num_allocations;
+  if(void* ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  ::operator delete(ptr);
+}
+
+template<class Submission>
+double measure_allocations_per_submit(cl::sycl::queue& q,
+                                      std::size_t num_submissions,
+                                      Submission s)
+{
+  // Warm-up to populate pools and move data to the device
+  for(std::size_t i = 0; i < num_submissions; ++i)
+    q.submit(s);
+  q.wait();
+
+  std::size_t allocations_before = num_allocations;
+  for(std::size_t i = 0; i < num_submissions; ++i)
+    q.submit(s);
+  std::size_t allocations_after = num_allocations;
+  q.wait();
+
+  return static_cast<double>(allocations_after - allocations_before) /
+         num_submissions;
+}
+
+int main(int argc, char** argv)
+{
+  using namespace cl::sycl::access;
+
+  // Allowed allocations per submit, see above
+  constexpr double allocation_budget = 0.1;
+
+  std::size_t num_submissions = 10000;
+  if(argc > 1)
+    num_submissions = std::max(1, std::atoi(argv[1]));
+
+  constexpr std::size_t num_elements = 1024;
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> a{cl::sycl::range<1>{num_elements}};
+  cl::sycl::buffer<float, 1> b{cl::sycl::range<1>{num_elements}};
+
+  std::cout << "Submissions per measurement: " << num_submissions << std::endl;
+
+  double no_accessor = measure_allocations_per_submit(q, num_submissions,
+    [&](cl::sycl::handler& cgh){
+      cgh.single_task<class alloc_bench_empty>([=](){});
+    });
+  std::cout << "Allocations per submit (no accessors):  "
+            << no_accessor << std::endl;
+
+  double one_accessor = measure_allocations_per_submit(q, num_submissions,
+    [&](cl::sycl::handler& cgh){
+      auto acc_a = a.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class alloc_bench_one>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> idx){
+          acc_a[idx] += 1.f;
+        });
+    });
+  std::cout << "Allocations per submit (1 accessor):    "
+            << one_accessor << std::endl;
+
+  double two_accessors = measure_allocations_per_submit(q, num_submissions,
+    [&](cl::sycl::handler& cgh){
+      auto acc_a = a.get_access<mode::read>(cgh);
+      auto acc_b = b.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class alloc_bench_two>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> idx){
+          acc_b[idx] += acc_a[idx];
+        });
+    });
+  std::cout << "Allocations per submit (2 accessors):   "
+            << two_accessors << std::endl;
+
+  bool within_budget = true;
+  auto check_budget = [&](const char* name, double allocations,
+                          double budget){
+    if(allocations > budget)
+    {
+      std::cout << "Submissions with " << name << " exceed the budget of "
+                << budget << " allocations" << std::endl;
+      within_budget = false;
+    }
+  };
+  check_budget("no accessors", no_accessor, allocation_budget);
+  check_budget("1 accessor", one_accessor, allocation_budget);
+  check_budget("2 accessors", two_accessors, allocation_budget);
+
+  return within_budget ? 0 : 1;
+}
@@ -26,6 +26,12 @@
  */
 
 #include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #define BOOST_MPL_CFG_GPU_ENABLED // Required for nvcc
 #define BOOST_TEST_DYN_LINK
@@ -35,6 +41,9 @@
 
 #define SYCL_SIMPLE_SWIZZLES
 #include <CL/sycl.hpp>
+#include <CL/sycl/detail/device_memory_pool.hpp>
+#include <CL/sycl/detail/staging_buffer_pool.hpp>
+#include <CL/sycl/detail/host_thread_pool.hpp>
 
 struct reset_device_fixture {
   ~reset_device_fixture() {
@@ -116,6 +125,57 @@ BOOST_AUTO_TEST_CASE(basic_parallel_for_nd) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(parallel_for_nd_work_item_queries) {
+  using namespace cl::sycl::access;
+  constexpr size_t group_size_x = 4;
+  constexpr size_t group_size_y = 8;
+  constexpr size_t num_groups_x = 3;
+  constexpr size_t num_groups_y = 5;
+  const cl::sycl::range<2> global_size{group_size_x * num_groups_x,
+                                       group_size_y * num_groups_y};
+  const cl::sycl::id<2> offset{2, 1};
+
+  cl::sycl::queue queue;
+  cl::sycl::buffer<cl::sycl::int4, 2> buf{global_size};
+  queue.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::discard_write>(cgh);
+    auto scratch = cl::sycl::accessor<int, 1, mode::read_write, target::local>
+      {group_size_x * group_size_y, cgh};
+
+    cgh.parallel_for<class nd_work_item_queries>(
+      cl::sycl::nd_range<2>{global_size,
+        cl::sycl::range<2>{group_size_x, group_size_y}, offset},
+      [=](cl::sycl::nd_item<2> item) {
+        // Only the own element of local memory is used, so the kernel
+        // does not need to synchronize work items.
+        const size_t lid = item.get_local_linear_id();
+        scratch[lid] = static_cast<int>(lid);
+        const cl::sycl::id<2> gid = item.get_global() - item.get_offset();
+        acc[gid] = cl::sycl::int4{
+          static_cast<int>(item.get_global_linear_id()),
+          static_cast<int>(item.get_group_linear_id()),
+          scratch[lid],
+          static_cast<int>(item.get_group().get_local_range(1) *
+                           item.get_num_groups(1))};
+      });
+  });
+
+  auto acc = buf.get_access<mode::read>();
+  for(size_t i = 0; i < global_size[0]; ++i)
+    for(size_t j = 0; j < global_size[1]; ++j) {
+      const cl::sycl::int4 v = acc[cl::sycl::id<2>{i, j}];
+      const size_t group_linear_id = (i / group_size_x) * num_groups_y +
+                                     j / group_size_y;
+      const size_t local_linear_id = (i % group_size_x) * group_size_y +
+                                     j % group_size_y;
+      BOOST_REQUIRE(v.x() == static_cast<int>(
+        (i + offset[0]) * global_size[1] + j + offset[1]));
+      BOOST_REQUIRE(v.y() == static_cast<int>(group_linear_id));
+      BOOST_REQUIRE(v.z() == static_cast<int>(local_linear_id));
+      BOOST_REQUIRE(v.w() == static_cast<int>(global_size[1]));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(hierarchical_dispatch) {
   constexpr size_t local_size = 256;
   constexpr size_t global_size = 1024;
@@ -201,6 +261,86 @@ BOOST_AUTO_TEST_CASE(dynamic_local_memory) {
   }
 }
 
+using barrier_lowering_global_accessor = cl::sycl::accessor<int, 2,
+  cl::sycl::access::mode::read_write, cl::sycl::access::target::global_buffer>;
+using barrier_lowering_local_accessor = cl::sycl::accessor<int, 2,
+  cl::sycl::access::mode::read_write, cl::sycl::access::target::local>;
+
+// Private variables live across barriers, including a barrier in a loop,
+// such that the clang plugin has to keep them in the work item frame
+// when it splits the kernel on the CPU.
+struct barrier_lowering_kernel {
+  barrier_lowering_global_accessor acc;
+  barrier_lowering_local_accessor scratch;
+
+  void operator()(cl::sycl::nd_item<2> item) const {
+    const cl::sycl::id<2> lid = item.get_local();
+    const cl::sycl::range<2> local_range = item.get_local_range();
+
+    const int x = acc[item.get_global()];
+    scratch[lid] = x;
+    item.barrier();
+
+    int row_sum = 0;
+    for(size_t i = 0; i < local_range[1]; ++i) {
+      row_sum += scratch[cl::sycl::id<2>{lid[0], (lid[1] + i) % local_range[1]}];
+      item.barrier();
+    }
+    scratch[lid] = row_sum;
+    item.barrier();
+
+    acc[item.get_global()] =
+      x + scratch[cl::sycl::id<2>{(lid[0] + 1) % local_range[0], lid[1]}];
+  }
+};
+
+BOOST_AUTO_TEST_CASE(ndrange_barrier_lowering) {
+  using namespace cl::sycl::access;
+  const cl::sycl::range<2> global_range{8, 16};
+  const cl::sycl::range<2> local_range{4, 8};
+
+  std::vector<int> host_buf(global_range.size());
+  for(size_t i = 0; i < global_range[0]; ++i)
+    for(size_t j = 0; j < global_range[1]; ++j)
+      host_buf[i * global_range[1] + j] = static_cast<int>(i * 100 + j);
+  const std::vector<int> input = host_buf;
+
+  {
+    cl::sycl::queue queue;
+    cl::sycl::buffer<int, 2> buf{host_buf.data(), global_range};
+    queue.submit([&](cl::sycl::handler& cgh) {
+      barrier_lowering_kernel kernel{
+        buf.get_access<mode::read_write>(cgh),
+        barrier_lowering_local_accessor{local_range, cgh}};
+      cgh.parallel_for<barrier_lowering_kernel>(
+        cl::sycl::nd_range<2>{global_range, local_range}, kernel);
+    });
+  }
+
+  auto row_sum = [&](size_t row, size_t group_col) {
+    int sum = 0;
+    for(size_t j = 0; j < local_range[1]; ++j)
+      sum += input[row * global_range[1] + group_col * local_range[1] + j];
+    return sum;
+  };
+  for(size_t i = 0; i < global_range[0]; ++i)
+    for(size_t j = 0; j < global_range[1]; ++j) {
+      const size_t group_row = i / local_range[0] * local_range[0];
+      const size_t next_row = group_row + (i - group_row + 1) % local_range[0];
+      const int expected = input[i * global_range[1] + j] +
+                           row_sum(next_row, j / local_range[1]);
+      BOOST_REQUIRE(host_buf[i * global_range[1] + j] == expected);
+    }
+
+#if defined(HIPSYCL_PLATFORM_CPU) && defined(HIPSYCL_CLANG_PLUGIN)
+  // The kernel must have been split at its barriers by the plugin,
+  // rather than falling back to hipCPU's execution model
+  namespace host_dispatch = cl::sycl::detail::host_dispatch;
+  BOOST_CHECK(host_dispatch::work_item_frame_size_query(
+    &host_dispatch::work_item_region<2, barrier_lowering_kernel>) > 0);
+#endif
+}
+
 BOOST_AUTO_TEST_CASE(placeholder_accessors) {
   using namespace cl::sycl::access;
   constexpr size_t num_elements = 4096 * 1024;
@@ -278,6 +418,1251 @@ BOOST_AUTO_TEST_CASE(task_graph_synchronization) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(task_graph_long_dependency_chain) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_elements = 1024;
+  constexpr int num_iterations = 200;
+
+  cl::sycl::queue q1;
+  cl::sycl::queue q2;
+  cl::sycl::buffer<int, 1> buf{num_elements};
+
+  {
+    auto acc = buf.get_access<mode::discard_write>();
+    for(size_t i = 0; i < num_elements; ++i) acc[i] = 0;
+  }
+
+  // Alternate between queues so that each node depends on a node
+  // from another stream
+  for(int i = 0; i < num_iterations; ++i) {
+    cl::sycl::queue& q = (i % 2 == 0) ? q1 : q2;
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class tdag_long_chain>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] += 1;
+        });
+    });
+  }
+
+  auto acc = buf.get_access<mode::read>();
+  for(size_t i = 0; i < num_elements; ++i) {
+    BOOST_REQUIRE(acc[i] == num_iterations);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(task_graph_same_stream_submission) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_elements = 1024;
+  constexpr int num_iterations = 100;
+
+  cl::sycl::queue q1;
+  cl::sycl::queue q2;
+  cl::sycl::buffer<int, 1> buf{num_elements};
+
+  {
+    auto acc = buf.get_access<mode::discard_write>();
+    for(size_t i = 0; i < num_elements; ++i) acc[i] = 0;
+  }
+
+  // Back-to-back kernels on the same queue only rely on
+  // stream ordering...
+  for(int i = 0; i < num_iterations; ++i) {
+    q1.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class same_stream_increment>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] += 1;
+        });
+    });
+  }
+  // ...while a kernel on another queue must wait for their completion
+  q2.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class same_stream_consumer>(cl::sycl::range<1>{num_elements},
+      [=](cl::sycl::id<1> tid) {
+        acc[tid] *= 2;
+      });
+  });
+
+  auto acc = buf.get_access<mode::read>();
+  for(size_t i = 0; i < num_elements; ++i) {
+    BOOST_REQUIRE(acc[i] == 2 * num_iterations);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(task_graph_bounded_node_retention) {
+  using namespace cl::sycl::access;
+  namespace detail = cl::sycl::detail;
+  // Enough submissions for many purge cycles. Without purging, the
+  // number of live nodes would exceed max_live_nodes.
+  // tests/benchmarks/node_retention runs this at a larger scale.
+  constexpr size_t num_submissions = 20000;
+  // Generous upper bound for the number of nodes that may be in flight
+  // (or awaiting purging) at any given time
+  constexpr size_t max_live_nodes = 10000;
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{1}};
+  {
+    auto acc = buf.get_access<mode::discard_write>();
+    acc[0] = 0;
+  }
+
+  size_t max_observed_nodes = 0;
+  // Keep the most recent event alive, as an application
+  // waiting on its last submission would
+  cl::sycl::event evt;
+  for(size_t i = 0; i < num_submissions; ++i) {
+    evt = q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.single_task<class bounded_retention_kernel>([=]() {
+        acc[0] += 1;
+      });
+    });
+
+    if(i % 100 == 0) {
+      max_observed_nodes = std::max(max_observed_nodes,
+                                    detail::task_graph_node::get_num_live_nodes());
+      BOOST_REQUIRE(max_observed_nodes < max_live_nodes);
+    }
+  }
+  evt.wait();
+
+  auto acc = buf.get_access<mode::read>();
+  BOOST_CHECK(acc[0] == static_cast<int>(num_submissions));
+}
+
+BOOST_AUTO_TEST_CASE(task_graph_failed_submission) {
+  namespace detail = cl::sycl::detail;
+  auto& tg = detail::application::get_task_graph();
+  detail::stream_ptr stream = detail::stream_manager::default_stream();
+
+  std::size_t num_errors = 0;
+  cl::sycl::async_handler handler = [&](cl::sycl::exception_list errors) {
+    num_errors += errors.size();
+  };
+
+  auto failing = tg.insert([]() -> detail::task_state {
+      throw cl::sycl::runtime_error{"failing task"};
+    }, {}, stream, handler, detail::task_execution_kind::stream_ordered);
+
+  bool successor_executed = false;
+  auto successor = tg.insert([&]() {
+      successor_executed = true;
+      return detail::task_state::complete;
+    }, {failing}, stream, handler);
+
+  // Must neither block forever on the failed node nor on its successor
+  successor->wait();
+  BOOST_CHECK(failing->is_done());
+  BOOST_CHECK(successor_executed);
+  BOOST_CHECK(num_errors == 1);
+  tg.finish();
+}
+
+BOOST_AUTO_TEST_CASE(task_graph_wait_policies) {
+  using namespace cl::sycl::access;
+  namespace detail = cl::sycl::detail;
+  constexpr size_t num_elements = 1024;
+
+  for(auto policy : {detail::wait_policy::latency,
+                     detail::wait_policy::cpu_efficiency}) {
+    detail::application::get_task_graph().set_wait_policy(policy);
+    BOOST_CHECK(detail::application::get_task_graph().get_wait_policy() == policy);
+
+    cl::sycl::queue q;
+    cl::sycl::buffer<int, 1> buf{num_elements};
+
+    auto evt = q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::discard_write>(cgh);
+      cgh.parallel_for<class wait_policy_kernel>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] = static_cast<int>(tid[0]);
+        });
+    });
+    evt.wait();
+    q.wait();
+
+    auto acc = buf.get_access<mode::read>();
+    for(size_t i = 0; i < num_elements; ++i) {
+      BOOST_REQUIRE(acc[i] == static_cast<int>(i));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(event_profiling) {
+  using namespace cl::sycl::access;
+  using cl::sycl::info::event_profiling;
+  constexpr size_t num_elements = 4096;
+
+  cl::sycl::queue q{cl::sycl::property_list{
+    cl::sycl::property::queue::enable_profiling{}}};
+  cl::sycl::buffer<int, 1> buf{num_elements};
+
+  cl::sycl::event evts[2];
+  for(int i = 0; i < 2; ++i) {
+    evts[i] = q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class profiled_kernel>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] = static_cast<int>(tid[0]);
+        });
+    });
+  }
+
+  for(const auto& evt : evts) {
+    auto submit = evt.get_profiling_info<event_profiling::command_submit>();
+    auto start = evt.get_profiling_info<event_profiling::command_start>();
+    auto end = evt.get_profiling_info<event_profiling::command_end>();
+    BOOST_CHECK(submit <= start);
+    BOOST_CHECK(start <= end);
+  }
+  // The second kernel depends on the first one
+  BOOST_CHECK(evts[0].get_profiling_info<event_profiling::command_end>() <=
+              evts[1].get_profiling_info<event_profiling::command_start>());
+
+  cl::sycl::queue unprofiled_q;
+  auto evt = unprofiled_q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class unprofiled_kernel>(cl::sycl::range<1>{num_elements},
+      [=](cl::sycl::id<1> tid) {
+        acc[tid] = 0;
+      });
+  });
+  BOOST_CHECK_THROW(evt.get_profiling_info<event_profiling::command_end>(),
+                    cl::sycl::invalid_object_error);
+  BOOST_CHECK_THROW(cl::sycl::event{}.get_profiling_info<event_profiling::command_submit>(),
+                    cl::sycl::invalid_object_error);
+}
+
+BOOST_AUTO_TEST_CASE(command_graph_replay) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_elements = 1024;
+  constexpr int num_iterations = 10;
+
+  auto submit_iteration = [&](cl::sycl::queue& q,
+                              cl::sycl::buffer<int, 1>& a,
+                              cl::sycl::buffer<int, 1>& b) {
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc_a = a.get_access<mode::read>(cgh);
+      auto acc_b = b.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class command_graph_step1>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc_b[tid] += acc_a[tid];
+        });
+    });
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc_a = a.get_access<mode::read_write>(cgh);
+      auto acc_b = b.get_access<mode::read>(cgh);
+      cgh.parallel_for<class command_graph_step2>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc_a[tid] = acc_b[tid] - acc_a[tid] + 1;
+        });
+    });
+  };
+
+  auto initialize = [&](cl::sycl::buffer<int, 1>& a, cl::sycl::buffer<int, 1>& b) {
+    auto acc_a = a.get_access<mode::discard_write>();
+    auto acc_b = b.get_access<mode::discard_write>();
+    for(size_t i = 0; i < num_elements; ++i) {
+      acc_a[i] = static_cast<int>(i);
+      acc_b[i] = 0;
+    }
+  };
+
+  cl::sycl::queue q;
+
+  cl::sycl::buffer<int, 1> eager_a{num_elements}, eager_b{num_elements};
+  cl::sycl::buffer<int, 1> replay_a{num_elements}, replay_b{num_elements};
+  initialize(eager_a, eager_b);
+  initialize(replay_a, replay_b);
+
+  cl::sycl::hipsycl::command_graph graph{q};
+  graph.begin_recording();
+  BOOST_CHECK(graph.is_recording());
+  // Submissions are also executed while recording
+  submit_iteration(q, replay_a, replay_b);
+  graph.end_recording();
+  BOOST_CHECK(!graph.is_recording());
+  BOOST_CHECK(graph.get_num_commands() == 2);
+
+  submit_iteration(q, eager_a, eager_b);
+
+  for(int i = 1; i < num_iterations; ++i) {
+    submit_iteration(q, eager_a, eager_b);
+    graph.replay();
+
+    // Host accesses between replays must be synchronized with
+    // the replayed commands, and the host-side modification forces
+    // the next replay to update the device data.
+    if(i == num_iterations / 2) {
+      auto acc_a = replay_a.get_access<mode::read_write>();
+      auto eager_acc_a = eager_a.get_access<mode::read_write>();
+      for(size_t j = 0; j < num_elements; ++j) {
+        BOOST_REQUIRE(acc_a[j] == eager_acc_a[j]);
+        acc_a[j] += 1;
+        eager_acc_a[j] += 1;
+      }
+    }
+  }
+  graph.replay().wait();
+  submit_iteration(q, eager_a, eager_b);
+
+  auto acc_eager_a = eager_a.get_access<mode::read>();
+  auto acc_eager_b = eager_b.get_access<mode::read>();
+  auto acc_replay_a = replay_a.get_access<mode::read>();
+  auto acc_replay_b = replay_b.get_access<mode::read>();
+  for(size_t i = 0; i < num_elements; ++i) {
+    BOOST_REQUIRE(acc_eager_a[i] == acc_replay_a[i]);
+    BOOST_REQUIRE(acc_eager_b[i] == acc_replay_b[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(command_graph_rejects_host_operations) {
+  using namespace cl::sycl::access;
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{16}};
+
+  cl::sycl::hipsycl::command_graph graph{q};
+  graph.begin_recording();
+  BOOST_CHECK_THROW(q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read>(cgh);
+    cgh.update_host(acc);
+  }), cl::sycl::feature_not_supported);
+  graph.end_recording();
+  BOOST_CHECK(graph.get_num_commands() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(buffer_state_monitor_regions) {
+  using namespace cl::sycl::access;
+  using cl::sycl::detail::buffer_region_list;
+
+  cl::sycl::detail::buffer_state_monitor monitor{false, 1000};
+
+  auto check_regions = [](const buffer_region_list& regions,
+                          const buffer_region_list& expected) {
+    BOOST_REQUIRE(regions.size() == expected.size());
+    for(std::size_t i = 0; i < regions.size(); ++i) {
+      BOOST_CHECK(regions[i].begin == expected[i].begin);
+      BOOST_CHECK(regions[i].end == expected[i].end);
+    }
+  };
+
+  check_regions(monitor.register_device_access(mode::discard_write), {});
+  check_regions(monitor.register_host_access(mode::read, {{100, 200}}),
+                {{100, 200}});
+  // Only the part that has not been transferred yet is outdated
+  check_regions(monitor.register_host_access(mode::read, {{150, 300}}),
+                {{200, 300}});
+  // Adjacent outdated regions are merged
+  check_regions(monitor.register_host_access(mode::read, {{0, 100}, {300, 400}, {50, 150}}),
+                {{0, 100}, {300, 400}});
+  check_regions(monitor.get_outdated_host_regions(), {{400, 1000}});
+
+  check_regions(monitor.register_host_access(mode::write, {{500, 600}}),
+                {{500, 600}});
+  check_regions(monitor.register_device_access(mode::read), {{500, 600}});
+
+  check_regions(monitor.register_host_access(mode::discard_write), {});
+  BOOST_CHECK(monitor.get_num_tracked_regions() == 1);
+  BOOST_CHECK(!monitor.is_host_outdated());
+  BOOST_CHECK(monitor.is_device_outdated());
+}
+
+BOOST_AUTO_TEST_CASE(buffer_access_log_regions) {
+  using namespace cl::sycl::access;
+  using namespace cl::sycl::detail;
+
+  // Nodes that are never inserted into the graph remain pending
+  auto make_node = []() {
+    return std::make_shared<task_graph_node>(
+        []() { return task_state::complete; },
+        task_graph_node_list{},
+        stream_manager::default_stream(),
+        cl::sycl::async_handler{},
+        &application::get_task_graph());
+  };
+  auto depends_on = [](const task_graph_node_list& deps,
+                       const task_graph_node_ptr& node) {
+    return std::find(deps.begin(), deps.end(), node) != deps.end();
+  };
+
+  // Top and bottom half of a 2D buffer of 8x8 ints
+  const cl::sycl::range<2> shape{8, 8};
+  auto top = accessor::get_accessed_regions<int>(
+      shape, cl::sycl::range<2>{4, 8}, cl::sycl::id<2>{0, 0});
+  auto bottom = accessor::get_accessed_regions<int>(
+      shape, cl::sycl::range<2>{4, 8}, cl::sycl::id<2>{4, 0});
+  // Left columns, overlapping with both halves
+  auto left = accessor::get_accessed_regions<int>(
+      shape, cl::sycl::range<2>{8, 2}, cl::sycl::id<2>{0, 0});
+  buffer_region_list whole{{0, shape.size() * sizeof(int)}};
+
+  buffer_access_log log;
+  auto top_writer = make_node();
+  auto bottom_writer = make_node();
+  log.add_operation(top_writer, mode::discard_write, top);
+  // Disjoint writers do not depend on each other
+  BOOST_CHECK(log.calculate_dependencies(mode::discard_write, bottom).empty());
+  log.add_operation(bottom_writer, mode::discard_write, bottom);
+
+  auto deps = log.calculate_dependencies(mode::read, top);
+  BOOST_CHECK(deps.size() == 1 && depends_on(deps, top_writer));
+
+  auto left_reader = make_node();
+  log.add_operation(left_reader, mode::read, left);
+  deps = log.calculate_dependencies(mode::read, left);
+  BOOST_CHECK(deps.size() == 2 && !depends_on(deps, left_reader));
+
+  // Whole-buffer accesses depend on everything
+  deps = log.calculate_dependencies(mode::read_write, whole);
+  BOOST_CHECK(deps.size() == 3);
+  deps = log.calculate_dependencies(mode::write, bottom);
+  BOOST_CHECK(deps.size() == 2 && depends_on(deps, bottom_writer) &&
+              depends_on(deps, left_reader));
+
+  // A write to the bottom half replaces the previous writer of that half,
+  // but not the reader that also covers parts of the top half
+  auto bottom_rewriter = make_node();
+  log.add_operation(bottom_rewriter, mode::write, bottom);
+  deps = log.calculate_dependencies(mode::read_write, whole);
+  BOOST_CHECK(deps.size() == 3 && !depends_on(deps, bottom_writer));
+
+  // A whole-buffer write replaces everything
+  auto whole_writer = make_node();
+  log.add_operation(whole_writer, mode::read_write, whole);
+  deps = log.calculate_dependencies(mode::read, top);
+  BOOST_CHECK(deps.size() == 1 && depends_on(deps, whole_writer));
+}
+
+BOOST_AUTO_TEST_CASE(ranged_accessor_transfers) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_rows = 64;
+  constexpr size_t num_cols = 32;
+  const cl::sycl::range<2> buffer_range{num_rows, num_cols};
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 2> buf{buffer_range};
+
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class ranged_init>(buffer_range,
+      [=](cl::sycl::id<2> tid) {
+        acc[tid] = static_cast<int>(tid[0] * num_cols + tid[1]);
+      });
+  });
+
+  {
+    // Read a few rows and modify a column on the host
+    auto rows = buf.get_access<mode::read_write>(cl::sycl::range<2>{4, num_cols},
+                                                 cl::sycl::id<2>{10, 0});
+    for(size_t i = 10; i < 14; ++i)
+      for(size_t j = 0; j < num_cols; ++j) {
+        BOOST_REQUIRE(rows[cl::sycl::id<2>(i, j)] == static_cast<int>(i * num_cols + j));
+        rows[cl::sycl::id<2>(i, j)] = -1;
+      }
+  }
+  {
+    auto column = buf.get_access<mode::read_write>(cl::sycl::range<2>{num_rows, 1},
+                                                   cl::sycl::id<2>{0, 5});
+    for(size_t i = 0; i < num_rows; ++i) {
+      int expected = (i >= 10 && i < 14) ? -1 : static_cast<int>(i * num_cols + 5);
+      BOOST_REQUIRE(column[cl::sycl::id<2>(i, 5)] == expected);
+      column[cl::sycl::id<2>(i, 5)] = -2;
+    }
+  }
+
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class ranged_increment>(buffer_range,
+      [=](cl::sycl::id<2> tid) {
+        acc[tid] += 1;
+      });
+  });
+
+  auto acc = buf.get_access<mode::read>();
+  for(size_t i = 0; i < num_rows; ++i)
+    for(size_t j = 0; j < num_cols; ++j) {
+      int expected = static_cast<int>(i * num_cols + j);
+      if(i >= 10 && i < 14)
+        expected = -1;
+      if(j == 5)
+        expected = -2;
+      BOOST_REQUIRE(acc[cl::sycl::id<2>(i, j)] == expected + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sub_buffers) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_rows = 16;
+  constexpr size_t num_cols = 8;
+
+  std::vector<int> host_data(num_rows * num_cols, 0);
+  {
+    cl::sycl::queue q1;
+    cl::sycl::queue q2;
+    cl::sycl::buffer<int, 2> buf{host_data.data(),
+                                 cl::sycl::range<2>{num_rows, num_cols}};
+    // Upper and lower half of the rows
+    cl::sycl::buffer<int, 2> upper{buf, cl::sycl::id<2>{0, 0},
+                                   cl::sycl::range<2>{num_rows / 2, num_cols}};
+    cl::sycl::buffer<int, 2> lower{buf, cl::sycl::id<2>{num_rows / 2, 0},
+                                   cl::sycl::range<2>{num_rows / 2, num_cols}};
+
+    BOOST_CHECK(!buf.is_sub_buffer());
+    BOOST_CHECK(upper.is_sub_buffer());
+    BOOST_CHECK(lower.get_range() == cl::sycl::range<2>(num_rows / 2, num_cols));
+
+    // Sub-buffers must be contiguous
+    BOOST_CHECK_THROW((cl::sycl::buffer<int, 2>{buf, cl::sycl::id<2>{0, 1},
+                       cl::sycl::range<2>{num_rows, num_cols - 1}}),
+                      cl::sycl::invalid_object_error);
+    BOOST_CHECK_THROW((cl::sycl::buffer<int, 2>{buf, cl::sycl::id<2>{num_rows / 2, 0},
+                       cl::sycl::range<2>{num_rows, num_cols}}),
+                      cl::sycl::invalid_object_error);
+
+    q1.submit([&](cl::sycl::handler& cgh) {
+      auto acc = upper.get_access<mode::discard_write>(cgh);
+      cgh.parallel_for<class sub_buffer_upper>(upper.get_range(),
+        [=](cl::sycl::id<2> tid) {
+          acc[tid] = 1;
+        });
+    });
+    q2.submit([&](cl::sycl::handler& cgh) {
+      auto acc = lower.get_access<mode::discard_write>(cgh);
+      cgh.parallel_for<class sub_buffer_lower>(lower.get_range(),
+        [=](cl::sycl::id<2> tid) {
+          acc[tid] = 2;
+        });
+    });
+    // Conflicts with both sub-buffer kernels
+    q1.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class sub_buffer_parent>(buf.get_range(),
+        [=](cl::sycl::id<2> tid) {
+          acc[tid] += static_cast<int>(tid[1]);
+        });
+    });
+
+    {
+      auto acc = lower.get_access<mode::read>();
+      for(size_t i = 0; i < num_rows / 2; ++i)
+        for(size_t j = 0; j < num_cols; ++j)
+          BOOST_REQUIRE(acc[cl::sycl::id<2>(i, j)] == static_cast<int>(2 + j));
+    }
+    // The sub-buffers outlive the parent buffer object
+    buf = cl::sycl::buffer<int, 2>{cl::sycl::range<2>{1, 1}};
+  }
+
+  for(size_t i = 0; i < num_rows; ++i)
+    for(size_t j = 0; j < num_cols; ++j) {
+      int expected = (i < num_rows / 2 ? 1 : 2) + static_cast<int>(j);
+      BOOST_REQUIRE(host_data[i * num_cols + j] == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(device_memory_pool) {
+  using cl::sycl::detail::device_memory_pool;
+  int device = 0;
+  BOOST_REQUIRE(hipGetDevice(&device) == hipSuccess);
+
+  BOOST_CHECK(device_memory_pool::get_size_class(1) ==
+              device_memory_pool::min_size_class);
+  BOOST_CHECK(device_memory_pool::get_size_class(3000) == 4096);
+  BOOST_CHECK(device_memory_pool::get_size_class(
+                device_memory_pool::large_size_threshold + 1) ==
+              device_memory_pool::large_size_threshold +
+              device_memory_pool::large_size_granularity);
+
+  device_memory_pool pool{1 << 20};
+
+  void* a = pool.allocate(1000);
+  void* b = pool.allocate(1000);
+  BOOST_CHECK(a != b);
+  pool.release(a);
+  // Same size class
+  BOOST_CHECK(pool.allocate(600) == a);
+  pool.release(a);
+  pool.release(b);
+
+  auto stats = pool.get_statistics(device);
+  BOOST_CHECK(stats.num_allocations == 3);
+  BOOST_CHECK(stats.num_cache_hits == 1);
+  BOOST_CHECK(stats.bytes_in_use == 0);
+  BOOST_CHECK(stats.bytes_cached == 2048);
+  BOOST_CHECK(stats.peak_bytes_in_use == 2048);
+  BOOST_CHECK(stats.peak_bytes_reserved == 2048);
+
+  // Exceeds the cache limit
+  void* large = pool.allocate(2 << 20);
+  pool.release(large);
+  BOOST_CHECK(pool.get_statistics(device).bytes_cached == 2048);
+
+  pool.trim(device, 1024);
+  BOOST_CHECK(pool.get_statistics(device).bytes_cached == 1024);
+  pool.trim();
+  BOOST_CHECK(pool.get_statistics(device).bytes_cached == 0);
+
+  // Stream-ordered reuse
+  cl::sycl::queue q;
+  hipStream_t stream = q.get_hip_stream();
+  void* c = pool.allocate(4096, stream);
+  pool.release(c, stream);
+  BOOST_CHECK(pool.allocate(4096, stream) == c);
+  pool.release(c, stream);
+  q.wait();
+
+#ifndef HIPSYCL_PLATFORM_CPU
+  // Buffers obtain their device memory from the runtime's pool.
+  // On the CPU, they use their host memory instead.
+  auto& runtime_pool = device_memory_pool::get();
+  auto use_on_device = [&](std::size_t size) {
+    // Waits for the kernel on destruction, so the memory is
+    // returned to the pool immediately
+    std::vector<int> data(size);
+    cl::sycl::buffer<int, 1> buf{data.data(), cl::sycl::range<1>{size}};
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<cl::sycl::access::mode::discard_write>(cgh);
+      cgh.single_task<class pool_buffer_init>([=]() { acc[0] = 0; });
+    });
+  };
+  use_on_device(1024);
+  std::size_t hits = runtime_pool.get_statistics(device).num_cache_hits;
+  use_on_device(1000);
+  BOOST_CHECK(runtime_pool.get_statistics(device).num_cache_hits == hits + 1);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(pinned_staging_transfers) {
+  using namespace cl::sycl::access;
+  namespace staging = cl::sycl::hipsycl::property::buffer;
+  // Not a multiple of the staging block size
+  constexpr size_t num_elements =
+      5 * cl::sycl::detail::staging_buffer_pool::block_size / sizeof(int) + 37;
+
+  std::vector<int> host_data(num_elements);
+  for(size_t i = 0; i < num_elements; ++i)
+    host_data[i] = static_cast<int>(i);
+
+  cl::sycl::queue q;
+  {
+    cl::sycl::buffer<int, 1> buf{host_data.data(),
+                                 cl::sycl::range<1>{num_elements},
+                                 {staging::use_pinned_staging{}}};
+
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class staged_increment>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] += 1;
+        });
+    });
+
+    {
+      // Staged transfer of a region with unaligned offset
+      auto acc = buf.get_access<mode::read_write>(cl::sycl::range<1>{num_elements / 2},
+                                                  cl::sycl::id<1>{1001});
+      for(size_t i = 1001; i < 1001 + num_elements / 2; ++i) {
+        BOOST_REQUIRE(acc[i] == static_cast<int>(i + 1));
+        acc[i] = -static_cast<int>(i);
+      }
+    }
+
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class staged_double>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] *= 2;
+        });
+    });
+  }
+#ifndef HIPSYCL_PLATFORM_CPU
+  // There are no transfers to stage on the CPU
+  BOOST_CHECK(cl::sycl::detail::staging_buffer_pool::get().get_num_blocks() > 0);
+#endif
+
+  // Written back through the staging blocks
+  for(size_t i = 0; i < num_elements; ++i) {
+    int expected = (i >= 1001 && i < 1001 + num_elements / 2) ?
+                   -static_cast<int>(i) : static_cast<int>(i + 1);
+    BOOST_REQUIRE(host_data[i] == 2 * expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(lazy_buffer_allocation) {
+  using namespace cl::sycl::access;
+  using cl::sycl::detail::device_memory_pool;
+  int device = 0;
+  BOOST_REQUIRE(hipGetDevice(&device) == hipSuccess);
+  auto& pool = device_memory_pool::get();
+
+  constexpr size_t num_elements = 4096;
+
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{num_elements}};
+  size_t bytes_in_use = pool.get_statistics(device).bytes_in_use;
+  {
+    auto acc = buf.get_access<mode::discard_write>();
+    for(size_t i = 0; i < num_elements; ++i)
+      acc[i] = static_cast<int>(i);
+  }
+  // Only used on the host so far
+  BOOST_CHECK(pool.get_statistics(device).bytes_in_use == bytes_in_use);
+
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class lazy_increment>(cl::sycl::range<1>{num_elements},
+      [=](cl::sycl::id<1> tid) {
+        acc[tid] += 1;
+      });
+  });
+#ifdef HIPSYCL_PLATFORM_CPU
+  // The kernel works on the host memory
+  BOOST_CHECK(pool.get_statistics(device).bytes_in_use == bytes_in_use);
+#else
+  const size_t device_bytes = device_memory_pool::get_size_class(
+      num_elements * sizeof(int));
+  BOOST_CHECK(pool.get_statistics(device).bytes_in_use ==
+              bytes_in_use + device_bytes);
+#endif
+  {
+    auto acc = buf.get_access<mode::read>();
+    for(size_t i = 0; i < num_elements; ++i)
+      BOOST_REQUIRE(acc[i] == static_cast<int>(i + 1));
+  }
+
+  // Initialized from const host data, which is only copied to the device
+  std::vector<int> init(num_elements, 3);
+  const int* init_ptr = init.data();
+  cl::sycl::buffer<int, 1> initialized{init_ptr, cl::sycl::range<1>{num_elements}};
+  auto acc = initialized.get_access<mode::read>();
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(acc[i] == 3);
+}
+
+BOOST_AUTO_TEST_CASE(unified_memory_buffers) {
+  using namespace cl::sycl::access;
+  constexpr size_t num_elements = 1024;
+
+  std::vector<int> host_data(num_elements, 1);
+  cl::sycl::queue q;
+  cl::sycl::buffer<int, 1> buf{host_data.data(), cl::sycl::range<1>{num_elements}};
+  cl::sycl::buffer<int, 1> owned{cl::sycl::range<1>{num_elements}};
+
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read_write>(cgh);
+    auto out = owned.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class unified_increment>(cl::sycl::range<1>{num_elements},
+      [=](cl::sycl::id<1> tid) {
+        acc[tid] += static_cast<int>(tid[0]);
+        out[tid] = acc[tid];
+      });
+  });
+
+  auto acc = buf.get_access<mode::read>();
+  auto out = owned.get_access<mode::read>();
+#ifdef HIPSYCL_PLATFORM_CPU
+  // Host accessors refer to the memory the kernel has worked on
+  BOOST_CHECK(acc.get_pointer() == host_data.data());
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(host_data[i] == static_cast<int>(i + 1));
+#endif
+  for(size_t i = 0; i < num_elements; ++i) {
+    BOOST_REQUIRE(acc[i] == static_cast<int>(i + 1));
+    BOOST_REQUIRE(out[i] == static_cast<int>(i + 1));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(out_of_core_buffers) {
+  using namespace cl::sycl::access;
+  using cl::sycl::detail::device_memory_pool;
+  namespace paging = cl::sycl::hipsycl::property::buffer;
+  int device = 0;
+  BOOST_REQUIRE(hipGetDevice(&device) == hipSuccess);
+
+  constexpr size_t chunk_size = 64 * 1024;
+  constexpr size_t chunk_elements = chunk_size / sizeof(int);
+  constexpr size_t num_chunks = 16;
+  constexpr size_t num_elements = num_chunks * chunk_elements;
+
+  // Emulate a device that only has room for three chunks
+  auto& pool = device_memory_pool::get();
+  pool.trim();
+  pool.set_device_memory_limit(pool.get_statistics(device).bytes_in_use +
+                               3 * chunk_size);
+
+  std::vector<int> host_data(num_elements);
+  for(size_t i = 0; i < num_elements; ++i)
+    host_data[i] = static_cast<int>(i);
+
+  cl::sycl::queue q;
+  {
+    cl::sycl::buffer<int, 1> buf{host_data.data(),
+                                 cl::sycl::range<1>{num_elements},
+                                 {paging::out_of_core{chunk_size}}};
+
+    auto process_chunk = [&](size_t chunk, int factor) {
+      q.submit([&](cl::sycl::handler& cgh) {
+        cl::sycl::range<1> chunk_range{chunk_elements};
+        cl::sycl::id<1> chunk_offset{chunk * chunk_elements};
+        auto acc = buf.get_access<mode::read_write>(cgh, chunk_range,
+                                                    chunk_offset);
+        cgh.parallel_for<class out_of_core_chunk>(chunk_range, chunk_offset,
+          [=](cl::sycl::item<1> tid) {
+            acc[tid.get_id()] = factor * (acc[tid.get_id()] + 1);
+          });
+      });
+    };
+
+    for(size_t chunk = 0; chunk < num_chunks; ++chunk)
+      process_chunk(chunk, 1);
+    {
+      // Only present on the host after its eviction
+      auto acc = buf.get_access<mode::read>(cl::sycl::range<1>{chunk_elements},
+                                            cl::sycl::id<1>{chunk_elements});
+      for(size_t i = chunk_elements; i < 2 * chunk_elements; ++i)
+        BOOST_REQUIRE(acc[i] == static_cast<int>(i + 1));
+    }
+    // Evicted chunks are paged in again
+    for(size_t chunk = num_chunks; chunk > 0; --chunk)
+      process_chunk(chunk - 1, 2);
+
+    BOOST_CHECK_THROW(q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.single_task<class out_of_core_too_large>([=]() { acc[0] = 0; });
+    }), cl::sycl::memory_allocation_error);
+  }
+  pool.set_device_memory_limit(std::numeric_limits<size_t>::max());
+
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(host_data[i] == 2 * static_cast<int>(i + 2));
+}
+
+BOOST_AUTO_TEST_CASE(out_of_core_buffers_concurrent_queues) {
+  using namespace cl::sycl::access;
+  using cl::sycl::detail::device_memory_pool;
+  namespace paging = cl::sycl::hipsycl::property::buffer;
+  int device = 0;
+  BOOST_REQUIRE(hipGetDevice(&device) == hipSuccess);
+
+  constexpr size_t chunk_size = 64 * 1024;
+  constexpr size_t chunk_elements = chunk_size / sizeof(int);
+  constexpr size_t num_chunks = 8;
+  constexpr size_t num_elements = num_chunks * chunk_elements;
+  constexpr int num_rounds = 4;
+
+  auto& pool = device_memory_pool::get();
+  pool.trim();
+  pool.set_device_memory_limit(pool.get_statistics(device).bytes_in_use +
+                               3 * chunk_size);
+
+  std::vector<int> host_data(num_elements, 0);
+  {
+    cl::sycl::buffer<int, 1> buf{host_data.data(),
+                                 cl::sycl::range<1>{num_elements},
+                                 {paging::out_of_core{chunk_size}}};
+
+    // Each thread processes every other chunk through its own queue,
+    // such that segments are evicted while the other thread maps its
+    // chunks.
+    auto process_chunks = [&](size_t first_chunk) {
+      cl::sycl::queue q;
+      for(int round = 0; round < num_rounds; ++round)
+        for(size_t chunk = first_chunk; chunk < num_chunks; chunk += 2)
+          q.submit([&](cl::sycl::handler& cgh) {
+            cl::sycl::range<1> chunk_range{chunk_elements};
+            cl::sycl::id<1> chunk_offset{chunk * chunk_elements};
+            auto acc = buf.get_access<mode::read_write>(cgh, chunk_range,
+                                                        chunk_offset);
+            cgh.parallel_for<class out_of_core_concurrent_chunk>(chunk_range,
+                                                                 chunk_offset,
+              [=](cl::sycl::item<1> tid) {
+                acc[tid.get_id()] += 1;
+              });
+          });
+      q.wait_and_throw();
+    };
+
+    std::thread even{process_chunks, 0};
+    std::thread odd{process_chunks, 1};
+    even.join();
+    odd.join();
+  }
+  pool.set_device_memory_limit(std::numeric_limits<size_t>::max());
+
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(host_data[i] == num_rounds);
+}
+
+BOOST_AUTO_TEST_CASE(file_backed_buffers) {
+  using namespace cl::sycl::access;
+  namespace mapping = cl::sycl::hipsycl::property::buffer;
+  constexpr size_t num_elements = 4096;
+  const std::string path = "hipsycl_file_backed_buffer.bin";
+
+  std::vector<int> file_data(num_elements);
+  for(size_t i = 0; i < num_elements; ++i)
+    file_data[i] = static_cast<int>(i);
+  {
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(file_data.data()),
+               num_elements * sizeof(int));
+  }
+
+  auto increment = [](cl::sycl::queue& q, cl::sycl::buffer<int, 1>& buf) {
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class file_backed_increment>(
+        cl::sycl::range<1>{num_elements}, [=](cl::sycl::id<1> tid) {
+          acc[tid] += 1;
+        });
+    });
+  };
+  auto read_file = [&]() {
+    std::vector<int> content(num_elements);
+    std::ifstream file{path, std::ios::binary};
+    file.read(reinterpret_cast<char*>(content.data()),
+              num_elements * sizeof(int));
+    return content;
+  };
+
+  cl::sycl::queue q;
+  {
+    // Modifications of read-only mappings are not written to the file
+    cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{num_elements},
+                                 {mapping::map_file{path}}};
+    increment(q, buf);
+    auto acc = buf.get_access<mode::read>();
+    for(size_t i = 0; i < num_elements; ++i)
+      BOOST_REQUIRE(acc[i] == static_cast<int>(i + 1));
+  }
+  BOOST_CHECK(read_file() == file_data);
+
+  {
+    cl::sycl::buffer<int, 1> buf{
+        cl::sycl::range<1>{num_elements},
+        {mapping::map_file{path, mapping::map_file::read_write}}};
+    increment(q, buf);
+  }
+  std::vector<int> content = read_file();
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(content[i] == static_cast<int>(i + 1));
+
+  // Read-only files must already provide the data of the entire buffer
+  BOOST_CHECK_THROW((cl::sycl::buffer<int, 1>{
+                      cl::sycl::range<1>{2 * num_elements},
+                      {mapping::map_file{path}}}),
+                    cl::sycl::invalid_parameter_error);
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(detached_buffer_destruction) {
+  using namespace cl::sycl::access;
+  namespace cleanup = cl::sycl::hipsycl::property::buffer;
+  constexpr size_t num_elements = 1024;
+  constexpr size_t num_buffers = 8;
+
+  cl::sycl::queue q;
+  std::vector<std::vector<int>> host_data(num_buffers,
+                                          std::vector<int>(num_elements, 1));
+  std::vector<int> final_data(num_elements, 0);
+
+  for(size_t i = 0; i < num_buffers; ++i) {
+    cl::sycl::buffer<int, 1> buf{host_data[i].data(),
+                                 cl::sycl::range<1>{num_elements},
+                                 {cleanup::detach_on_destruction{q}}};
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class detached_increment>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] += static_cast<int>(i);
+        });
+    });
+  }
+  {
+    cl::sycl::buffer<int, 1> buf{cl::sycl::range<1>{num_elements},
+                                 {cleanup::detach_on_destruction{q}}};
+    buf.set_final_data(final_data.data());
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto acc = buf.get_access<mode::discard_write>(cgh);
+      cgh.parallel_for<class detached_final_data>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) {
+          acc[tid] = static_cast<int>(tid[0]);
+        });
+    });
+  }
+  // Write-back completes asynchronously and is waited for by the queue
+  q.wait();
+
+  for(size_t i = 0; i < num_buffers; ++i)
+    for(size_t j = 0; j < num_elements; ++j)
+      BOOST_REQUIRE(host_data[i][j] == static_cast<int>(i + 1));
+  for(size_t j = 0; j < num_elements; ++j)
+    BOOST_REQUIRE(final_data[j] == static_cast<int>(j));
+}
+
+BOOST_AUTO_TEST_CASE(detached_buffer_destruction_on_worker) {
+  using namespace cl::sycl::access;
+  namespace detail = cl::sycl::detail;
+  namespace cleanup = cl::sycl::hipsycl::property::buffer;
+  // More than fit into the queue of the task graph's worker thread
+  constexpr size_t num_buffers = 2000;
+
+  auto& tg = detail::application::get_task_graph();
+  cl::sycl::queue q;
+  auto stream = std::make_shared<detail::stream_manager>(q.get_device());
+
+  // Holds back the task below until the buffers have been dropped
+  static std::atomic<bool> gate_open;
+  gate_open = false;
+  auto gate = tg.insert([stream]() {
+      detail::check_error(hipStreamAddCallback(stream->get_stream(),
+        [](hipStream_t, hipError_t, void*) {
+          while(!gate_open)
+            std::this_thread::yield();
+        }, nullptr, 0));
+      return detail::task_state::enqueued;
+    }, {}, stream, stream->get_error_handler(),
+    detail::task_execution_kind::stream_ordered);
+
+  std::vector<detail::buffer_ptr> buffers;
+  std::vector<cl::sycl::buffer<int, 1>> handles;
+  for(size_t i = 0; i < num_buffers; ++i) {
+    handles.emplace_back(cl::sycl::range<1>{16},
+                         cl::sycl::property_list{cleanup::detach_on_destruction{q}});
+    buffers.push_back(detail::buffer::get_buffer_impl(handles.back()));
+  }
+
+  // The worker thread submits this task once the gate has completed, and
+  // drops the last references to the buffers when releasing its functor.
+  auto holder = tg.insert([buffers]() {
+      return detail::task_state::complete;
+    }, {gate}, stream, stream->get_error_handler());
+  // A pending operation makes each buffer defer the release of its
+  // memory through the worker thread
+  auto pending = tg.insert([]() {
+      return detail::task_state::complete;
+    }, {holder}, stream, stream->get_error_handler());
+  for(const detail::buffer_ptr& buf : buffers)
+    buf->register_external_access(pending, mode::read_write);
+
+  buffers.clear();
+  handles.clear();
+  gate_open = true;
+
+  pending->wait();
+  tg.finish();
+}
+
+BOOST_AUTO_TEST_CASE(host_thread_pool_execution) {
+  using namespace cl::sycl::access;
+  using cl::sycl::detail::host_thread_pool;
+
+  host_thread_pool pool{4};
+  BOOST_CHECK(pool.get_num_threads() == 4);
+  std::vector<int> executed(1000, 0);
+  pool.run(executed.size(), [&](std::size_t task) { ++executed[task]; });
+  BOOST_CHECK(std::all_of(executed.begin(), executed.end(),
+                          [](int count) { return count == 1; }));
+
+  // Every work item of a range kernel must be executed exactly once,
+  // also if the range is not a multiple of the chunk size.
+  cl::sycl::queue q;
+  const cl::sycl::range<3> r{7, 5, 9};
+  const cl::sycl::id<3> offset{1, 2, 3};
+  cl::sycl::buffer<int, 3> buf{r + cl::sycl::range<3>{offset[0], offset[1], offset[2]}};
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class clear_pool_buffer>(buf.get_range(),
+      [=](cl::sycl::id<3> tid) { acc[tid] = 0; });
+  });
+  q.submit([&](cl::sycl::handler& cgh) {
+    auto acc = buf.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class pool_offset_kernel>(r, offset,
+      [=](cl::sycl::item<3> item) {
+        const cl::sycl::id<3> tid = item.get_id();
+        acc[tid] += static_cast<int>(((tid[0] - offset[0]) * r[1] +
+                                      (tid[1] - offset[1])) * r[2] +
+                                     (tid[2] - offset[2])) + 1;
+      });
+  });
+  auto acc = buf.get_access<mode::read>();
+  for(size_t i = 0; i < buf.get_range()[0]; ++i)
+    for(size_t j = 0; j < buf.get_range()[1]; ++j)
+      for(size_t k = 0; k < buf.get_range()[2]; ++k) {
+        const bool in_range = i >= offset[0] && j >= offset[1] && k >= offset[2];
+        const int expected = in_range ? static_cast<int>(
+            ((i - offset[0]) * r[1] + (j - offset[1])) * r[2] + (k - offset[2]) + 1) : 0;
+        BOOST_REQUIRE((acc[cl::sycl::id<3>{i, j, k}] == expected));
+      }
+
+#ifdef HIPSYCL_PLATFORM_CPU
+  namespace info = cl::sycl::info;
+  auto cpus = cl::sycl::device::get_devices(info::device_type::cpu);
+  BOOST_REQUIRE(!cpus.empty());
+  BOOST_CHECK(cl::sycl::device::get_devices(info::device_type::gpu).empty());
+  cl::sycl::device cpu{cl::sycl::cpu_selector{}};
+  BOOST_CHECK(cpu.get_info<info::device::device_type>() == info::device_type::cpu);
+  BOOST_CHECK(cpu.get_info<info::device::max_compute_units>() >= 1);
+  BOOST_CHECK(cpu.get_info<info::device::global_mem_cache_line_size>() > 0);
+  BOOST_CHECK(cpu.get_info<info::device::native_vector_width_float>() >= 1);
+  BOOST_CHECK(cpu.get_info<info::device::native_vector_width_char>() >=
+              cpu.get_info<info::device::native_vector_width_float>());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(host_thread_pool_concurrent_jobs) {
+  using cl::sycl::detail::host_thread_pool;
+  host_thread_pool pool{4};
+
+  // The tasks of each job wait until a task of the other job has
+  // started, which only succeeds if the jobs run concurrently.
+  std::atomic<int> started[2] = {{0}, {0}};
+  std::atomic<bool> timed_out{false};
+  auto run_job = [&](int self) {
+    pool.run(2, [&](std::size_t) {
+      ++started[self];
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+      while(started[1 - self] == 0)
+        if(std::chrono::steady_clock::now() > deadline) {
+          timed_out = true;
+          return;
+        }
+    });
+  };
+  std::thread first{run_job, 0};
+  std::thread second{run_job, 1};
+  first.join();
+  second.join();
+  BOOST_CHECK(!timed_out);
+  BOOST_CHECK(started[0] == 2 && started[1] == 2);
+
+  // Exceptions are rethrown by run() once the other tasks have completed
+  std::atomic<int> executed{0};
+  BOOST_CHECK_THROW(pool.run(100, [&](std::size_t task) {
+    ++executed;
+    if(task == 10)
+      throw cl::sycl::runtime_error{"failing task"};
+  }), cl::sycl::runtime_error);
+  BOOST_CHECK(executed > 0 && executed <= 100);
+  std::vector<int> after_error(100, 0);
+  pool.run(after_error.size(), [&](std::size_t task) { ++after_error[task]; });
+  BOOST_CHECK(std::all_of(after_error.begin(), after_error.end(),
+                          [](int count) { return count == 1; }));
+
+#ifdef HIPSYCL_PLATFORM_CPU
+  // Kernel exceptions reach the async handler of the queue
+  std::atomic<std::size_t> num_errors{0};
+  cl::sycl::async_handler handler = [&](cl::sycl::exception_list errors) {
+    num_errors += errors.size();
+  };
+  cl::sycl::queue q{handler};
+  q.submit([&](cl::sycl::handler& cgh) {
+    cgh.parallel_for<class throwing_range_kernel>(cl::sycl::range<1>{1024},
+      [=](cl::sycl::id<1> tid) {
+        if(tid[0] == 512)
+          throw cl::sycl::runtime_error{"failing kernel"};
+      });
+  });
+  q.wait();
+  BOOST_CHECK(num_errors == 1);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(range_kernel_simd_remainder) {
+  using namespace cl::sycl::access;
+
+  // On the CPU, blocks of consecutive work items are executed together,
+  // followed by the remaining items one by one.
+  constexpr size_t num_elements = 1021;
+  std::vector<float> x(num_elements), y(num_elements, 1.f);
+  for(size_t i = 0; i < num_elements; ++i)
+    x[i] = static_cast<float>(i);
+
+  {
+    cl::sycl::queue q;
+    cl::sycl::buffer<float, 1> x_buf{x.data(), cl::sycl::range<1>{num_elements}};
+    cl::sycl::buffer<float, 1> y_buf{y.data(), cl::sycl::range<1>{num_elements}};
+    q.submit([&](cl::sycl::handler& cgh) {
+      auto x_acc = x_buf.get_access<mode::read>(cgh);
+      auto y_acc = y_buf.get_access<mode::read_write>(cgh);
+      cgh.parallel_for<class simd_saxpy>(cl::sycl::range<1>{num_elements},
+        [=](cl::sycl::id<1> tid) { y_acc[tid] += 2.f * x_acc[tid]; });
+    });
+  }
+
+  for(size_t i = 0; i < num_elements; ++i)
+    BOOST_REQUIRE(y[i] == 2.f * static_cast<float>(i) + 1.f);
+}
+
+BOOST_AUTO_TEST_CASE(reductions) {
+  namespace s = cl::sycl;
+  using namespace cl::sycl::access;
+
+  constexpr size_t num_elements = 1000;
+  std::vector<int> data(num_elements);
+  for(size_t i = 0; i < num_elements; ++i)
+    data[i] = static_cast<int>(i) - 300;
+
+  s::queue q;
+  s::buffer<int, 1> data_buf{data.data(), s::range<1>{num_elements}};
+  s::buffer<int, 1> sum_buf{s::range<1>{1}};
+  s::buffer<float, 1> min_buf{s::range<1>{1}};
+  s::buffer<int, 1> max_buf{s::range<1>{1}};
+  s::buffer<int, 1> bits_buf{s::range<1>{1}};
+  {
+    auto acc = sum_buf.get_access<mode::discard_write>();
+    acc[0] = 5;
+  }
+
+  // read_write accessors include the value already in the buffer
+  q.submit([&](s::handler& cgh) {
+    auto data_acc = data_buf.get_access<mode::read>(cgh);
+    auto sum_acc = sum_buf.get_access<mode::read_write>(cgh);
+    cgh.parallel_for<class reduction_sum>(s::range<1>{num_elements},
+      s::reduction(sum_acc, s::plus<int>{}),
+      [=](s::id<1> tid, auto& sum) { sum += data_acc[tid]; });
+  });
+
+  q.submit([&](s::handler& cgh) {
+    auto min_acc = min_buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class reduction_min_2d>(s::range<2>{37, 29},
+      s::reduction(min_acc, s::minimum<float>{}),
+      [=](s::id<2> tid, auto& min) {
+        min.combine(static_cast<float>(tid[0]) - 0.5f * tid[1]);
+      });
+  });
+
+  // Work groups that do not fill the default group size
+  q.submit([&](s::handler& cgh) {
+    auto data_acc = data_buf.get_access<mode::read>(cgh);
+    auto max_acc = max_buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class reduction_max_nd>(
+      s::nd_range<1>{s::range<1>{num_elements}, s::range<1>{40}},
+      s::reduction(max_acc, s::maximum<int>{}),
+      [=](s::nd_item<1> item, auto& max) {
+        max.combine(data_acc[item.get_global()]);
+      });
+  });
+
+  q.submit([&](s::handler& cgh) {
+    auto bits_acc = bits_buf.get_access<mode::discard_write>(cgh);
+    cgh.parallel_for<class reduction_custom_nd>(
+      s::nd_range<2>{s::range<2>{16, 8}, s::range<2>{4, 8}},
+      s::reduction(bits_acc, 0, [](int a, int b) { return a | b; }),
+      [=](s::nd_item<2> item, auto& bits) {
+        bits.combine(1 << (item.get_global(0) + item.get_global(1)));
+      });
+  });
+
+  BOOST_REQUIRE(sum_buf.get_access<mode::read>()[0] ==
+                5 + (num_elements - 1) * num_elements / 2 - 300 * num_elements);
+  BOOST_REQUIRE(min_buf.get_access<mode::read>()[0] == -14.f);
+  BOOST_REQUIRE(max_buf.get_access<mode::read>()[0] == 699);
+  BOOST_REQUIRE(bits_buf.get_access<mode::read>()[0] == (1 << 23) - 1);
+}
+
 BOOST_AUTO_TEST_CASE(buffer_versioning) {
   namespace s = cl::sycl;
   constexpr size_t buf_size = 32;